@@ -0,0 +1,70 @@
+/**
+ ****************************************************************************************
+ *
+ * @file bench_ActivityClassifier.c
+ *
+ * @brief Host benchmark for the int8 activity classifier
+ *
+ * Build and run from the code/ directory:
+ *
+ *   gcc -O2 -DTEST -Iinclude/project -Itest/mocks bench/bench_ActivityClassifier.c \
+ *       src/ActivityClassifier.c src/Int8Engine.c -o bench_activity && ./bench_activity
+ *
+ ****************************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ActivityClassifier.h"
+
+#define BENCH_WINDOWS       (256)
+#define BENCH_ROUNDS        (200)
+
+uint8_t CurrentActivityLabel = 0;
+
+static ActivityWindow_t windows[BENCH_WINDOWS];
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    unsigned histogram[ACTIVITY_CLASSES + 1] = { 0 };
+    double start, elapsed;
+    int w, t, r;
+
+    srand(1);
+    for (w = 0; w < BENCH_WINDOWS; w++) {
+        for (t = 0; t < ACTIVITY_WINDOW_LEN; t++) {
+            windows[w][t][0] = (int8_t)((rand() % 64) - 32);
+            windows[w][t][1] = (int8_t)((rand() % 16) - 8);
+            windows[w][t][2] = (int8_t)(64 + (rand() % 8) - 4);
+        }
+    }
+
+    ActivityClassifierInit();
+
+    start = now_ns();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        for (w = 0; w < BENCH_WINDOWS; w++) {
+            ActivityLabel_t label = ActivityClassifierRun((const int8_t (*)[ACTIVITY_AXES])windows[w]);
+            histogram[label < ACTIVITY_CLASSES ? label : ACTIVITY_CLASSES]++;
+        }
+    }
+    elapsed = now_ns() - start;
+
+    printf("inferences:        %d\n", BENCH_ROUNDS * BENCH_WINDOWS);
+    printf("time/inference:    %.1f ns\n", elapsed / (BENCH_ROUNDS * BENCH_WINDOWS));
+    printf("arena high water:  %zu bytes\n", ActivityClassifierArenaHighWater());
+    printf("input tensor:      %zu bytes\n", sizeof(ActivityWindow_t));
+    printf("labels idle/walking/vibrating/unknown: %u/%u/%u/%u\n",
+           histogram[ACTIVITY_IDLE], histogram[ACTIVITY_WALKING],
+           histogram[ACTIVITY_VIBRATING], histogram[ACTIVITY_CLASSES]);
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ ****************************************************************************************
+ *
+ * @file bench_TiltEstimator.c
+ *
+ * @brief Host benchmark of the CORDIC tilt estimator against a libm reference
+ *
+ * Build and run from the code/ directory:
+ *
+ *   gcc -O2 -DTEST -Iinclude/project bench/bench_TiltEstimator.c src/TiltEstimator.c \
+ *       -lm -o bench_tilt && ./bench_tilt
+ *
+ * Cycles are read from the TSC on x86 hosts; elsewhere only wall time is reported. The
+ * ratio between the two columns is what carries over to the target, not the absolute
+ * numbers.
+ *
+ ****************************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "TiltEstimator.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define READ_CYCLES()       __rdtsc()
+#else
+#define READ_CYCLES()       0ULL
+#endif
+
+#define BENCH_SAMPLES       (4096)
+#define BENCH_ROUNDS        (100)
+#define RAD_TO_CENTIDEG     (18000.0 / M_PI)
+
+static int16_t samples[BENCH_SAMPLES][3];
+static volatile int32_t sink;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void reference_tilt(const int16_t xyz[3], double out[3])
+{
+    double x = xyz[0], y = xyz[1], z = xyz[2];
+
+    out[0] = atan2(-x, sqrt(y * y + z * z)) * RAD_TO_CENTIDEG;
+    out[1] = atan2(y, z) * RAD_TO_CENTIDEG;
+    out[2] = atan2(sqrt(x * x + y * y), z) * RAD_TO_CENTIDEG;
+}
+
+int main(void)
+{
+    unsigned long long c0, cordic_cycles, libm_cycles;
+    double t0, cordic_ns, libm_ns, max_err = 0;
+    Tilt_t tilt;
+    int i, r;
+
+    srand(1);
+    for (i = 0; i < BENCH_SAMPLES; i++) {
+        samples[i][0] = (int16_t)((rand() % 32768) - 16384);
+        samples[i][1] = (int16_t)((rand() % 32768) - 16384);
+        samples[i][2] = (int16_t)((rand() % 32768) - 16384);
+    }
+
+    TiltEstimatorInit(0);
+
+    for (i = 0; i < BENCH_SAMPLES; i++) {
+        double ref[3];
+        double err;
+
+        TiltEstimatorUpdate(samples[i], &tilt);
+        reference_tilt(samples[i], ref);
+
+        err = fabs(tilt.pitch - ref[0]);
+        if (err > max_err) max_err = err;
+        err = fabs(remainder(tilt.roll - ref[1], 36000.0));
+        if (err > max_err) max_err = err;
+        err = fabs(tilt.tilt - ref[2]);
+        if (err > max_err) max_err = err;
+    }
+
+    t0 = now_ns();
+    c0 = READ_CYCLES();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        for (i = 0; i < BENCH_SAMPLES; i++) {
+            TiltEstimatorUpdate(samples[i], &tilt);
+            sink += tilt.pitch + tilt.roll + tilt.tilt;
+        }
+    }
+    cordic_cycles = READ_CYCLES() - c0;
+    cordic_ns = now_ns() - t0;
+
+    t0 = now_ns();
+    c0 = READ_CYCLES();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        for (i = 0; i < BENCH_SAMPLES; i++) {
+            double ref[3];
+
+            reference_tilt(samples[i], ref);
+            sink += (int32_t)(ref[0] + ref[1] + ref[2]);
+        }
+    }
+    libm_cycles = READ_CYCLES() - c0;
+    libm_ns = now_ns() - t0;
+
+    printf("samples:              %d\n", BENCH_ROUNDS * BENCH_SAMPLES);
+    printf("cordic  per sample:   %.1f ns, %.0f cycles\n",
+           cordic_ns / (BENCH_ROUNDS * BENCH_SAMPLES),
+           (double)cordic_cycles / (BENCH_ROUNDS * BENCH_SAMPLES));
+    printf("libm    per sample:   %.1f ns, %.0f cycles\n",
+           libm_ns / (BENCH_ROUNDS * BENCH_SAMPLES),
+           (double)libm_cycles / (BENCH_ROUNDS * BENCH_SAMPLES));
+    printf("max abs error:        %.2f centidegrees\n", max_err);
+
+    return 0;
+}
@@ -27,4 +27,92 @@
 #define CFG_USER_SERVICE     (0)     // register custom service (using 128-bit UUIDs)
 
 #define CFG_TEMPERATURE_SERVICE (1)
+
+// keep sensor values in the attribute database so reads don't go through the application
+#define CFG_SENSORS_READ_FROM_DB        (1)
+
+// sample the temperature only when a read finds the cached value older than
+// CFG_TEMP_STALE_MS, instead of on a periodic timer; the read is answered once it arrives
+#define CFG_TEMP_LAZY_SAMPLING          (1)
+#define CFG_TEMP_STALE_MS               (10 * 1000)
+
+// publish raw accelerometer samples on their own characteristic (and in the snapshot,
+// the advertising data and the history log); off, only the activity label and the
+// derived tilt leave the device and the accelerometer is configured through the activity
+// characteristic
+#define CFG_RAW_ACCELERATION            (0)
+
+// low-pass filter of the derived tilt output, 1/2^n per sample, 0 disables it
+#define CFG_TILT_FILTER_SHIFT   (2)
+
+// ATT MTU and LL data length requested on every connection, so that one notification
+// carries a whole batch of samples in a single LL data PDU
+#define CFG_ATT_MTU             (247)
+#define CFG_LL_DATA_LENGTH      (251)
+
+// longest time a sample waits in its batch before a partly filled payload is sent
+#define CFG_BATCH_MAX_LATENCY_MS        (5 * 1000)
+
+// sample history downloaded over an L2CAP CoC, see history_transfer.h; the log size is a
+// multiple of the 12-byte record, 12 KiB keeps about 17 minutes of both sensors at 1 Hz
+#define CFG_HISTORY_PSM                 (0x0081)
+#define CFG_HISTORY_INITIAL_CREDITS     (4)
+#define CFG_HISTORY_LOG_SIZE            (1024 * 12)
+
+// connection parameter profiles: a link moving CFG_CONN_BUSY_BYTES per poll, or running a
+// history download, asks for the throughput profile and returns to low power after
+// CFG_CONN_IDLE_MS without traffic
+#define CFG_CONN_PARAM_POLL_MS          (1 * 1000)
+#define CFG_CONN_BUSY_BYTES             (256)
+#define CFG_CONN_IDLE_MS                (5 * 1000)
+
+// figures for the average current estimate of each profile, to be calibrated on the board
+#define CFG_CONN_EVENT_CHARGE_NC        (2500)
+#define CFG_SLEEP_CURRENT_UA            (10)
+
+// latest sensor values broadcast in manufacturer-specific advertising data, see
+// AdvTelemetry.h; temperature is then also sampled periodically so scanners see it change
+#define CFG_ADV_TELEMETRY               (1)
+#define CFG_ADV_COMPANY_ID              (0x00D2)
+// set to 0 for tags that are only ever scanned, they advertise non-connectable
+#define CFG_ADV_CONNECTABLE             (1)
+
+// BLE events handled per wakeup of the application task, at most this many and for at
+// most this long; 1 handles one event per task notification
+#define CFG_BLE_EVT_BATCH_MAX           (8)
+#define CFG_BLE_EVT_BATCH_BUDGET_MS     (5)
+
+// granularity of the timer wheel that runs the periodic sensor and link jobs
+#define CFG_TIMER_WHEEL_RESOLUTION_MS   (10)
+
+// application buffers come from fixed-size blocks instead of the FreeRTOS heap, see
+// Allocator.h, accounted per caller; {size, count} per class, the last one takes a full
+// SENSORS_MAX_PAYLOAD_LEN payload. What the classes can't take goes to a heap of
+// CFG_APP_HEAP_SIZE, then to OS_MALLOC
+#define CFG_APP_ALLOCATOR               (1)
+#define CFG_APP_POOL_CLASSES            { { 32, 8 }, { 64, 6 }, { 264, 2 } }
+#define CFG_APP_POOL_SIZE               (ALLOCATOR_POOL_BYTES(32, 8) + ALLOCATOR_POOL_BYTES(64, 6) + \
+                                                ALLOCATOR_POOL_BYTES(264, 2))
+#define CFG_APP_HEAP_SIZE               (1024)
+// BLE events from app_malloc() too; only for a BLE manager patched to allocate them with
+// ble_event_alloc(), the stock one takes them from OS_MALLOC and nothing here calls it
+#define CFG_BLE_EVT_POOL                (0)
+
+// stack high-water marks of the application tasks, see StackMonitor.h; one task is
+// measured per period and the results are readable from a debug characteristic
+#define CFG_STACK_MONITOR               (1)
+#define CFG_STACK_MONITOR_PERIOD_MS     (10 * 1000)
+#define CFG_STACK_MARGIN_PERCENT        (25)
+
+// poisoned memory is checked from the idle hook instead of the tick interrupt, see
+// PoisonCheck.h; at most CFG_POISON_SLICE_WORDS per idle pass and a full sweep started
+// every CFG_POISON_SWEEP_MS. The sliced areas are red zones of CFG_POISON_GUARD_WORDS
+// behind the pool and the heap of CFG_APP_ALLOCATOR, which hold the sensor payloads. The
+// SDK's own area can't be sliced, it is checked in one pass at the end of every sweep.
+// Either way an overwrite is found up to CFG_POISON_SWEEP_MS after it happened, instead
+// of within a tick; 0 keeps the SDK check on every tick
+#define CFG_POISON_CHECK                (1)
+#define CFG_POISON_SLICE_WORDS          (32)
+#define CFG_POISON_SWEEP_MS             (1000)
+#define CFG_POISON_GUARD_WORDS          (16)
 #endif /* BLE_PERIPHERAL_CONFIG_H_ */
@@ -78,7 +78,19 @@
  * FreeRTOS specific config
  */
 #define OS_FREERTOS                              /* Define this to use FreeRTOS */
+
+/*
+ * Application tasks and timers in static memory, see app_rtos.h. The heap then only has to
+ * hold what the BLE stack and the SDK adapters create.
+ */
+#define CFG_STATIC_RTOS_OBJECTS                  (0)
+
+#if CFG_STATIC_RTOS_OBJECTS
+#define configSUPPORT_STATIC_ALLOCATION          1
+#define configTOTAL_HEAP_SIZE                    14592   /* This is the FreeRTOS Total Heap Size */
+#else
 #define configTOTAL_HEAP_SIZE                    16384   /* This is the FreeRTOS Total Heap Size */
+#endif
 
 /*************************************************************************************************\
  * Peripheral specific config
@@ -95,8 +107,8 @@
 #define dg_configBLE_CENTRAL                    (0)
 #define dg_configBLE_GATT_CLIENT                (0)
 #define dg_configBLE_OBSERVER                   (0)
-#define dg_configBLE_BROADCASTER                (0)
-#define dg_configBLE_L2CAP_COC                  (0)
+#define dg_configBLE_BROADCASTER                (1)
+#define dg_configBLE_L2CAP_COC                  (1)
 
 
 #define defaultBLE_STATIC_ADDRESS               { 0x41, 0x85, 0x01, 0x6E, 0x00, 0x88 }
@@ -112,6 +124,15 @@
 #define dg_configUSE_HW_I2C                     (1)
 #define dg_configI2C_ADAPTER                    (1)
 
+/*
+ * Optional demo sensors on I2C1, see platform_devices.h. Each enabled sensor also gets
+ * its characteristic in the sensors service.
+ */
+#define CFG_DEMO_SENSOR_BME280                  (0)
+#define CFG_DEMO_SENSOR_BMM150                  (0)
+#define CFG_DEMO_SENSOR_BMG160                  (0)
+#define CFG_DEMO_SENSOR_BH1750                  (0)
+
 
 /* Include bsp default values */
 #include "bsp_defaults.h"
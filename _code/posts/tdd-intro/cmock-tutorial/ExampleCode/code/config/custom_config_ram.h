@@ -62,7 +62,19 @@
  * FreeRTOS specific config
  */
 #define OS_FREERTOS                              /* Define this to use FreeRTOS */
+
+/*
+ * Application tasks and timers in static memory, see app_rtos.h. The heap then only has to
+ * hold what the BLE stack and the SDK adapters create.
+ */
+#define CFG_STATIC_RTOS_OBJECTS                  (0)
+
+#if CFG_STATIC_RTOS_OBJECTS
+#define configSUPPORT_STATIC_ALLOCATION          1
+#define configTOTAL_HEAP_SIZE                    12208   /* This is the FreeRTOS Total Heap Size */
+#else
 #define configTOTAL_HEAP_SIZE                    14000   /* This is the FreeRTOS Total Heap Size */
+#endif
 
 /*************************************************************************************************\
  * Peripheral specific config
@@ -16,6 +16,12 @@
 #define COMMON_H_ 
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "Allocator.h"
+
+/* Stack of the application task, in bytes */
+#define BLE_PERIPHERAL_TASK_STACK_SIZE  (1024)
 
 /**
  * \brief Setup peripherals used in demo application
@@ -26,5 +32,34 @@ void periph_setup(void);
 void i2c_temp_init(void);
 void i2c_acc_init(void);
 
+/**
+ * \brief Allocate and free application buffers
+ *
+ * With CFG_APP_ALLOCATOR, from the application pool or heap and accounted against site;
+ * OS_MALLOC when those are full or disabled. Safe to call from any task.
+ *
+ */
+void *app_malloc(size_t size, AllocSite_t *site);
+void app_free(void *buf);
+
+/**
+ * \brief Allocate and free BLE event buffers
+ *
+ * app_malloc() under the "ble events" site. A hook without a caller in this tree: the BLE
+ * manager of the SDK allocates events with OS_MALLOC, set CFG_BLE_EVT_POOL only once it
+ * has been changed to call ble_event_alloc().
+ *
+ */
+void *ble_event_alloc(size_t size);
+void ble_event_free(void *buf);
+
+/**
+ * \brief Poison an area that nothing may write
+ *
+ * The idle hook checks it from then on and halts the system if it was overwritten.
+ *
+ */
+void poison_area_add(uint32_t *start, size_t words);
+
 
 #endif /* COMMON_H_ */
@@ -26,16 +26,77 @@
 #include "ad_i2c.h"
 #include <platform_devices.h>
 #include "def.h"
+#include "ActivityClassifier.h"
+#include "SensorSample.h"
+#include "SampleBatch.h"
+#include "SensorExecutor.h"
 
 // #include "hw_led.h"
 // #include "hw_breath.h"
 // #include "sys_power_mgr.h"
 
+/* CTRL1_A: ODR[7:4] FS[3:2] HF_ODR BDU. Idle runs the wake-up engine at the lowest ODR */
+#ifndef ACC_IDLE_CTRL1
+#define ACC_IDLE_CTRL1              (0x80)      // low-power 1 Hz, +-2 g
+#endif
+#ifndef ACC_ACTIVE_CTRL1
+#define ACC_ACTIVE_CTRL1            (0xC0)      // low-power 100 Hz, +-2 g
+#endif
+
+/* Wake-up threshold in FS/64 steps (2 -> 62.5 mg at +-2 g) */
+#ifndef ACC_WAKE_UP_THS
+#define ACC_WAKE_UP_THS             (2)
+#endif
+
+/* Time without a wake-up event before falling back to idle */
+#ifndef ACC_IDLE_TIMEOUT_MS
+#define ACC_IDLE_TIMEOUT_MS         (10000)
+#endif
+
+/* FIFO levels above this would overrun the driver's sample ring in one drain */
+#define ACC_FIFO_MAX_WATERMARK      (SAMPLE_BATCH_LEN)
+
+/*
+ * With the FIFO on, the samples collected over one period must fit the watermark, and
+ * each drain reads at most a watermark's worth, so nothing is lost in the sample ring.
+ */
+typedef struct {
+    uint8_t  active_odr;        // CTRL1_A ODR[3:0] used while active, 1..15
+    uint8_t  fifo_watermark;    // samples the FIFO collects between drains, 0 = FIFO off
+    uint32_t period_ms;         // time between measurements while active
+} AccelerometerConfig_t;
+
+typedef enum {
+    ACC_MODE_IDLE = 0,
+    ACC_MODE_ACTIVE,
+} AccelerometerMode_t;
+
+/* Called from the sensor executor whenever the power mode changes */
+typedef void (* AccelerometerModeCb_t) (AccelerometerMode_t mode);
+
 void i2c_acc_do_measurement(void);
 void i2c_acc_init(void);
+AccelerometerMode_t i2c_acc_get_mode(void);
+void i2c_acc_register_mode_cb(AccelerometerModeCb_t cb);
+void i2c_acc_register_sample_cb(SensorSampleCb_t cb);
+void i2c_acc_get_sample(SensorSample_t *sample);
+
+/* Move up to max samples, oldest first, out of the driver. Returns how many were taken */
+uint8_t i2c_acc_take_samples(SensorSample_t *out, uint8_t max);
+
+/* Validate cfg and have the driver task reprogram the sensor. Returns false if invalid */
+bool i2c_acc_configure(const AccelerometerConfig_t *cfg);
+void i2c_acc_get_config(AccelerometerConfig_t *cfg);
 
+STATIC void WriteI2CRegister(i2c_device dev, uint8_t Register, uint8_t Value);
+STATIC AccelerometerMode_t NextPowerMode(AccelerometerMode_t mode, bool motion,
+                                        OS_TICK_TIME now, OS_TICK_TIME *last_motion);
 STATIC uint8_t GetDataReadyFlag(i2c_device dev);
-STATIC uint16_t UpdateAccelerometerValue(i2c_device dev);
+STATIC CoState_t AccelerometerThread(SensorThread_t *t);
 STATIC uint16_t ConcatenateBytes(uint8_t MostSignificantByte, uint8_t LessSignificantByte);
+STATIC uint8_t ActiveCtrl1(uint8_t odr);
+STATIC SensorTime_t FifoSampleTime(SensorTime_t from, SensorTime_t to, uint16_t index,
+                                   uint16_t count);
+STATIC uint32_t SamplesPerPeriod(uint8_t odr, uint32_t period_ms);
 
 #endif /* _ACCELEROMETER_DRIVER_H_ */
@@ -0,0 +1,55 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ActivityClassifier.h
+ *
+ * @brief On-device idle/walking/vibrating classifier for accelerometer windows
+ *
+ ****************************************************************************************
+ */
+#ifndef _ACTIVITY_CLASSIFIER_H
+#define _ACTIVITY_CLASSIFIER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <platform_devices.h>
+#include "Int8Engine.h"
+#include "def.h"
+
+/* Model input: ACTIVITY_WINDOW_LEN consecutive XYZ samples, 1/64 g per LSB */
+#define ACTIVITY_WINDOW_LEN     (32)
+#define ACTIVITY_AXES           (3)
+
+/* Model topology: conv1d(k=5, s=2) -> relu -> global avg pool -> dense */
+#define ACTIVITY_CONV_FILTERS   (4)
+#define ACTIVITY_CONV_KERNEL    (5)
+#define ACTIVITY_CONV_STRIDE    (2)
+#define ACTIVITY_CONV_LEN       INT8_CONV1D_OUT_LEN(ACTIVITY_WINDOW_LEN, ACTIVITY_CONV_KERNEL, \
+                                                                        ACTIVITY_CONV_STRIDE)
+#define ACTIVITY_CLASSES        (3)
+
+/* Raw LSM303AH samples are 14 bit left-justified at +-2 g: 16384 LSB/g -> 64 LSB/g */
+#define ACTIVITY_INPUT_SHIFT    (8)
+
+typedef enum {
+    ACTIVITY_IDLE = 0,
+    ACTIVITY_WALKING,
+    ACTIVITY_VIBRATING,
+    ACTIVITY_UNKNOWN = 0xFF,
+} ActivityLabel_t;
+
+/* Compile-time tensor shapes */
+typedef int8_t ActivityWindow_t[ACTIVITY_WINDOW_LEN][ACTIVITY_AXES];
+typedef int8_t ActivityConvOut_t[ACTIVITY_CONV_LEN][ACTIVITY_CONV_FILTERS];
+typedef int8_t ActivityFeatures_t[ACTIVITY_CONV_FILTERS];
+typedef int8_t ActivityLogits_t[ACTIVITY_CLASSES];
+
+void            ActivityClassifierInit(void);
+bool            ActivityClassifierAddSample(int16_t x, int16_t y, int16_t z);
+void            ActivityClassifierIdle(void);
+ActivityLabel_t ActivityClassifierRun(const int8_t window[ACTIVITY_WINDOW_LEN][ACTIVITY_AXES]);
+size_t          ActivityClassifierArenaHighWater(void);
+
+STATIC int8_t   QuantizeAxis(int16_t raw);
+
+#endif  /* _ACTIVITY_CLASSIFIER_H */
@@ -0,0 +1,33 @@
+/**
+ ****************************************************************************************
+ *
+ * @file AdvTelemetry.h
+ *
+ * @brief Latest sensor values as a manufacturer-specific advertising data structure
+ *
+ * The structure is edited in place inside the advertising data, so it can be handed to
+ * the stack again after every sample without rebuilding the payload:
+ *
+ *   | length | 0xFF | company id (u16) | version (u8) | sequence (u8) |
+ *   | temperature (s16) | acceleration x, y, z (s16) | activity (u8) |
+ *
+ * Everything is little endian. The sequence number changes with every update, scanners
+ * use it to drop repeated advertisements of the same values.
+ *
+ ****************************************************************************************
+ */
+#ifndef _ADV_TELEMETRY_H
+#define _ADV_TELEMETRY_H
+
+#include <stdint.h>
+
+#define ADV_TELEMETRY_LEN       (15)    // whole AD structure, length byte included
+#define ADV_TELEMETRY_VERSION   (1)
+
+void    AdvTelemetryInit(uint8_t *ad, uint16_t company_id);
+void    AdvTelemetrySetTemperature(uint8_t *ad, int16_t value);
+void    AdvTelemetrySetAcceleration(uint8_t *ad, const int16_t value[3]);
+void    AdvTelemetrySetActivity(uint8_t *ad, uint8_t label);
+uint8_t AdvTelemetrySequence(const uint8_t *ad);
+
+#endif  /* _ADV_TELEMETRY_H */
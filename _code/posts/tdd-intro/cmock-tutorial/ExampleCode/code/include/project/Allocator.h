@@ -0,0 +1,87 @@
+/**
+ ****************************************************************************************
+ *
+ * @file Allocator.h
+ *
+ * @brief Block pools with a fallback heap, accounted per allocation site
+ *
+ * A request first goes to the fixed-size classes of an EventPool and, when none of them
+ * can take it, to a first-fit heap of its own. Every allocation names its site, a static
+ * AllocSite_t that collects the live bytes, their high-water mark and the failures of
+ * that caller; sites link themselves into the allocator on first use so all of them can
+ * be listed at runtime.
+ *
+ * Free heap blocks are merged lazily, by the walks of allocation and of
+ * AllocatorHeapInfo(). Nothing here locks, callers on several tasks must.
+ *
+ ****************************************************************************************
+ */
+#ifndef _ALLOCATOR_H
+#define _ALLOCATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "EventPool.h"
+
+typedef struct AllocSite {
+    const char       *name;
+    struct AllocSite *next;
+    bool              registered;
+    uint32_t          live;             // bytes asked for and not freed yet
+    uint32_t          peak;
+    uint32_t          allocs;
+    uint32_t          failed;
+} AllocSite_t;
+
+#define ALLOC_SITE_INIT(name)   { (name), NULL, false, 0, 0, 0, 0 }
+
+/* In front of every buffer handed out */
+typedef struct {
+    AllocSite_t *site;
+    uint32_t     size;
+} AllocHeader_t;
+
+#define ALLOCATOR_HEADER_SIZE           EVENT_POOL_BLOCK_SIZE(sizeof(AllocHeader_t))
+
+/* Pool memory taken by count buffers of size bytes */
+#define ALLOCATOR_POOL_BYTES(size, count)       \
+    (EVENT_POOL_BLOCK_SIZE((size) + ALLOCATOR_HEADER_SIZE) * (count))
+
+typedef struct {
+    uint32_t live;                      // bytes, all sites
+    uint32_t peak;
+    uint32_t failed;
+    uint32_t from_heap;                 // allocations no pool class could take
+} AllocatorStats_t;
+
+typedef struct {
+    EventPool_t      pool;
+    uint8_t         *heap;
+    size_t           heap_len;
+    AllocSite_t     *sites;
+    AllocatorStats_t stats;
+} Allocator_t;
+
+/*
+ * Pool classes give the buffer sizes, pool_len must cover ALLOCATOR_POOL_BYTES() of all
+ * of them. Both memory areas must be aligned for a pointer. Returns false if the classes
+ * don't fit or are more than EVENT_POOL_MAX_CLASSES.
+ */
+bool AllocatorInit(Allocator_t *alloc, void *pool_memory, size_t pool_len,
+                   const EventPoolClassConfig_t *classes, uint8_t count,
+                   void *heap, size_t heap_len);
+
+/* NULL, counted against site, if neither the pool nor the heap has room */
+void *AllocatorAlloc(Allocator_t *alloc, size_t size, AllocSite_t *site);
+
+/*
+ * Returns false, and leaves it alone, if buf did not come from this allocator or is not
+ * in use, like a second free of the same buffer
+ */
+bool AllocatorFree(Allocator_t *alloc, void *buf);
+
+/* Free bytes of the heap and the biggest request it can still take in one piece */
+void AllocatorHeapInfo(Allocator_t *alloc, size_t *free, size_t *largest);
+
+#endif  /* _ALLOCATOR_H */
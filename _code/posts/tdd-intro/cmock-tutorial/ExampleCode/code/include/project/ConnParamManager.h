@@ -0,0 +1,68 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ConnParamManager.h
+ *
+ * @brief Pick the connection parameter profile of each link from its traffic
+ *
+ * A link is busy while it moves at least busy_bytes per poll or a bulk transfer runs, and
+ * then wants the throughput profile (short interval, no slave latency). Once it has been
+ * quiet for idle_ms it falls back to the low power profile (long interval, slave latency).
+ *
+ * Time, bytes and the expected number of connection events are accumulated per profile,
+ * according to the parameters the link actually runs with, so each profile can report
+ * its throughput and an estimate of its average current.
+ *
+ ****************************************************************************************
+ */
+#ifndef _CONN_PARAM_MANAGER_H
+#define _CONN_PARAM_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    CONN_PROFILE_LOW_POWER,
+    CONN_PROFILE_THROUGHPUT,
+    CONN_PROFILE_COUNT,
+} ConnProfile_t;
+
+typedef struct {
+    uint32_t busy_bytes;                // bytes per poll that keep a link busy
+    uint32_t idle_ms;                   // quiet time before going back to low power
+    uint16_t throughput_interval_max;   // longest interval, 1.25 ms units, counted as throughput
+} ConnParamConfig_t;
+
+typedef struct {
+    uint32_t time_ms;
+    uint32_t bytes;
+    uint32_t events;                    // connection events at the negotiated interval and latency
+} ConnProfileStats_t;
+
+void ConnParamInit(const ConnParamConfig_t *config);
+
+/* Interval in 1.25 ms units and slave latency the link was created or updated with */
+void ConnParamOpen(uint16_t conn_idx, uint32_t now_ms, uint16_t interval, uint16_t latency);
+void ConnParamApplied(uint16_t conn_idx, uint32_t now_ms, uint16_t interval, uint16_t latency);
+void ConnParamClose(uint16_t conn_idx, uint32_t now_ms);
+
+/*
+ * Account the bytes sent on the link since the last poll. Returns true with the profile
+ * to request in *request when the link should change its parameters.
+ */
+bool ConnParamPoll(uint16_t conn_idx, uint32_t now_ms, uint32_t bytes, bool bulk,
+                   ConnProfile_t *request);
+
+void ConnParamGetStats(ConnProfile_t profile, ConnProfileStats_t *stats);
+
+/* Bytes per second while in the profile */
+uint32_t ConnParamThroughput(const ConnProfileStats_t *stats);
+
+/*
+ * Estimated average current in uA: the sleep current plus the charge of one connection
+ * event, in nC, for every event the profile was expected to have
+ */
+uint32_t ConnParamAverageCurrent(const ConnProfileStats_t *stats, uint32_t event_charge_nc,
+                                 uint32_t sleep_ua);
+
+#endif  /* _CONN_PARAM_MANAGER_H */
@@ -0,0 +1,78 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ConnectionTable.h
+ *
+ * @brief Per-central state for fanning sensor updates out to several connections
+ *
+ * Each connected central has a record with its subscriptions, negotiated link sizes,
+ * requested decimation per characteristic and a number of TX credits. A credit is taken
+ * for every notification queued to the central and given back once the stack reports it
+ * sent, so one slow central cannot fill up the TX queue for everybody. A central out of
+ * credits skips single values, batched samples are instead kept until it has one again.
+ *
+ ****************************************************************************************
+ */
+#ifndef _CONNECTION_TABLE_H
+#define _CONNECTION_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONN_MAX                (4)     // centrals served at the same time
+#define CONN_MAX_CHARS          (8)     // characteristics tracked per central
+#define CONN_TX_CREDITS         (4)     // notifications in flight per central
+#define CONN_IDX_NONE           (0xFFFF)
+
+/* Bits of the Client Characteristic Configuration value */
+#define CONN_CCC_NOTIFY         (0x0001)
+#define CONN_CCC_INDICATE       (0x0002)
+
+typedef struct {
+    uint16_t conn_idx;                      // CONN_IDX_NONE while the slot is free
+    uint16_t mtu;
+    uint16_t ll_octets;
+    uint8_t  notify_mask;                   // bit per characteristic
+    uint8_t  indicate_mask;
+    uint8_t  decimation[CONN_MAX_CHARS];    // send every n-th update, 0 and 1 send all
+    uint8_t  countdown[CONN_MAX_CHARS];
+    uint8_t  tx_credits;
+
+    // counters, never reset while connected
+    uint32_t sent;
+    uint32_t decimated;
+    uint32_t no_credit;
+
+    uint32_t bytes;                         // value bytes sent since ConnTakeBytes()
+} ConnRecord_t;
+
+void          ConnTableInit(void);
+ConnRecord_t *ConnTableAdd(uint16_t conn_idx, uint16_t mtu, uint16_t ll_octets);
+ConnRecord_t *ConnTableFind(uint16_t conn_idx);
+void          ConnTableRemove(uint16_t conn_idx);
+uint8_t       ConnTableCount(void);
+
+/* Record in the given slot, NULL if the slot is free; slots go from 0 to CONN_MAX - 1 */
+ConnRecord_t *ConnTableAt(uint8_t slot);
+
+void          ConnSetCcc(ConnRecord_t *rec, uint8_t ch, uint16_t ccc);
+uint16_t      ConnGetCcc(const ConnRecord_t *rec, uint8_t ch);
+bool          ConnIsSubscribed(const ConnRecord_t *rec, uint8_t ch);
+void          ConnSetDecimation(ConnRecord_t *rec, uint8_t ch, uint8_t decimation);
+
+/*
+ * Decide whether this update of ch goes to the central: it must be subscribed, due
+ * according to its decimation and have a TX credit left, which is then taken.
+ */
+bool          ConnTakeUpdate(ConnRecord_t *rec, uint8_t ch);
+
+/* The next update of ch is for the central, credits aside: subscribed and not decimated */
+bool          ConnIsDue(const ConnRecord_t *rec, uint8_t ch);
+
+/* A notification or indication to the central left the TX queue */
+void          ConnReturnCredit(ConnRecord_t *rec);
+
+/* Value bytes sent to the central since the previous call */
+uint32_t      ConnTakeBytes(ConnRecord_t *rec);
+
+#endif  /* _CONNECTION_TABLE_H */
@@ -0,0 +1,46 @@
+/**
+ ****************************************************************************************
+ *
+ * @file Coroutine.h
+ *
+ * @brief Stackless coroutines in the style of protothreads
+ *
+ * A coroutine is a function that returns CO_WAITING wherever it has to wait and is called
+ * again later; CO_BEGIN() jumps back to the wait it returned from. Only the resume point
+ * is kept, so locals do not survive a wait: state that must live across one goes into
+ * static or per-instance storage. Waits cannot be placed inside a switch statement of the
+ * coroutine, and at most one wait fits on a source line.
+ *
+ ****************************************************************************************
+ */
+#ifndef _COROUTINE_H
+#define _COROUTINE_H
+
+#include <stdint.h>
+
+/* Resume point, the source line of the last wait. 0 starts from the top */
+typedef uint16_t Coroutine_t;
+
+typedef enum {
+    CO_WAITING = 0,
+    CO_DONE,
+} CoState_t;
+
+#define CO_INIT(co)                     do { *(co) = 0; } while (0)
+
+#define CO_BEGIN(co)                    switch (*(co)) { case 0:
+
+#define CO_END(co)                      } *(co) = 0; return CO_DONE
+
+/* Return to the caller until cond holds, cond is evaluated again on every call */
+#define CO_WAIT_UNTIL(co, cond)                                 \
+    do {                                                        \
+        *(co) = __LINE__;                                       \
+        /* FALLTHROUGH */                                       \
+        case __LINE__:                                          \
+        if (!(cond)) {                                          \
+            return CO_WAITING;                                  \
+        }                                                       \
+    } while (0)
+
+#endif  /* _COROUTINE_H */
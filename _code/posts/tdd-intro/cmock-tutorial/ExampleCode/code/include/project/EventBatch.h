@@ -0,0 +1,51 @@
+/**
+ ****************************************************************************************
+ *
+ * @file EventBatch.h
+ *
+ * @brief Bound how many queued events one wakeup drains, and count the batch sizes
+ *
+ * A wakeup keeps taking events until max_events were handled or the budget (in ticks)
+ * has run out, whichever comes first. The first event is always taken. Whatever is left
+ * waits for the next wakeup, so a burst cannot starve the rest of the task.
+ *
+ * Batch sizes go into a log2 histogram: bucket 0 counts empty wakeups, bucket n batches
+ * of 2^(n-1) up to 2^n - 1 events, the last bucket everything bigger.
+ *
+ ****************************************************************************************
+ */
+#ifndef _EVENT_BATCH_H
+#define _EVENT_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVENT_BATCH_BUCKETS     (6)
+
+typedef struct {
+    uint32_t wakeups;
+    uint32_t events;
+    uint32_t cut_short;                         // stopped with events still queued
+    uint16_t largest;
+    uint32_t histogram[EVENT_BATCH_BUCKETS];
+} EventBatchStats_t;
+
+typedef struct {
+    uint16_t max_events;
+    uint32_t budget;
+    uint32_t start;
+    uint16_t count;                             // events handled in the current batch
+    EventBatchStats_t stats;
+} EventBatch_t;
+
+void EventBatchInit(EventBatch_t *batch, uint16_t max_events, uint32_t budget);
+void EventBatchBegin(EventBatch_t *batch, uint32_t now);
+
+/* True if the batch may take another event */
+bool EventBatchNext(const EventBatch_t *batch, uint32_t now);
+void EventBatchHandled(EventBatch_t *batch);
+
+/* Close the batch, pending tells whether events are still queued */
+void EventBatchEnd(EventBatch_t *batch, bool pending);
+
+#endif  /* _EVENT_BATCH_H */
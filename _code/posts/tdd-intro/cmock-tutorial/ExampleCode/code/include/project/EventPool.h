@@ -0,0 +1,79 @@
+/**
+ ****************************************************************************************
+ *
+ * @file EventPool.h
+ *
+ * @brief Fixed-size buffers in a few size classes, for short-lived event messages
+ *
+ * The pool memory is carved into blocks once, at init. Each class keeps its free blocks
+ * in a singly linked list threaded through the blocks themselves, so allocating and
+ * freeing is a list pop or push and nothing ever fragments.
+ *
+ * A request goes to the smallest class that fits. When that class is empty the next
+ * bigger one is tried, which is counted as a spill; when none is left the request fails
+ * and counts as exhausted, and the caller decides what to fall back on.
+ *
+ ****************************************************************************************
+ */
+#ifndef _EVENT_POOL_H
+#define _EVENT_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define EVENT_POOL_MAX_CLASSES  (4)
+#define EVENT_POOL_MAX_BLOCKS   (32)    // per class, one bit each marks it in use
+
+/* Block sizes are rounded up to this, so every block can hold the free list link */
+#define EVENT_POOL_ALIGN        (sizeof(void *))
+#define EVENT_POOL_BLOCK_SIZE(size)     \
+    (((size) + EVENT_POOL_ALIGN - 1) / EVENT_POOL_ALIGN * EVENT_POOL_ALIGN)
+
+typedef struct {
+    uint16_t size;                      // bytes per block
+    uint16_t count;                     // blocks
+} EventPoolClassConfig_t;
+
+typedef struct {
+    uint32_t allocs;
+    uint32_t spills;                    // served by this class for a smaller request
+    uint32_t exhausted;                 // requests for this class nothing could serve
+    uint16_t in_use;
+    uint16_t peak;
+} EventPoolClassStats_t;
+
+typedef struct EventPoolBlock {
+    struct EventPoolBlock *next;
+} EventPoolBlock_t;
+
+typedef struct {
+    uint16_t          size;
+    uint16_t          count;
+    uint8_t          *base;
+    EventPoolBlock_t *free;
+    uint32_t          used;             // bit per block, in address order
+    EventPoolClassStats_t stats;
+} EventPoolClass_t;
+
+typedef struct {
+    uint8_t          classes;
+    EventPoolClass_t cls[EVENT_POOL_MAX_CLASSES];
+    uint32_t         too_big;           // requests bigger than the largest class
+} EventPool_t;
+
+/*
+ * Carve memory, which must be aligned for a pointer, into the classes given smallest
+ * first. Returns false if it is too short, the classes are not in order or one has more
+ * than EVENT_POOL_MAX_BLOCKS.
+ */
+bool EventPoolInit(EventPool_t *pool, void *memory, size_t len,
+                   const EventPoolClassConfig_t *config, uint8_t classes);
+
+/* NULL if no block of at least size bytes is left */
+void *EventPoolAlloc(EventPool_t *pool, size_t size);
+
+/* Returns false, and leaves it alone, if buf did not come from this pool or is free */
+bool EventPoolFree(EventPool_t *pool, void *buf);
+
+#endif  /* _EVENT_POOL_H */
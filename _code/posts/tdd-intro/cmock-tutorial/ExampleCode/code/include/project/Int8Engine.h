@@ -0,0 +1,69 @@
+/**
+ ****************************************************************************************
+ *
+ * @file Int8Engine.h
+ *
+ * @brief Minimal int8 inference kernels with fixed-shape tensors
+ *
+ * Tensors are plain multi-dimensional arrays whose shape is fixed at compile time,
+ * e.g. int8_t window[32][3]. Kernels take them as pointers to arrays, so the shape
+ * travels with the type instead of with a runtime descriptor.
+ *
+ * Quantization is symmetric (zero point 0) with power-of-two scales: every layer
+ * accumulates in int32 and requantizes with a rounding right shift.
+ *
+ ****************************************************************************************
+ */
+#ifndef _INT8_ENGINE_H
+#define _INT8_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Every tensor handed out by the arena starts on a word boundary */
+#define INT8_ARENA_ALIGN        (4)
+
+/* Output length of a valid (unpadded) 1-D convolution */
+#define INT8_CONV1D_OUT_LEN(in_len, kernel, stride) \
+            ( ((in_len) - (kernel)) / (stride) + 1 )
+
+/* Static tensor memory, reset before each inference */
+typedef struct {
+    uint8_t *base;
+    size_t   size;
+    size_t   used;
+    size_t   high_water;
+} Int8Arena_t;
+
+void    Int8ArenaInit(Int8Arena_t *arena, void *buffer, size_t size);
+void   *Int8ArenaAlloc(Int8Arena_t *arena, size_t size);
+void    Int8ArenaReset(Int8Arena_t *arena);
+
+int8_t  Int8Requantize(int32_t acc, uint8_t shift);
+
+/*
+ * output[o] = requant( bias[o] + sum_i input[i] * weights[o][i] ), bias may be NULL
+ */
+void    Int8Dense(int in_len, const int8_t input[in_len],
+                  int out_len, const int8_t weights[out_len][in_len],
+                  const int32_t *bias, uint8_t shift, bool relu,
+                  int8_t output[out_len]);
+
+/*
+ * Valid 1-D convolution over the time axis, channels last:
+ * output[t][o] = requant( bias[o] + sum_k sum_c input[t*stride + k][c] * weights[o][k][c] )
+ * output must hold INT8_CONV1D_OUT_LEN(in_len, kernel, stride) rows.
+ */
+void    Int8Conv1d(int in_len, int in_ch, const int8_t input[in_len][in_ch],
+                   int out_ch, int kernel, int stride,
+                   const int8_t weights[out_ch][kernel][in_ch],
+                   const int32_t *bias, uint8_t shift, bool relu,
+                   int8_t output[][out_ch]);
+
+/* Mean over the time axis, one value per channel */
+void    Int8GlobalAvgPool1d(int len, int ch, const int8_t input[len][ch], int8_t output[ch]);
+
+int     Int8ArgMax(int len, const int8_t values[len]);
+
+#endif  /* _INT8_ENGINE_H */
@@ -0,0 +1,60 @@
+/**
+ ****************************************************************************************
+ *
+ * @file LazySampler.h
+ *
+ * @brief Sample a sensor only when one of its reads finds the cached value stale
+ *
+ * A read within the staleness window is answered from the cache. An older one is parked
+ * until a new sample arrives; the first parked read starts the measurement and later
+ * ones just wait for the same sample.
+ *
+ ****************************************************************************************
+ */
+#ifndef _LAZY_SAMPLER_H
+#define _LAZY_SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SensorSample.h"
+
+#define LAZY_MAX_WAITERS        (4)     // parked reads, one per connection is enough
+
+typedef enum {
+    LAZY_READ_FRESH = 0,        // answer now from the cached value
+    LAZY_READ_DEFERRED,         // answer once LazySamplerSampled() or LazySamplerFailed() ran
+    LAZY_READ_REJECTED,         // no room to park the read
+} LazyRead_t;
+
+typedef struct {
+    SensorTime_t stale_after;
+    SensorTime_t last_sample;
+    bool         valid;
+    bool         pending;       // measurement requested, sample not in yet
+    uint8_t      num_waiting;
+    uint16_t     waiting[LAZY_MAX_WAITERS];
+} LazySampler_t;
+
+void        LazySamplerInit(LazySampler_t *sampler, SensorTime_t stale_after);
+
+/*
+ * Classify a read from conn_idx at time now. *start_measurement is set when the caller
+ * has to trigger a new measurement.
+ */
+LazyRead_t  LazySamplerRead(LazySampler_t *sampler, uint16_t conn_idx, SensorTime_t now,
+                            bool *start_measurement);
+
+/* Record a new sample and hand back the parked reads, returns their count */
+uint8_t     LazySamplerSampled(LazySampler_t *sampler, SensorTime_t timestamp,
+                               uint16_t waiting[LAZY_MAX_WAITERS]);
+
+/*
+ * The measurement failed: hand back the parked reads so they can be answered with an
+ * error, the cached value is kept. Returns their count.
+ */
+uint8_t     LazySamplerFailed(LazySampler_t *sampler, uint16_t waiting[LAZY_MAX_WAITERS]);
+
+/* Forget reads parked by a connection that went away */
+void        LazySamplerDrop(LazySampler_t *sampler, uint16_t conn_idx);
+
+#endif  /* _LAZY_SAMPLER_H */
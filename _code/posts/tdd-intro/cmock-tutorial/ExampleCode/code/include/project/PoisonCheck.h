@@ -0,0 +1,53 @@
+/**
+ ****************************************************************************************
+ *
+ * @file PoisonCheck.h
+ *
+ * @brief Verify poisoned memory areas a bounded slice at a time
+ *
+ * The areas are filled with a pattern nothing legitimate ever writes. Each step compares
+ * at most slice words against it and remembers where it stopped, so the cost of one call
+ * is bounded however big the areas are. A sweep over all areas starts every period ticks;
+ * once it is done the steps do nothing until the next one is due. Sweeps that take longer
+ * than the period, because the steps did not run often enough, are counted as overdue.
+ *
+ ****************************************************************************************
+ */
+#ifndef _POISON_CHECK_H
+#define _POISON_CHECK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define POISON_CHECK_MAX_AREAS  (4)
+
+typedef struct {
+    const uint32_t *start;
+    size_t          words;
+} PoisonArea_t;
+
+typedef struct {
+    uint32_t     pattern;
+    uint16_t     slice;                 // words per step
+    uint32_t     period;                // ticks from one sweep start to the next
+    uint8_t      count;
+    PoisonArea_t areas[POISON_CHECK_MAX_AREAS];
+    bool         sweeping;
+    uint8_t      area;                  // where the current sweep is
+    size_t       offset;
+    uint32_t     sweep_start;
+    uint32_t     sweeps;
+    uint32_t     overdue;
+    uint32_t     last_sweep;            // ticks the last sweep took
+} PoisonCheck_t;
+
+void PoisonCheckInit(PoisonCheck_t *chk, uint32_t pattern, uint16_t slice, uint32_t period);
+
+/* Fill area with the pattern and check it from now on. False if there are too many */
+bool PoisonCheckAddArea(PoisonCheck_t *chk, uint32_t *start, size_t words);
+
+/* Check the next slice. Returns false, with the address in *bad, on a corrupted word */
+bool PoisonCheckStep(PoisonCheck_t *chk, uint32_t now, const uint32_t **bad);
+
+#endif  /* _POISON_CHECK_H */
@@ -0,0 +1,48 @@
+/**
+ ****************************************************************************************
+ *
+ * @file PublishPolicy.h
+ *
+ * @brief Decide whether a new sample is worth publishing
+ *
+ * A sample is published when any channel moved by more than the absolute deadband or by
+ * more than the relative threshold against the last published value. With neither set,
+ * any change is published. min_interval rate-limits publishing, max_interval forces a
+ * publication as a heartbeat even when nothing changed.
+ *
+ ****************************************************************************************
+ */
+#ifndef _PUBLISH_POLICY_H
+#define _PUBLISH_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SensorSample.h"
+
+typedef struct {
+    uint16_t     deadband;              // sensor units, 0 = off
+    uint16_t     relative_permille;     // of the last published value, 0 = off
+    SensorTime_t min_interval;          // 0 = publish as often as it changes
+    SensorTime_t max_interval;          // 0 = no heartbeat
+} PublishPolicyConfig_t;
+
+typedef struct {
+    PublishPolicyConfig_t config;
+    uint8_t      channels;
+    bool         valid;                 // something was published already
+    SensorTime_t last_time;
+    int16_t      last[SENSOR_MAX_CHANNELS];
+    uint32_t     published;
+    uint32_t     suppressed;
+} PublishPolicy_t;
+
+void PublishPolicyInit(PublishPolicy_t *policy, const PublishPolicyConfig_t *config,
+                       uint8_t channels);
+
+/* Change the thresholds, the last published value is kept */
+void PublishPolicyConfigure(PublishPolicy_t *policy, const PublishPolicyConfig_t *config);
+
+/* Returns true if the sample should be published, and then remembers it as the last one */
+bool PublishPolicyCheck(PublishPolicy_t *policy, const SensorSample_t *sample);
+
+#endif  /* _PUBLISH_POLICY_H */
@@ -0,0 +1,77 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SampleBatch.h
+ *
+ * @brief Buffer timestamped samples and pack them into MTU-sized attribute payloads
+ *
+ * A packed payload starts with a small header followed by as many samples as fit:
+ *
+ *   | count (u8) | channels (u8) | base timestamp (u32) |
+ *   | dt (u16) | value[0] (s16) ... value[channels-1] (s16) | ...
+ *
+ * Everything is little endian. dt is the sample timestamp minus the base timestamp, which
+ * is the timestamp of the first sample in the payload.
+ *
+ ****************************************************************************************
+ */
+#ifndef _SAMPLE_BATCH_H
+#define _SAMPLE_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "SensorSample.h"
+
+#define SAMPLE_BATCH_LEN            (32)    // buffered samples per stream
+#define SAMPLE_BATCH_HEADER_LEN     (6)
+
+/* Byte size of one packed sample with the given channel count */
+#define SAMPLE_BATCH_SAMPLE_LEN(channels)   ( sizeof(uint16_t) * (1 + (channels)) )
+
+/*
+ * Per-packet overhead used for the efficiency figures: ATT opcode + handle, L2CAP header,
+ * and for each link layer PDU preamble, access address, LL header and CRC.
+ */
+#define SAMPLE_BATCH_ATT_OVERHEAD   (3)
+#define SAMPLE_BATCH_L2CAP_OVERHEAD (4)
+#define SAMPLE_BATCH_LL_OVERHEAD    (1 + 4 + 2 + 3)
+
+typedef struct {
+    SensorSample_t samples[SAMPLE_BATCH_LEN];       // ring, oldest overwritten first
+    uint8_t        head;                            // slot of the oldest sample
+    uint8_t        count;
+    uint8_t        channels;
+    uint32_t       dropped;                         // overwritten before being sent
+} SampleBatch_t;
+
+typedef struct {
+    uint32_t pdus;
+    uint32_t samples;
+    uint32_t payload_bytes;     // timestamps and values delivered to the central
+    uint32_t air_bytes;         // everything that went over the air for them
+} SampleBatchStats_t;
+
+void    SampleBatchInit(SampleBatch_t *batch, uint8_t channels);
+void    SampleBatchPush(SampleBatch_t *batch, const SensorSample_t *sample);
+void    SampleBatchConsume(SampleBatch_t *batch, uint8_t count);
+
+/* Number of samples that fit into a payload of max_len bytes */
+uint8_t SampleBatchCapacity(const SampleBatch_t *batch, size_t max_len);
+
+/*
+ * Pack samples starting at the first-th oldest one into pdu. Packing stops when the
+ * payload is full, the buffer is exhausted or a dt would not fit into 16 bits.
+ * Returns the payload length and the number of packed samples in *packed.
+ */
+size_t  SampleBatchPack(const SampleBatch_t *batch, uint8_t first, uint8_t *pdu,
+                        size_t max_len, uint8_t *packed);
+
+/* Account for one payload carried in LL PDUs of at most ll_octets bytes */
+void    SampleBatchAccount(SampleBatchStats_t *stats, const SampleBatch_t *batch,
+                           size_t pdu_len, uint8_t packed, uint16_t ll_octets);
+
+/* Payload bytes per air byte, in permille */
+uint16_t SampleBatchEfficiency(const SampleBatchStats_t *stats);
+
+#endif  /* _SAMPLE_BATCH_H */
@@ -0,0 +1,48 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SampleLog.h
+ *
+ * @brief Sample history kept as fixed-size records in a byte ring
+ *
+ * Every record is stored already serialized, so a download can hand the storage itself
+ * to the transport. A record is:
+ *
+ *   | timestamp (u32) | source (u8) | channels (u8) | value[0..2] (s16) |
+ *
+ * little endian, unused values are zero. Records are addressed by their absolute byte
+ * offset since the log was initialized, which stays valid across wraps of the ring and
+ * lets an interrupted download resume where it stopped.
+ *
+ ****************************************************************************************
+ */
+#ifndef _SAMPLE_LOG_H
+#define _SAMPLE_LOG_H
+
+#include <stdint.h>
+#include "SensorSample.h"
+
+#define SAMPLE_LOG_RECORD_LEN   (4 + 1 + 1 + SENSOR_MAX_CHANNELS * sizeof(int16_t))
+
+typedef struct {
+    uint8_t  *storage;      // size bytes, a multiple of SAMPLE_LOG_RECORD_LEN
+    uint32_t size;
+    uint32_t head;          // offset the next record is written at
+    uint32_t tail;          // offset of the oldest record still stored
+} SampleLog_t;
+
+void     SampleLogInit(SampleLog_t *log, uint8_t *storage, uint32_t size);
+
+/* Append one record, overwriting the oldest one when the ring is full */
+void     SampleLogAppend(SampleLog_t *log, uint8_t source, uint8_t channels,
+                         const SensorSample_t *sample);
+
+/*
+ * Contiguous stored bytes starting at *offset, without copying them. An offset that was
+ * overwritten already moves up to the oldest record, one in the middle of a record moves
+ * back to its start; *offset is updated accordingly. Returns 0 once *offset reached the
+ * newest data.
+ */
+uint32_t SampleLogPeek(const SampleLog_t *log, uint32_t *offset, const uint8_t **data);
+
+#endif  /* _SAMPLE_LOG_H */
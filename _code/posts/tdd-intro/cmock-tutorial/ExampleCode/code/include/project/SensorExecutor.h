@@ -0,0 +1,109 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SensorExecutor.h
+ *
+ * @brief One task running every sensor driver as a stackless coroutine
+ *
+ * Each driver registers a thread, a coroutine (see Coroutine.h) that suspends in one of
+ * four waits:
+ *
+ *   SENSOR_WAIT_EVENT  until another task signals one of the given event bits
+ *   SENSOR_DELAY       for a number of ticks
+ *   SENSOR_I2C_TAKE    until no other thread holds the I2C bus, then holds it
+ *   SENSOR_I2C_READ    until an asynchronous I2C write/read completes, check i2c_error
+ *
+ * The bus lock of the I2C adapter lets the task that owns it in again, so it does not keep
+ * two threads of this one task apart. A thread holds the bus from SENSOR_I2C_TAKE to
+ * SENSOR_I2C_GIVE around everything it does on it, synchronous accesses included, and
+ * only issues SENSOR_I2C_READ in between.
+ *
+ * The executor task sleeps until something a thread waits for happened, then runs the
+ * threads once each. Drivers share this one stack instead of owning a task each, and a
+ * driver handing work to another one no longer costs a context switch.
+ *
+ ****************************************************************************************
+ */
+#ifndef _SENSOR_EXECUTOR_H
+#define _SENSOR_EXECUTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <osal.h>
+#include "ad_i2c.h"
+#include "def.h"
+#include "Coroutine.h"
+
+#ifndef SENSOR_EXECUTOR_STACK_SIZE
+#define SENSOR_EXECUTOR_STACK_SIZE      (400)
+#endif
+
+typedef struct SensorThread SensorThread_t;
+typedef CoState_t (* SensorThreadFn_t) (SensorThread_t *thread);
+
+struct SensorThread {
+    Coroutine_t      co;
+    SensorThreadFn_t run;
+    SensorThread_t  *next;
+    uint32_t         events;            // signalled and not taken yet
+    bool             delayed;
+    OS_TICK_TIME     delay_start;
+    OS_TICK_TIME     delay;
+    volatile bool    i2c_busy;
+    uint16_t         i2c_error;         // abort source of the last transfer, 0 = OK, the
+                                        // read buffer holds garbage otherwise
+};
+
+/* Create the executor task, before any driver adds its thread */
+void SensorExecutorInit(void);
+
+/* Start running a thread, from its top */
+void SensorExecutorAdd(SensorThread_t *thread, SensorThreadFn_t run);
+
+/* The executor task, for stack monitoring */
+OS_TASK SensorExecutorGetTask(void);
+
+/* Set event bits of a thread and wake the executor. Any task may call it */
+void SensorExecutorSignal(SensorThread_t *thread, uint32_t events);
+
+/*
+ * Helpers of the wait macros. SensorThreadTakeEvents() returns and clears the pending
+ * events in mask, 0 if there are none.
+ */
+uint32_t SensorThreadTakeEvents(SensorThread_t *thread, uint32_t mask);
+void     SensorThreadStartDelay(SensorThread_t *thread, OS_TICK_TIME ticks);
+bool     SensorThreadDelayOver(SensorThread_t *thread);
+void     SensorThreadStartI2cRead(SensorThread_t *thread, i2c_device dev, const uint8_t *wbuf,
+                                  size_t wlen, uint8_t *rbuf, size_t rlen);
+bool     SensorThreadTakeBus(SensorThread_t *thread);
+
+/* Let the other threads on the bus, a no-op if the thread does not hold it */
+void     SensorThreadGiveBus(SensorThread_t *thread);
+
+/* Waits, only valid in a thread function. Store what must survive them outside of locals */
+#define SENSOR_WAIT_EVENT(thread, mask, events)                                     \
+    CO_WAIT_UNTIL(&(thread)->co, ((events) = SensorThreadTakeEvents((thread), (mask))) != 0)
+
+#define SENSOR_DELAY(thread, ticks)                                                 \
+    do {                                                                            \
+        SensorThreadStartDelay((thread), (ticks));                                  \
+        CO_WAIT_UNTIL(&(thread)->co, SensorThreadDelayOver(thread));                \
+    } while (0)
+
+#define SENSOR_I2C_TAKE(thread)                                                     \
+    CO_WAIT_UNTIL(&(thread)->co, SensorThreadTakeBus(thread))
+
+#define SENSOR_I2C_GIVE(thread)         SensorThreadGiveBus(thread)
+
+#define SENSOR_I2C_READ(thread, dev, wbuf, wlen, rbuf, rlen)                        \
+    do {                                                                            \
+        SensorThreadStartI2cRead((thread), (dev), (wbuf), (wlen), (rbuf), (rlen));  \
+        CO_WAIT_UNTIL(&(thread)->co, !(thread)->i2c_busy);                          \
+    } while (0)
+
+/* One pass over the threads. Returns the ticks until a delay runs out */
+STATIC OS_TICK_TIME SensorExecutorRun(void);
+STATIC void SensorExecutorI2cDone(void *user_data, HW_I2C_ABORT_SOURCE error);
+
+#endif  /* _SENSOR_EXECUTOR_H */
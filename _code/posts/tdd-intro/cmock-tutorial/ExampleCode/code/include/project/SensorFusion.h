@@ -0,0 +1,50 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SensorFusion.h
+ *
+ * @brief Align temperature and accelerometer samples onto one timeline
+ *
+ * Each stream keeps a short history of timestamped samples. Frames are produced on a
+ * fixed grid (multiples of the frame period); the value of every stream at a grid point
+ * is linearly interpolated between the two samples around it. A frame is held back until
+ * every stream has reached its time, or until the newest sample is more than the maximum
+ * lag ahead, in which case the lagging streams are held and flagged as stale. A grid point
+ * older than everything left in a stream's history gets its oldest sample, also flagged.
+ *
+ ****************************************************************************************
+ */
+#ifndef _SENSOR_FUSION_H
+#define _SENSOR_FUSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SensorSample.h"
+#include "SampleBatch.h"
+#include "def.h"
+
+/* A whole FIFO drain arrives at once, plus the sample before it to bracket its first one */
+#define FUSION_HISTORY_LEN      (SAMPLE_BATCH_LEN + 1)
+
+typedef enum {
+    SENSOR_STREAM_TEMPERATURE = 0,
+    SENSOR_STREAM_ACCELERATION,
+    SENSOR_STREAMS,
+} SensorStream_t;
+
+typedef struct {
+    SensorTime_t timestamp;
+    int16_t      temperature;
+    int16_t      acceleration[3];
+    uint8_t      stale_mask;        // (1 << stream) when the stream had to be held
+} SensorFrame_t;
+
+typedef void (* SensorFrameCb_t) (const SensorFrame_t *frame);
+
+void SensorFusionInit(SensorTime_t frame_period, SensorTime_t max_lag, SensorFrameCb_t cb);
+void SensorFusionPush(SensorStream_t stream, const SensorSample_t *sample);
+
+STATIC int16_t Interpolate(const SensorSample_t *a, const SensorSample_t *b,
+                           SensorTime_t t, int channel);
+
+#endif  /* _SENSOR_FUSION_H */
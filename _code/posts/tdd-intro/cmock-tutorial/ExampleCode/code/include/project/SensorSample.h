@@ -0,0 +1,31 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SensorSample.h
+ *
+ * @brief Timestamped sample shared between the sensor drivers and their consumers
+ *
+ ****************************************************************************************
+ */
+#ifndef _SENSOR_SAMPLE_H
+#define _SENSOR_SAMPLE_H
+
+#include <stdint.h>
+
+/* RTOS ticks, taken when the I2C transaction that produced the sample completed */
+typedef uint32_t SensorTime_t;
+
+#define SENSOR_MAX_CHANNELS     (3)
+
+typedef struct {
+    SensorTime_t timestamp;
+    int16_t      value[SENSOR_MAX_CHANNELS];
+} SensorSample_t;
+
+/* Called from the sensor executor right after a new sample has been stored */
+typedef void (* SensorSampleCb_t) (void);
+
+/* Wrap-safe "a is at or after b" for tick timestamps */
+#define SENSOR_TIME_AFTER_EQ(a, b)      ( (int32_t)((SensorTime_t)(a) - (SensorTime_t)(b)) >= 0 )
+
+#endif  /* _SENSOR_SAMPLE_H */
@@ -0,0 +1,49 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SensorSnapshot.h
+ *
+ * @brief Latest value of every sensor packed into one characteristic value
+ *
+ * Gateways that always read everything get it in a single read:
+ *
+ *   | version (u8) | valid mask (u8) |
+ *   | temperature: timestamp (u32) | value (s16) |
+ *   | acceleration: timestamp (u32) | x, y, z (s16) |
+ *   | tilt: timestamp (u32) | pitch, roll, tilt (s16) | magnitude (u16) |
+ *   | activity: timestamp (u32) | label (u8) |
+ *   | frame: timestamp (u32) | temperature (s16) | x, y, z (s16) | stale mask (u8) |
+ *
+ * The frame is the newest output of SensorFusion, every stream at the same grid point.
+ * Everything is little endian, timestamps are RTOS ticks like in the batched payloads.
+ * A field is only meaningful once its bit is set in the valid mask. Later versions only
+ * ever append fields, readers skip what they do not know.
+ *
+ ****************************************************************************************
+ */
+#ifndef _SENSOR_SNAPSHOT_H
+#define _SENSOR_SNAPSHOT_H
+
+#include <stdint.h>
+#include "SensorSample.h"
+#include "TiltEstimator.h"
+#include "SensorFusion.h"
+
+#define SENSOR_SNAPSHOT_LEN         (48)
+#define SENSOR_SNAPSHOT_VERSION     (2)
+
+/* Bits of the valid mask */
+#define SNAPSHOT_TEMPERATURE        (1 << 0)
+#define SNAPSHOT_ACCELERATION       (1 << 1)
+#define SNAPSHOT_TILT               (1 << 2)
+#define SNAPSHOT_ACTIVITY           (1 << 3)
+#define SNAPSHOT_FRAME              (1 << 4)
+
+void SensorSnapshotInit(uint8_t *pdu);
+void SensorSnapshotSetTemperature(uint8_t *pdu, const SensorSample_t *sample);
+void SensorSnapshotSetAcceleration(uint8_t *pdu, const SensorSample_t *sample);
+void SensorSnapshotSetTilt(uint8_t *pdu, SensorTime_t timestamp, const Tilt_t *tilt);
+void SensorSnapshotSetActivity(uint8_t *pdu, SensorTime_t timestamp, uint8_t label);
+void SensorSnapshotSetFrame(uint8_t *pdu, const SensorFrame_t *frame);
+
+#endif  /* _SENSOR_SNAPSHOT_H */
@@ -0,0 +1,60 @@
+/**
+ ****************************************************************************************
+ *
+ * @file StackMonitor.h
+ *
+ * @brief Track the stack high-water mark of tasks and suggest right-sized stacks
+ *
+ * The kernel paints every stack at creation, the measure function returns how many bytes
+ * at the far end are still untouched (uxTaskGetStackHighWaterMark() in bytes). That is a
+ * scan of the unused part, so each step measures one task only, round robin, and the
+ * lowest value seen per task is kept.
+ *
+ * The suggested size is the peak use plus a margin, rounded up to 8 bytes; peak use only
+ * covers the paths that ran, so the margin should cover the ones that did not.
+ *
+ ****************************************************************************************
+ */
+#ifndef _STACK_MONITOR_H
+#define _STACK_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STACK_MONITOR_MAX_TASKS (4)
+
+/* Packed: task count, then size and peak use in bytes per task, u16 little endian each */
+#define STACK_MONITOR_PDU_LEN   (1 + 4 * STACK_MONITOR_MAX_TASKS)
+
+typedef uint32_t (* StackMonitorMeasure_t) (void *task);
+
+typedef struct {
+    const char *name;
+    void       *task;
+    uint16_t    size;                   // bytes
+    uint16_t    min_free;               // fewest untouched bytes seen
+    bool        measured;
+} StackMonitorEntry_t;
+
+typedef struct {
+    StackMonitorMeasure_t measure;
+    uint8_t             count;
+    uint8_t             next;
+    StackMonitorEntry_t tasks[STACK_MONITOR_MAX_TASKS];
+} StackMonitor_t;
+
+void StackMonitorInit(StackMonitor_t *mon, StackMonitorMeasure_t measure);
+
+/* Returns false if STACK_MONITOR_MAX_TASKS are watched already */
+bool StackMonitorAdd(StackMonitor_t *mon, const char *name, void *task, uint16_t size);
+
+/* Measure the next task, returns it or NULL if there are none */
+const StackMonitorEntry_t *StackMonitorStep(StackMonitor_t *mon);
+
+/* Peak use in bytes, 0 until measured */
+uint16_t StackMonitorUsed(const StackMonitorEntry_t *entry);
+uint16_t StackMonitorSuggest(const StackMonitorEntry_t *entry, uint8_t margin_percent);
+
+void StackMonitorPack(const StackMonitor_t *mon, uint8_t *pdu);
+
+#endif  /* _STACK_MONITOR_H */
@@ -22,10 +22,15 @@
 #include <osal.h>
 #include "ad_i2c.h"
 #include "def.h"
+#include "SensorSample.h"
+#include "SensorExecutor.h"
 
 void DoMeasurementTemperature(void);
 void InitTemperatureSensorDriver(void);
-STATIC void     TemperatureDriverTask(void *param);
+void TemperatureDriverRegisterSampleCb(SensorSampleCb_t cb);
+void TemperatureDriverRegisterFailCb(SensorSampleCb_t cb);
+void TemperatureDriverGetSample(SensorSample_t *sample);
+STATIC CoState_t TemperatureDriverThread(SensorThread_t *t);
 STATIC int16_t  ReadTemperatureFromI2C(void);
 STATIC void     ReadSensorRegisters( uint8_t *RegisterWithMSB, uint8_t *RegisterWithLSB);
 STATIC int16_t  ConvertTemperatureFromRegisters(uint8_t RegisterMostSignificantByte,
@@ -0,0 +1,46 @@
+/**
+ ****************************************************************************************
+ *
+ * @file TiltEstimator.h
+ *
+ * @brief Fixed-point pitch, roll and tilt from accelerometer XYZ
+ *
+ * All trigonometry is integer CORDIC (vectoring mode), no libm and no floating point.
+ * Angles are in centidegrees. Inputs are calibrated raw samples: the per-axis offsets
+ * set with TiltEstimatorSetOffsets() are removed before the angles are derived.
+ *
+ ****************************************************************************************
+ */
+#ifndef _TILT_ESTIMATOR_H
+#define _TILT_ESTIMATOR_H
+
+#include <stdint.h>
+#include "def.h"
+
+#define TILT_CENTIDEG_180       (18000)
+
+/* Iterations of the CORDIC loop, the residual error is about atan(2^-15) */
+#define CORDIC_ITERATIONS       (16)
+
+typedef struct {
+    int16_t pitch;              // rotation about Y, -9000..9000
+    int16_t roll;               // rotation about X, -18000..18000
+    int16_t tilt;               // angle between Z and gravity, 0..18000
+    uint16_t magnitude;         // |XYZ| in raw LSB, ~16384 at rest
+} Tilt_t;
+
+/* Inputs must fit in 17 signed bits */
+int32_t  CordicAtan2(int32_t y, int32_t x);
+uint32_t CordicHypot(int32_t x, int32_t y);
+
+/*
+ * filter_shift selects the complementary low-pass filter: every update moves the output
+ * 1/2^filter_shift of the way towards the new angle. 0 disables filtering.
+ */
+void TiltEstimatorInit(uint8_t filter_shift);
+void TiltEstimatorSetOffsets(const int16_t offsets[3]);
+void TiltEstimatorUpdate(const int16_t xyz[3], Tilt_t *out);
+
+STATIC int32_t WrapAngle(int32_t angle, int32_t half_turn);
+
+#endif  /* _TILT_ESTIMATOR_H */
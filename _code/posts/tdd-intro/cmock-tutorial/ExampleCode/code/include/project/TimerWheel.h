@@ -0,0 +1,79 @@
+/**
+ ****************************************************************************************
+ *
+ * @file TimerWheel.h
+ *
+ * @brief Hierarchical timer wheel running periodic jobs off a single wakeup source
+ *
+ * Jobs are kept in three levels of 64 slots. A level 0 slot spans `resolution` ticks,
+ * every further level 64 times more, so about 262000 slots are covered; jobs due later
+ * are parked in the last slot and re-filed as the wheel turns. Starting and stopping a job
+ * is O(1), and a job only moves between levels when its slot comes close.
+ *
+ * Every job has a period, an alignment and a slack. The first expiry is rounded up to a
+ * multiple of the alignment and later ones follow at the period, so jobs whose periods
+ * are multiples of the alignment stay in phase. A job may run up to slack ticks late.
+ * TimerWheelNextWakeup() returns the latest time at which every job still meets its
+ * slack, and TimerWheelAdvance() then runs every job already due, so jobs whose windows
+ * overlap share one wakeup. Lateness is bounded by the larger of the slack and the
+ * resolution.
+ *
+ * Times are RTOS ticks and may wrap. The wheel is not thread safe, it belongs to the task
+ * that advances it.
+ *
+ ****************************************************************************************
+ */
+#ifndef _TIMER_WHEEL_H
+#define _TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_WHEEL_BITS        (6)
+#define TIMER_WHEEL_SLOTS       (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS      (3)
+
+typedef struct TimerJob TimerJob_t;
+
+/* Runs from TimerWheelAdvance(), the job is already re-filed for its next period */
+typedef void (* TimerJobCb_t) (TimerJob_t *job);
+
+struct TimerJob {
+    TimerJob_t  *next;
+    TimerJob_t **pprev;                 // NULL while the job is stopped
+    uint32_t     due;                   // ticks
+    uint32_t     expires;               // wheel slot it is filed for
+    uint32_t     period;
+    uint32_t     align;                 // phase of the first expiry, 0 or 1 = none
+    uint32_t     slack;
+    TimerJobCb_t cb;
+};
+
+typedef struct {
+    uint32_t    resolution;             // ticks per level 0 slot
+    uint32_t    current;                // next slot to run
+    uint32_t    base;                   // tick at which the current slot runs
+    TimerJob_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint32_t    wakeups;                // advances that ran at least one job
+    uint32_t    fired;
+} TimerWheel_t;
+
+void TimerWheelInit(TimerWheel_t *wheel, uint32_t resolution, uint32_t now);
+void TimerJobInit(TimerJob_t *job, uint32_t period, uint32_t align, uint32_t slack,
+                  TimerJobCb_t cb);
+
+/* Schedule the job one period from now, restarting it if it was running */
+void TimerWheelStart(TimerWheel_t *wheel, TimerJob_t *job, uint32_t now);
+void TimerWheelStop(TimerWheel_t *wheel, TimerJob_t *job);
+bool TimerWheelRunning(const TimerJob_t *job);
+
+/* Change the period, a running job restarts from now with the new one */
+void TimerWheelSetPeriod(TimerWheel_t *wheel, TimerJob_t *job, uint32_t period, uint32_t now);
+
+/* Run every job due by now. Returns how many ran */
+uint16_t TimerWheelAdvance(TimerWheel_t *wheel, uint32_t now);
+
+/* Latest tick to advance the wheel at. Returns false if no job is running */
+bool TimerWheelNextWakeup(const TimerWheel_t *wheel, uint32_t *when);
+
+#endif  /* _TIMER_WHEEL_H */
@@ -0,0 +1,52 @@
+/**
+ ****************************************************************************************
+ *
+ * @file app_rtos.h
+ *
+ * @brief Task and timer creation of the application, from the heap or static memory
+ *
+ * APP_TASK_CREATE() and APP_TIMER_CREATE() take the arguments of OS_TASK_CREATE() and
+ * OS_TIMER_CREATE(). With CFG_STATIC_RTOS_OBJECTS set in the custom config, each call
+ * site gets its own static stack and control block instead, so all of it shows up in
+ * the map file and nothing comes from the heap at startup. The SDK's own tasks still
+ * use the heap.
+ *
+ * Every call site creates one object, a site that runs twice would hand the same memory
+ * out again.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef APP_RTOS_H_
+#define APP_RTOS_H_
+
+#include <osal.h>
+
+#if CFG_STATIC_RTOS_OBJECTS
+
+/* Evaluates to OS_TASK_CREATE_SUCCESS or pdFAIL, like OS_TASK_CREATE() */
+#define APP_TASK_CREATE(name, task_func, arg, stack_size, priority, task)                \
+        ({                                                                              \
+                static StackType_t _stack[(stack_size) / sizeof(StackType_t)];          \
+                static StaticTask_t _tcb;                                               \
+                (task) = xTaskCreateStatic((task_func), (name),                         \
+                                sizeof(_stack) / sizeof(_stack[0]), (arg), (priority),  \
+                                _stack, &_tcb);                                         \
+                (task) ? OS_TASK_CREATE_SUCCESS : pdFAIL;                               \
+        })
+
+#define APP_TIMER_CREATE(name, period, reload, timer_id, callback)                      \
+        ({                                                                              \
+                static StaticTimer_t _timer;                                            \
+                xTimerCreateStatic((name), (period), (reload), (timer_id), (callback),  \
+                                                                        &_timer);       \
+        })
+
+#else
+
+#define APP_TASK_CREATE         OS_TASK_CREATE
+#define APP_TIMER_CREATE        OS_TIMER_CREATE
+
+#endif /* CFG_STATIC_RTOS_OBJECTS */
+
+#endif /* APP_RTOS_H_ */
@@ -0,0 +1,78 @@
+/**
+ ****************************************************************************************
+ *
+ * @file history_transfer.h
+ *
+ * @brief Bulk download of the sample history over an L2CAP connection-oriented channel
+ *
+ * The central opens a channel on CFG_HISTORY_PSM and sends a request SDU:
+ *
+ *   | 0x01 | offset (u32) |
+ *
+ * The device answers with | 0x81 | start offset (u32) | end offset (u32) |, followed by the
+ * raw log records (see SampleLog.h) from start up to end, split into SDUs of at most the
+ * channel MTU, and finally | 0x82 | end offset (u32) |. Record bytes may be split across
+ * SDUs, which are sent as long as the central grants credits. A central that lost the link
+ * asks again with the offset it got to, offsets that were overwritten meanwhile start at
+ * the oldest stored record. If the log overwrites records during a download before they
+ * were sent, the device closes the channel so that the central asks again in the same way.
+ *
+ ****************************************************************************************
+ */
+#ifndef HISTORY_TRANSFER_H_
+#define HISTORY_TRANSFER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ble_common.h"
+#include "SensorSample.h"
+
+#define HISTORY_OP_REQUEST      (0x01)
+#define HISTORY_OP_START        (0x81)
+#define HISTORY_OP_END          (0x82)
+
+/* Throughput counter, the current transfer is included while it runs */
+typedef struct {
+        uint32_t transfers;
+        uint32_t aborted;               // closed because the log overtook the download
+        uint32_t bytes;                 // record bytes sent in the last transfer
+        uint32_t duration_ms;           // from request to the last record being sent
+        uint32_t bytes_per_s;
+} history_stats_t;
+
+/*
+ * \brief Set up the history log, must be called before samples are logged
+ */
+void history_init(void);
+
+/*
+ * \brief Append one sample to the history log
+ *
+ * \param [in] source           stream the sample belongs to, stored along with it
+ * \param [in] channels         valid values in the sample
+ * \param [in] sample           the sample
+ */
+void history_log_sample(uint8_t source, uint8_t channels, const SensorSample_t *sample);
+
+/*
+ * \brief Accept channels from a new central, called on BLE_EVT_GAP_CONNECTED
+ */
+void history_listen(uint16_t conn_idx);
+
+/*
+ * \brief Handle the L2CAP events of the history channel
+ *
+ * \return true if the event was handled
+ */
+bool history_handle_event(const ble_evt_hdr_t *hdr);
+
+void history_get_stats(history_stats_t *stats);
+
+/*
+ * \brief Bytes sent to the central since the previous call
+ *
+ * \return true while a download to the central is running
+ */
+bool history_take_activity(uint16_t conn_idx, uint32_t *bytes);
+
+#endif /* HISTORY_TRANSFER_H_ */
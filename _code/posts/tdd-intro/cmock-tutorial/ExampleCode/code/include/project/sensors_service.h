@@ -2,23 +2,139 @@
 #include <ble_service.h>
 #include "TemperatureDriver.h"
 #include "AccelerometerDriver.h"
+#include "TiltEstimator.h"
+#include "SampleBatch.h"
+#include "ConnectionTable.h"
+#include "SensorSnapshot.h"
+#include "StackMonitor.h"
+#include "ble_peripheral_config.h"
+
+/*
+ * Largest temperature/accelerometer value: an ATT MTU of 247 leaves 244 bytes per
+ * notification, which together with L2CAP fills one 251-byte LL data PDU.
+ */
+#define SENSORS_MAX_PAYLOAD_LEN         (244)
+
+/* Link defaults until the central agrees to something bigger */
+#define SENSORS_DEFAULT_ATT_MTU         (23)
+#define SENSORS_DEFAULT_LL_OCTETS       (27)
+
+/* pitch, roll, tilt (centidegrees) and magnitude, little endian */
+#define SENSORS_TILT_VALUE_LEN          (4 * sizeof(uint16_t))
+
+/*
+ * Characteristics of the service, in attribute database order:
+ *
+ *   X(name, user description, maximum value length, forward reads, 128-bit UUID bytes as
+ *     written in the string form)
+ *
+ * Reads of a characteristic with "forward reads" set always go to the application, even
+ * when the other values are served from the attribute database (lazy sampling).
+ *
+ * The list expands into sensors_char_t and into the compile-time attribute table of the
+ * service. The demo sensors from platform_devices.h get a characteristic when they are
+ * enabled in the custom config, raw acceleration only with CFG_RAW_ACCELERATION.
+ */
+#define SENSORS_CHARACTERISTICS(X) \
+        X(TEMPERATURE, "Read temperature values", SENSORS_MAX_PAYLOAD_LEN, CFG_TEMP_LAZY_SAMPLING, \
+          0x11, 0x11, 0x11, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11) \
+        SENSORS_ACCELERATION_CHARACTERISTIC(X) \
+        X(ACTIVITY, "Read activity label", sizeof(uint8_t), 0, \
+          0x33, 0x33, 0x33, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33) \
+        X(TILT, "Read pitch, roll, tilt and magnitude", SENSORS_TILT_VALUE_LEN, 0, \
+          0x22, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x23) \
+        SENSORS_BME280_CHARACTERISTIC(X) \
+        SENSORS_BMM150_CHARACTERISTIC(X) \
+        SENSORS_BMG160_CHARACTERISTIC(X) \
+        SENSORS_BH1750_CHARACTERISTIC(X)
+
+#if CFG_RAW_ACCELERATION
+#define SENSORS_ACCELERATION_CHARACTERISTIC(X) \
+        X(ACCELERATION, "Read accelerometer values", SENSORS_MAX_PAYLOAD_LEN, 0, \
+          0x22, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22)
+#else
+#define SENSORS_ACCELERATION_CHARACTERISTIC(X)
+#endif
+
+#if CFG_DEMO_SENSOR_BME280
+#define SENSORS_BME280_CHARACTERISTIC(X) \
+        X(BME280, "Read temperature, pressure and humidity", SENSORS_MAX_PAYLOAD_LEN, 0, \
+          0x44, 0x44, 0x44, 0x44, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44)
+#else
+#define SENSORS_BME280_CHARACTERISTIC(X)
+#endif
+
+#if CFG_DEMO_SENSOR_BMM150
+#define SENSORS_BMM150_CHARACTERISTIC(X) \
+        X(BMM150, "Read magnetometer values", SENSORS_MAX_PAYLOAD_LEN, 0, \
+          0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55)
+#else
+#define SENSORS_BMM150_CHARACTERISTIC(X)
+#endif
+
+#if CFG_DEMO_SENSOR_BMG160
+#define SENSORS_BMG160_CHARACTERISTIC(X) \
+        X(BMG160, "Read gyroscope values", SENSORS_MAX_PAYLOAD_LEN, 0, \
+          0x66, 0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66)
+#else
+#define SENSORS_BMG160_CHARACTERISTIC(X)
+#endif
+
+#if CFG_DEMO_SENSOR_BH1750
+#define SENSORS_BH1750_CHARACTERISTIC(X) \
+        X(BH1750, "Read ambient light values", SENSORS_MAX_PAYLOAD_LEN, 0, \
+          0x77, 0x77, 0x77, 0x77, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77)
+#else
+#define SENSORS_BH1750_CHARACTERISTIC(X)
+#endif
+
+#define SENSORS_CHAR_ENUM(name, ...)    SENSORS_CHAR_##name,
+
+typedef enum {
+        SENSORS_CHARACTERISTICS(SENSORS_CHAR_ENUM)
+        SENSORS_CHAR_COUNT,
+} sensors_char_t;
+
+/*
+ * Run-time configuration of one characteristic, written by a central through the
+ * configuration characteristic as { characteristic (u8), config } with the config packed
+ * little endian in field order, SENSORS_CONFIG_LEN bytes. Reads return the packed configs
+ * of all characteristics. Fields a sensor does not support must be 0.
+ */
+typedef struct {
+        uint32_t period_ms;             // sampling period, 0 = not sampled on a timer
+        uint8_t  odr;                   // sensor output data rate code
+        uint8_t  fifo_watermark;        // samples collected in the sensor FIFO, 0 = FIFO off
+        uint16_t deadband;              // publish policy, see PublishPolicy.h
+        uint16_t relative_permille;
+        uint32_t min_interval_ms;
+        uint32_t max_interval_ms;
+} sensors_config_t;
+
+#define SENSORS_CONFIG_LEN              (18)
 
 /* User-defined callback functions - Prototyping */
-typedef void (* sensor_get_int_value_cb_t) (ble_service_t *svc, uint16_t conn_idx);
+typedef void (* sensor_get_value_cb_t) (ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch);
+typedef att_error_t (* sensor_set_config_cb_t) (ble_service_t *svc, uint16_t conn_idx,
+                                                sensors_char_t ch, const sensors_config_t *config);
 
 
 /* User-defined callback functions */
 typedef struct {
         /* Handler for read requests - Triggered on application context */
-        sensor_get_int_value_cb_t temp_get_characteristic_value;
-        sensor_get_int_value_cb_t acc_get_characteristic_value;
+        sensor_get_value_cb_t get_value[SENSORS_CHAR_COUNT];
+
+        /*
+         * Handler for configuration writes - Triggered on application context. Applies the
+         * config and returns ATT_ERROR_OK, or an ATT error to reject it.
+         */
+        sensor_set_config_cb_t set_config;
 } sensors_service_cb_t;
 
 
 /*
  * \brief This function creates the custom BLE service and registers it in BLE framework
  *
- * \param [in] variable_value Default characteristic value
  * \param [in] cb             Application callback functions
  *
  * \return service handle
@@ -29,11 +145,105 @@ ble_service_t *sensors_init(const sensors_service_cb_t *cb);
 /*
  * This function should be called by the application as a response to a read request
  *
+ * Batched characteristics (see SampleBatch.h) answer with the newest samples that fit
+ * into the current MTU.
+ *
  * \param[in] svc       service instance
  * \param[in] conn_idx  connection index
+ * \param[in] ch        characteristic that was read
  * \param[in] status    ATT error
  * \param[in] value     attribute value
  */
-void temp_get_int_value_cfm(ble_service_t *svc, uint16_t conn_idx, att_error_t status, const uint16_t *value);
-void acc_get_int_value_cfm(ble_service_t *svc, uint16_t conn_idx, att_error_t status, const uint16_t *value);
+void sensors_get_value_cfm(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch,
+                                        att_error_t status, uint16_t length, const void *value);
+void sensors_get_batch_cfm(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch,
+                                                                const SampleBatch_t *batch);
+
+/*
+ * Push a new value to every central that subscribed through the characteristic's CCC
+ * descriptor. Should be called by the application whenever a driver produced a sample.
+ *
+ * Each central only gets every n-th update, as requested through the notification rate
+ * characteristic, and is skipped while its notifications are still queued in the stack.
+ *
+ * \param[in] svc       service instance
+ * \param[in] ch        characteristic to update
+ * \param[in] value     attribute value
+ *
+ * \return number of centrals the value was sent to
+ */
+uint8_t sensors_notify_value(ble_service_t *svc, sensors_char_t ch, uint16_t length,
+                                                                        const void *value);
+
+/*
+ * Send every buffered sample to the subscribers, packed into as few notifications as the
+ * smallest MTU among them allows. Samples are only removed from the batch once they were
+ * sent to at least one central.
+ *
+ * \param[in] svc       service instance
+ * \param[in] ch        characteristic to update
+ * \param[in] batch     buffered samples of the stream
+ */
+void sensors_notify_batch(ble_service_t *svc, sensors_char_t ch, SampleBatch_t *batch);
+
+/*
+ * Store a new value in the attribute database, used when CFG_SENSORS_READ_FROM_DB is set
+ * so that reads are answered without waking up the application.
+ *
+ * \param[in] svc       service instance
+ * \param[in] ch        characteristic to update
+ * \param[in] value     attribute value
+ */
+void sensors_set_value(ble_service_t *svc, sensors_char_t ch, uint16_t length, const void *value);
+void sensors_set_batch(ble_service_t *svc, sensors_char_t ch, const SampleBatch_t *batch);
+
+/*
+ * Publish the configuration in effect for a characteristic, so that centrals read it back
+ * from the configuration characteristic. Called by the application for its defaults, the
+ * service calls it itself for configs the application accepted.
+ *
+ * \param[in] svc       service instance
+ * \param[in] ch        configured characteristic
+ * \param[in] config    configuration in effect
+ */
+void sensors_set_config(ble_service_t *svc, sensors_char_t ch, const sensors_config_t *config);
+
+/*
+ * Store the packed latest values of all sensors (see SensorSnapshot.h) in the snapshot
+ * characteristic. Called by the application whenever one of them was published.
+ *
+ * \param[in] svc       service instance
+ * \param[in] snapshot  SENSOR_SNAPSHOT_LEN bytes
+ */
+void sensors_set_snapshot(ble_service_t *svc, const uint8_t *snapshot);
+
+#if CFG_STACK_MONITOR
+/*
+ * Store the packed stack use of the application tasks (see StackMonitor.h) in the stack
+ * usage debug characteristic.
+ *
+ * \param[in] svc       service instance
+ * \param[in] pdu       STACK_MONITOR_PDU_LEN bytes
+ */
+void sensors_set_stack_usage(ble_service_t *svc, const uint8_t *pdu);
+#endif
+
+/* Serialize a tilt into its SENSORS_TILT_VALUE_LEN bytes characteristic value */
+void sensors_pack_tilt(uint8_t *pdu, const Tilt_t *value);
+
+/*
+ * Should be called by the application on BLE_EVT_GATTC_MTU_CHANGED and
+ * BLE_EVT_GAP_DATA_LENGTH_CHANGED, so that payloads follow the sizes negotiated with
+ * each central.
+ */
+void sensors_set_mtu(ble_service_t *svc, uint16_t conn_idx, uint16_t mtu);
+void sensors_set_data_length(ble_service_t *svc, uint16_t conn_idx, uint16_t tx_octets);
+
+/*
+ * Current payload size of a batched notification: the one of the smallest MTU among the
+ * subscribers of the characteristic, or the default MTU when nobody subscribed
+ */
+uint16_t sensors_get_payload_len(ble_service_t *svc, sensors_char_t ch);
 
+/* Samples, payload and air bytes sent so far for the given characteristic */
+void sensors_get_batch_stats(ble_service_t *svc, sensors_char_t ch, SampleBatchStats_t *stats);
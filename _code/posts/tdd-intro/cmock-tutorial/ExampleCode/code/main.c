@@ -12,6 +12,7 @@
  ****************************************************************************************
  */
 /* Standard includes. */
+#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 
@@ -27,6 +28,8 @@
 #include "sys_watchdog.h"
 
 #include "common.h"
+#include "app_rtos.h"
+#include "ble_peripheral_config.h"
 #include "ad_i2c.h"
 #include <platform_devices.h>
 
@@ -39,6 +42,14 @@ INITIALISED_PRIVILEGED_DATA int8_t idle_task_wdog_id = -1;
 
 __RETAINED_RW extern volatile bool pin_status_flag;
 
+#if CFG_POISON_CHECK
+#include "PoisonCheck.h"
+
+#define POISON_PATTERN                                (0xDEADBEEF)
+
+PRIVILEGED_DATA static PoisonCheck_t poison_check;
+#endif
+
 /*
  * Perform any application specific hardware configuration.  The clocks,
  * memory, etc. are configured before main() is called.
@@ -66,6 +77,12 @@ static void system_init( void *pvParameters )
         cm_ahb_set_clock_divider(ahb_div1);
         cm_lp_clk_init();
         
+#if CFG_POISON_CHECK
+        /* Before any task can register an area */
+        PoisonCheckInit(&poison_check, POISON_PATTERN, CFG_POISON_SLICE_WORDS,
+                                                OS_MS_2_TICKS(CFG_POISON_SWEEP_MS));
+#endif
+
         /* Initialize platform watchdog */
         sys_watchdog_init();
 
@@ -100,11 +117,11 @@ static void system_init( void *pvParameters )
         ble_mgr_init();
 
         /* Start main task here */
-        OS_TASK_CREATE( "BLE Peripheral",           /* The text name assigned to the task,
+        APP_TASK_CREATE("BLE Peripheral",           /* The text name assigned to the task,
                                                        for debug only; not used by the kernel. */
                         ble_peripheral_task,        /* The function that implements the task. */
                         NULL,                       /* The parameter passed to the task */
-                        1024,                        /* The number of bytes to allocate to the
+                        BLE_PERIPHERAL_TASK_STACK_SIZE, /* The number of bytes to allocate to the
                                                        stack of the task. */
                         mainBLE_PERIPHERAL_TASK_PRIORITY,  /* The priority assigned to the task */
                         handle);                    /* The task handle */
@@ -125,7 +142,7 @@ int main( void )
         cm_clk_init_low_level();                            /* Basic clock initializations. */
 
         /* Start SysInit task. */
-        status = OS_TASK_CREATE("SysInit",                /* The text name assigned to the task, for
+        status = APP_TASK_CREATE("SysInit",               /* The text name assigned to the task, for
                                                              debug only; not used by the kernel. */
                                 system_init,              /* The System Initialization task. */
                                 ( void * ) 0,             /* The parameter passed to the task. */
@@ -157,6 +174,32 @@ static void prvSetupHardware( void )
 }
 
 
+#if CFG_STATIC_RTOS_OBJECTS
+/*
+ * With static allocation supported the kernel asks for the memory of its idle and timer
+ * tasks as well
+ */
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *stack_size)
+{
+        static StaticTask_t idle_tcb;
+        static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+
+        *tcb = &idle_tcb;
+        *stack = idle_stack;
+        *stack_size = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *stack_size)
+{
+        static StaticTask_t timer_tcb;
+        static StackType_t timer_stack[configTIMER_TASK_STACK_DEPTH];
+
+        *tcb = &timer_tcb;
+        *stack = timer_stack;
+        *stack_size = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
 /**
  * @brief Malloc fail hook
  */
@@ -172,10 +215,55 @@ void vApplicationMallocFailedHook( void )
 	FreeRTOSConfig.h, and the xPortGetFreeHeapSize() API function can be used
 	to query the size of free heap space that remains (although it does not
 	provide information on how the remaining heap might be fragmented). */
+#if defined CONFIG_RETARGET
+        printf("heap exhausted: %u bytes free, never more than %u bytes used\r\n",
+                        xPortGetFreeHeapSize(), configTOTAL_HEAP_SIZE - xPortGetMinimumEverFreeHeapSize());
+#endif
         taskDISABLE_INTERRUPTS();
         for( ;; );
 }
 
+#if CFG_POISON_CHECK
+void poison_area_add(uint32_t *start, size_t words)
+{
+        bool added;
+
+        /* The idle hook may be half way through a slice */
+        OS_ENTER_CRITICAL_SECTION();
+        added = PoisonCheckAddArea(&poison_check, start, words);
+        OS_LEAVE_CRITICAL_SECTION();
+
+        OS_ASSERT(added);
+}
+
+/*
+ * One slice of the poisoned areas per idle pass, so the check never holds off an interrupt
+ * or a task for longer than CFG_POISON_SLICE_WORDS compares. Detection lags by up to
+ * CFG_POISON_SWEEP_MS, the tick hook used to find an overwrite within one tick.
+ */
+static void poison_check_step(void)
+{
+        const uint32_t *bad = NULL;
+        uint32_t sweeps = poison_check.sweeps;
+
+        if (!PoisonCheckStep(&poison_check, OS_GET_TICK_COUNT(), &bad)) {
+#if defined CONFIG_RETARGET
+                printf("poisoned memory overwritten at %p\r\n", (const void *) bad);
+#endif
+                taskDISABLE_INTERRUPTS();
+                for( ;; );
+        }
+
+        /*
+         * The SDK checks its own area in one unbounded pass, do that once per sweep and not
+         * on every tick
+         */
+        if (poison_check.sweeps != sweeps) {
+                OS_POISON_AREA_CHECK( OS_POISON_ON_ERROR_HALT, result );
+        }
+}
+#endif
+
 /**
  * @brief Application idle task hook
  */
@@ -191,6 +279,10 @@ void vApplicationIdleHook( void )
            function, because it is the responsibility of the idle task to clean up
            memory allocated by the kernel to any task that has since been deleted. */
 
+#if CFG_POISON_CHECK
+        poison_check_step();
+#endif
+
 #if dg_configUSE_WDOG
         sys_watchdog_notify(idle_task_wdog_id);
 #endif
@@ -207,6 +299,9 @@ void vApplicationStackOverflowHook( OS_TASK pxTask, char *pcTaskName )
         /* Run time stack overflow checking is performed if
 	configCHECK_FOR_STACK_OVERFLOW is defined to 1 or 2.  This hook
 	function is called if a stack overflow is detected. */
+#if defined CONFIG_RETARGET
+        printf("stack overflow in %s\r\n", pcTaskName);
+#endif
         taskDISABLE_INTERRUPTS();
         for( ;; );
 }
@@ -216,8 +311,8 @@ void vApplicationStackOverflowHook( OS_TASK pxTask, char *pcTaskName )
  */
 void vApplicationTickHook( void )
 {
-
+#if !CFG_POISON_CHECK
         OS_POISON_AREA_CHECK( OS_POISON_ON_ERROR_HALT, result );
-
+#endif
 }
 
@@ -32,10 +32,31 @@
 
 static const uint8_t LSM303_CTRL1_A      = 0x20;    // control reg 1
 static const uint8_t LSM303_CTRL2_A      = 0x21;    // control reg 2
+static const uint8_t LSM303_CTRL3_A      = 0x22;    // control reg 3
+static const uint8_t LSM303_CTRL4_A      = 0x23;    // control reg 4, INT1 routing
+static const uint8_t LSM303_FIFO_CTRL_A  = 0x25;    // [7:5] FIFO mode
 static const uint8_t LSM303_STATUS_A     = 0x27;    // status reg
 static const uint8_t LSM303_WHO_AM_I_A   = 0x0F;    // ID register
 static const uint8_t LSM303_ID_ACC       = 0x43;
 
+/*  Wake-up (activity) detection     */
+static const uint8_t LSM303_WAKE_UP_THS_A = 0x33;   // [5:0] threshold, 1 LSB = FS/64
+static const uint8_t LSM303_WAKE_UP_DUR_A = 0x34;   // [6:5] duration, in 1/ODR
+static const uint8_t LSM303_WAKE_UP_SRC_A = 0x37;   // wake-up source
+
+/*  FIFO, filled at the ODR and drained on each measurement     */
+static const uint8_t LSM303_FIFO_THS_A     = 0x2E;  // watermark level
+static const uint8_t LSM303_FIFO_SRC_A     = 0x2F;  // flags, DIFF8
+static const uint8_t LSM303_FIFO_SAMPLES_A = 0x30;  // DIFF[7:0], unread samples
+
+#define LSM303_FIFO_MODE_BYPASS         (0x00)
+#define LSM303_FIFO_MODE_CONTINUOUS     (0xC0)
+#define LSM303_FIFO_SRC_DIFF8           (1 << 5)
+
+#define LSM303_CTRL3_LIR                (1 << 2)    // latch interrupts until source is read
+#define LSM303_CTRL4_INT1_WU            (1 << 5)    // wake-up event on INT1
+#define LSM303_WAKE_UP_SRC_WU_IA        (1 << 3)    // wake-up event detected
+
 /*  Axis output registers HSB/LSB     */
 static const uint8_t LSM303_OUTX_L_A    =  0x28;
 static const uint8_t LSM303_OUTX_H_A    =  0x29;
@@ -45,7 +66,27 @@ static const uint8_t LSM303_OUTZ_L_A    =  0x2C;
 static const uint8_t LSM303_OUTZ_H_A    =  0x2D;
 
 #define NOTIF_DO_MEASUREMENT            (1 << 1)
-static OS_TASK handle = NULL;
+#define NOTIF_CONFIGURE                 (1 << 2)
+static SensorThread_t thread;
+
+static AccelerometerConfig_t config = { ACC_ACTIVE_CTRL1 >> 4, 0, 0 };
+static AccelerometerConfig_t pending_config;
+
+static AccelerometerMode_t power_mode = ACC_MODE_ACTIVE;
+static OS_TICK_TIME last_motion_tick = 0;
+static AccelerometerModeCb_t mode_cb = NULL;
+static SensorSample_t latest_sample;
+static SensorSampleCb_t sample_cb = NULL;
+
+/* Samples read but not yet taken by the application, a FIFO drain yields several at once */
+static SampleBatch_t samples;
+static SensorTime_t last_drain;
+
+/* Kept across the waits of the driver thread, and the async reads land in raw_axes */
+static i2c_device thread_dev;
+static uint8_t raw_axes[6];
+static SensorTime_t drain_time;
+static uint16_t fifo_level, drain_count, drain_index;
 
 // shared value between BLE service and I2C temperature task
 extern __RETAINED_RW uint16_t CurrentAccelerometerValue;
@@ -54,6 +95,15 @@ extern __RETAINED_RW uint16_t CurrentAccelerometerValue;
             ad_i2c_transact( (Device), &(RegisterToRead), sizeof (RegisterToRead), \
                     &(ReturnValue), sizeof (ReturnValue) )
 
+/* REG_ADDR + REG_VAL in one frame; the dummy read makes the adapter emit a write pattern */
+STATIC void WriteI2CRegister(i2c_device dev, uint8_t Register, uint8_t Value)
+{
+    const uint8_t frame[] = {Register, Value};
+    uint8_t dummy;
+
+    ad_i2c_transact(dev, frame, sizeof(frame), &dummy, sizeof(dummy));
+}
+
 
 STATIC uint8_t GetDataReadyFlag(i2c_device dev)
 {
@@ -71,138 +121,359 @@ STATIC uint16_t ConcatenateBytes(uint8_t MostSignificantByte, uint8_t LessSignif
 
 }
 
-STATIC uint16_t UpdateAccelerometerValue(i2c_device dev)
-{ 
-//     uint16_t _outx_a;
-//     uint16_t AccelerometerValue;
-//     uint8_t MostSignificantByte;
-//     uint8_t LessSignificantByte;
-// 
-//     dev = ad_i2c_open(LSM303AH_ACC);
-// 
-//     ad_i2c_transact(i2c_dev, 
-//             &LSM303_OUTX_H_A, sizeof(LSM303_OUTX_H_A),  
-//             &MostSignificantByte, sizeof(MostSignificantByte)
-//             );
-// 
-//     ad_i2c_transact(i2c_dev, 
-//             &LSM303_OUTX_L_A, sizeof(LSM303_OUTX_L_A), 
-//             &LessSignificantByte, sizeof(LessSignificantByte)  
-//             );
-// 
-//     ad_i2c_close(dev);
-// 
-//     _outx_a = ConcatenateBytes(MostSignificantByte, LessSignificantByte);
-//     //     _outx_a = ((uint16_t)MostSignificantByte<< 8) | LessSignificantByte;
-// 
-//     AccelerometerValue = _outx_a>>4; // 1/16 is almost 1/0.061.. only for test
-// 
-//     CurrentAccelerometerValue = AccelerometerValue;
-// 
-//     return AccelerometerValue;
+/* Spread the samples of one FIFO drain evenly over the time since the previous drain */
+STATIC SensorTime_t FifoSampleTime(SensorTime_t from, SensorTime_t to, uint16_t index,
+                                   uint16_t count)
+{
+    return from + (SensorTime_t)((uint32_t)(to - from) * (index + 1) / count);
 }
 
+/* Output data rates of CTRL1_A ODR[3:0] in 1/10 Hz, high-resolution then low-power */
+static const uint16_t odr_decihz[16] = {
+    0, 125, 250, 500, 1000, 2000, 4000, 8000,
+    10, 125, 250, 500, 1000, 2000, 4000, 8000,
+};
 
-static void read_acc_i2c(void)
+/* Samples the sensor produces in one period, rounded up */
+STATIC uint32_t SamplesPerPeriod(uint8_t odr, uint32_t period_ms)
 {
-//     uint8_t _ret;
-//     uint8_t _drdy; // data ready status
-//     uint8_t _outx_l_a, _outx_h_a;
-// 
-//     uint16_t _outx_a;
-// 
-//     i2c_device i2c_dev;
-// 
-//     /* GetDataReadyFlag  */
-// //     i2c_dev = ad_i2c_open(LSM303AH_ACC);
-// //     ad_i2c_transact(i2c_dev, 
-// //             &LSM303_STATUS_A, sizeof(LSM303_STATUS_A), 
-// //             &_ret, sizeof(_ret) 
-// //             );
-// // 
-// //     _drdy = _ret & 0x01;
-// //
-//     _drdy = GetDataReadyFlag(i2c_dev);
-// 
-//     /* if DataReady? then */
-//     if( _drdy ){
-//         /* Update Accelerometer Value  */
-//         ad_i2c_transact(i2c_dev, 
-//                 &LSM303_OUTX_L_A, sizeof(LSM303_OUTX_L_A), 
-//                 &_outx_l_a, sizeof(_outx_l_a)  
-//                 );
-// 
-//         ad_i2c_transact(i2c_dev, 
-//                 &LSM303_OUTX_H_A, sizeof(LSM303_OUTX_H_A),  
-//                 &_outx_h_a, sizeof(_outx_h_a)
-//                 );
-// 
-//         _outx_a = ((uint16_t)_outx_h_a  << 8) | _outx_l_a;
-// 
-//         acc_int_val = _outx_a>>4; // 1/16 is almost 1/0.061.. only for test
-//     }
-// 
-//     ad_i2c_close(i2c_dev);
+    return (uint32_t)(((uint64_t)odr_decihz[odr & 0x0F] * period_ms + 9999) / 10000);
 }
 
-static void i2c_acc_task(void *param)
+/* Free slots of the sample ring, the application empties it from its own task */
+static uint16_t RingSpace(void)
 {
-//     for (;;) {
-//         OS_BASE_TYPE ret;
-//         uint32_t notif;
-// 
-//         ret = OS_TASK_NOTIFY_WAIT(0, (uint32_t) -1, &notif, OS_TASK_NOTIFY_FOREVER);
-//         OS_ASSERT(ret == OS_OK);
-// 
-//         if (notif & NOTIF_DO_MEASUREMENT) {
-//             read_acc_i2c();
-//         }
-//     }
+    uint16_t space;
+
+    OS_ENTER_CRITICAL_SECTION();
+    space = SAMPLE_BATCH_LEN - samples.count;
+    OS_LEAVE_CRITICAL_SECTION();
+
+    return space;
+}
+
+/* OUTX_L..OUTZ_H are consecutive, the register address auto-increments (IF_ADD_INC) */
+static void DecodeAxes(const uint8_t raw[6], int16_t value[3])
+{
+    value[0] = (int16_t)ConcatenateBytes(raw[1], raw[0]);
+    value[1] = (int16_t)ConcatenateBytes(raw[3], raw[2]);
+    value[2] = (int16_t)ConcatenateBytes(raw[5], raw[4]);
+}
+
+static uint16_t AddSample(const SensorSample_t *sample)
+{
+    uint16_t AccelerometerValue;
+
+    ActivityClassifierAddSample(sample->value[0], sample->value[1], sample->value[2]);
+
+    AccelerometerValue = (uint16_t)sample->value[0] >> 4; // 1/16 is almost 1/0.061.. only for test
+
+    CurrentAccelerometerValue = AccelerometerValue;
+
+    OS_ENTER_CRITICAL_SECTION();
+    latest_sample = *sample;
+    SampleBatchPush(&samples, sample);
+    OS_LEAVE_CRITICAL_SECTION();
+
+    return AccelerometerValue;
+}
+
+/*
+ * Decide the power mode from the latest wake-up flag. Any motion re-arms the idle timer;
+ * the sensor only drops back to idle after ACC_IDLE_TIMEOUT_MS without a wake-up event.
+ */
+STATIC AccelerometerMode_t NextPowerMode(AccelerometerMode_t mode, bool motion,
+                                        OS_TICK_TIME now, OS_TICK_TIME *last_motion)
+{
+    if (motion) {
+        *last_motion = now;
+        return ACC_MODE_ACTIVE;
+    }
+
+    if (mode == ACC_MODE_ACTIVE &&
+            (OS_TICK_TIME)(now - *last_motion) >= OS_MS_2_TICKS(ACC_IDLE_TIMEOUT_MS)) {
+        return ACC_MODE_IDLE;
+    }
+
+    return mode;
+}
+
+/* The configured ODR replaces the one in ACC_ACTIVE_CTRL1, full scale stays */
+STATIC uint8_t ActiveCtrl1(uint8_t odr)
+{
+    return (uint8_t)(odr << 4) | (ACC_ACTIVE_CTRL1 & 0x0F);
+}
+
+static void ApplyPowerMode(i2c_device dev, AccelerometerMode_t mode)
+{
+    WriteI2CRegister(dev, LSM303_CTRL1_A,
+                        (mode == ACC_MODE_IDLE) ? ACC_IDLE_CTRL1 : ActiveCtrl1(config.active_odr));
+}
+
+/* Continuous mode keeps the newest samples, bypass leaves only the output registers */
+static void ApplyFifo(i2c_device dev)
+{
+    if (config.fifo_watermark) {
+        WriteI2CRegister(dev, LSM303_FIFO_THS_A, config.fifo_watermark);
+        WriteI2CRegister(dev, LSM303_FIFO_CTRL_A, LSM303_FIFO_MODE_CONTINUOUS);
+    } else {
+        WriteI2CRegister(dev, LSM303_FIFO_CTRL_A, LSM303_FIFO_MODE_BYPASS);
+    }
+}
+
+static void apply_config(void)
+{
+    i2c_device i2c_dev;
+
+    OS_ENTER_CRITICAL_SECTION();
+    config = pending_config;
+    OS_LEAVE_CRITICAL_SECTION();
+
+    /* Switching modes empties the FIFO, whatever it held is dropped */
+    i2c_dev = ad_i2c_open(LSM303AH_ACC);
+    WriteI2CRegister(i2c_dev, LSM303_FIFO_CTRL_A, LSM303_FIFO_MODE_BYPASS);
+    ApplyFifo(i2c_dev);
+    if (power_mode == ACC_MODE_ACTIVE) {
+        ApplyPowerMode(i2c_dev, power_mode);
+    }
+    last_drain = OS_GET_TICK_COUNT();
+    ad_i2c_close(i2c_dev);
+}
+
+/* Returns true if the sensor is active and worth sampling */
+static bool UpdatePowerMode(void)
+{
+    i2c_device i2c_dev;
+    uint8_t wake_up_src;
+    AccelerometerMode_t mode;
+
+    /* Reading WAKE_UP_SRC also clears the latched wake-up event */
+    i2c_dev = ad_i2c_open(LSM303AH_ACC);
+    ReadI2CRegister(i2c_dev, LSM303_WAKE_UP_SRC_A, wake_up_src);
+
+    mode = NextPowerMode(power_mode, (wake_up_src & LSM303_WAKE_UP_SRC_WU_IA) != 0,
+                                                        OS_GET_TICK_COUNT(), &last_motion_tick);
+    if (mode != power_mode) {
+        ApplyPowerMode(i2c_dev, mode);
+    }
+    ad_i2c_close(i2c_dev);
+
+    if (mode != power_mode) {
+        power_mode = mode;
+        if (mode == ACC_MODE_IDLE) {
+            ActivityClassifierIdle();
+        }
+        if (mode_cb) {
+            mode_cb(mode);
+        }
+    }
+
+    /* Nothing worth sampling while the asset sits still */
+    return power_mode == ACC_MODE_ACTIVE;
+}
+
+/*
+ * The short status and control accesses stay synchronous, only the axis reads, which
+ * are most of the bus time when draining the FIFO, suspend the thread. The bus is held
+ * from the event to the end of the pass, every continue gives it back at the top.
+ */
+STATIC CoState_t AccelerometerThread(SensorThread_t *t)
+{
+    SensorSample_t sample;
+    uint32_t events;
+    uint8_t src, level;
+
+    CO_BEGIN(&t->co);
+
+    for (;;) {
+        SENSOR_I2C_GIVE(t);
+        SENSOR_WAIT_EVENT(t, NOTIF_DO_MEASUREMENT | NOTIF_CONFIGURE, events);
+        SENSOR_I2C_TAKE(t);
+
+        if (events & NOTIF_CONFIGURE) {
+            apply_config();
+        }
+        if (!(events & NOTIF_DO_MEASUREMENT) || !UpdatePowerMode()) {
+            continue;
+        }
+
+        if (config.fifo_watermark) {
+            /* Read what the FIFO collected since the last measurement, oldest first */
+            thread_dev = ad_i2c_open(LSM303AH_ACC);
+            ReadI2CRegister(thread_dev, LSM303_FIFO_SRC_A, src);
+            ReadI2CRegister(thread_dev, LSM303_FIFO_SAMPLES_A, level);
+            drain_time = OS_GET_TICK_COUNT();
+            fifo_level = ((src & LSM303_FIFO_SRC_DIFF8) ? 0x100 : 0) | level;
+
+            /*
+             * At most a watermark per drain and never more than the ring has room for, so
+             * no sample is overwritten before the application took it. What is left stays
+             * in the FIFO for the next drain.
+             */
+            drain_count = fifo_level;
+            if (drain_count > config.fifo_watermark) {
+                drain_count = config.fifo_watermark;
+            }
+            if (drain_count > RingSpace()) {
+                drain_count = RingSpace();
+            }
+
+            for (drain_index = 0; drain_index < drain_count; drain_index++) {
+                SENSOR_I2C_READ(t, thread_dev, &LSM303_OUTX_L_A, sizeof(LSM303_OUTX_L_A),
+                                                        raw_axes, sizeof(raw_axes));
+                if (t->i2c_error) {
+                    /* Stop here, the next drain starts over from what the FIFO holds */
+                    drain_count = drain_index;
+                    break;
+                }
+                DecodeAxes(raw_axes, sample.value);
+                sample.timestamp = FifoSampleTime(last_drain, drain_time, drain_index,
+                                                                        fifo_level);
+                AddSample(&sample);
+            }
+            ad_i2c_close(thread_dev);
+
+            /* The next drain continues after the newest sample read */
+            if (drain_count < fifo_level) {
+                drain_time = drain_count ? FifoSampleTime(last_drain, drain_time,
+                                                drain_count - 1, fifo_level) : last_drain;
+            }
+        } else if (GetDataReadyFlag(thread_dev)) {
+            thread_dev = ad_i2c_open(LSM303AH_ACC);
+            SENSOR_I2C_READ(t, thread_dev, &LSM303_OUTX_L_A, sizeof(LSM303_OUTX_L_A),
+                                                        raw_axes, sizeof(raw_axes));
+            ad_i2c_close(thread_dev);
+            if (t->i2c_error) {
+                continue;
+            }
+
+            DecodeAxes(raw_axes, sample.value);
+            drain_time = sample.timestamp = OS_GET_TICK_COUNT();
+            drain_count = 1;
+            AddSample(&sample);
+        } else {
+            continue;
+        }
+
+        last_drain = drain_time;
+
+        if (drain_count && sample_cb) {
+            sample_cb();
+        }
+    }
+
+    CO_END(&t->co);
 }
 
 void i2c_acc_do_measurement(void)
 {
-//     OS_TASK_NOTIFY(handle, NOTIF_DO_MEASUREMENT, OS_NOTIFY_SET_BITS);
+    SensorExecutorSignal(&thread, NOTIF_DO_MEASUREMENT);
 }
-// 
+
+AccelerometerMode_t i2c_acc_get_mode(void)
+{
+    return power_mode;
+}
+
+void i2c_acc_register_mode_cb(AccelerometerModeCb_t cb)
+{
+    mode_cb = cb;
+}
+
+void i2c_acc_register_sample_cb(SensorSampleCb_t cb)
+{
+    sample_cb = cb;
+}
+
+void i2c_acc_get_sample(SensorSample_t *sample)
+{
+    OS_ENTER_CRITICAL_SECTION();
+    *sample = latest_sample;
+    OS_LEAVE_CRITICAL_SECTION();
+}
+
+uint8_t i2c_acc_take_samples(SensorSample_t *out, uint8_t max)
+{
+    uint8_t n;
+
+    OS_ENTER_CRITICAL_SECTION();
+    for (n = 0; n < max && samples.count; n++) {
+        out[n] = samples.samples[samples.head];
+        SampleBatchConsume(&samples, 1);
+    }
+    OS_LEAVE_CRITICAL_SECTION();
+
+    return n;
+}
+
+bool i2c_acc_configure(const AccelerometerConfig_t *cfg)
+{
+    if (cfg->active_odr == 0 || cfg->active_odr > 0x0F ||
+                                        cfg->fifo_watermark > ACC_FIFO_MAX_WATERMARK) {
+        return false;
+    }
+
+    /* A period's worth must fit the watermark, or the FIFO backlog would only grow */
+    if (cfg->fifo_watermark &&
+            SamplesPerPeriod(cfg->active_odr, cfg->period_ms) > cfg->fifo_watermark) {
+        return false;
+    }
+
+    OS_ENTER_CRITICAL_SECTION();
+    pending_config = *cfg;
+    OS_LEAVE_CRITICAL_SECTION();
+
+    SensorExecutorSignal(&thread, NOTIF_CONFIGURE);
+
+    return true;
+}
+
+void i2c_acc_get_config(AccelerometerConfig_t *cfg)
+{
+    OS_ENTER_CRITICAL_SECTION();
+    *cfg = config;
+    OS_LEAVE_CRITICAL_SECTION();
+}
+
 void i2c_acc_init(void)
 {
-//     // Configure sensor in Low Power at 100Hz
-//     static const uint8_t conf_reg = 0xC0;
-//     static const uint8_t rst_reg= 0x40; 
-//     uint8_t dev_id = 0x00; 
-// 
-// 
-//     /* IsValidAccelerometerID */ 
-//     i2c_device i2c_dev;
-//     i2c_dev = ad_i2c_open(LSM303AH_ACC);
-//     ad_i2c_transact(i2c_dev, &LSM303_WHO_AM_I_A, sizeof(LSM303_WHO_AM_I_A),
-//             &dev_id, sizeof(dev_id));
-// 
-//     if (dev_id != LSM303_ID_ACC) 
-//     {        
-//         ad_i2c_close(i2c_dev);
-//         while(1);
-//     }
-// 
-//     /* End IsValidAccelerometerID */
-// 
-//     /* ConfigAccelerometer */
-//     // Concatenation REG_ADDR + REG_VAL
-//     const uint8_t conf[] = {LSM303_CTRL1_A, conf_reg};
-//     const uint8_t reset[] = {LSM303_CTRL2_A, rst_reg};
-// 
-//     /* dev_id is just a dummy var, used to generate a I2C writing 
-//        frame. Without dev_id and the concatenation the API
-//        does not generate the I2C writting pattern */
-//     ad_i2c_transact(i2c_dev, reset, sizeof(reset), &dev_id, sizeof(dev_id));
-// 
-//     ad_i2c_transact(i2c_dev, conf, sizeof(conf), &dev_id, sizeof(dev_id));
-//     ad_i2c_transact(i2c_dev, &LSM303_CTRL1_A, sizeof(LSM303_CTRL1_A), &dev_id, sizeof(dev_id));
-// 
-//     ad_i2c_close(i2c_dev);
-// 
-//     /* End ConfigAccelerometer */
-// 
-//     OS_TASK_CREATE("acc_sensor", i2c_acc_task, NULL, 400, OS_TASK_PRIORITY_NORMAL, handle);
+    static const uint8_t rst_reg= 0x40; 
+    uint8_t dev_id = 0x00; 
+
+    /* IsValidAccelerometerID */ 
+    i2c_device i2c_dev;
+    i2c_dev = ad_i2c_open(LSM303AH_ACC);
+    ad_i2c_transact(i2c_dev, &LSM303_WHO_AM_I_A, sizeof(LSM303_WHO_AM_I_A),
+            &dev_id, sizeof(dev_id));
+
+    if (dev_id != LSM303_ID_ACC) 
+    {        
+        ad_i2c_close(i2c_dev);
+        while(1);
+    }
+
+    /* ConfigAccelerometer */
+    WriteI2CRegister(i2c_dev, LSM303_CTRL2_A, rst_reg);
+
+    /* Wake-up detection: latched, routed to INT1, evaluated at any ODR */
+    WriteI2CRegister(i2c_dev, LSM303_WAKE_UP_THS_A, ACC_WAKE_UP_THS & 0x3F);
+    WriteI2CRegister(i2c_dev, LSM303_WAKE_UP_DUR_A, 0x00);
+    WriteI2CRegister(i2c_dev, LSM303_CTRL3_A, LSM303_CTRL3_LIR);
+    WriteI2CRegister(i2c_dev, LSM303_CTRL4_A, LSM303_CTRL4_INT1_WU);
+
+    /* Start sampling; the first ACC_IDLE_TIMEOUT_MS without motion drops to idle */
+    power_mode = ACC_MODE_ACTIVE;
+    last_motion_tick = OS_GET_TICK_COUNT();
+    last_drain = last_motion_tick;
+    ApplyFifo(i2c_dev);
+    ApplyPowerMode(i2c_dev, power_mode);
+
+    ad_i2c_close(i2c_dev);
+
+    /* End ConfigAccelerometer */
+
+    ActivityClassifierInit();
+    SampleBatchInit(&samples, 3);
+
+    SensorExecutorAdd(&thread, AccelerometerThread);
 }
@@ -0,0 +1,121 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ActivityClassifier.c
+ *
+ * @brief On-device idle/walking/vibrating classifier for accelerometer windows
+ *
+ ****************************************************************************************
+ */
+#include "ActivityClassifier.h"
+
+/*
+ * Reference weights. Filters 0/1 respond to the slope of the signal (+/-), filters 2/3 to
+ * its curvature (+/-), so after the ReLU the pooled features are |slope| and |curvature|
+ * energy. Swap these tables for the output of the training pipeline when it is available.
+ */
+static const int8_t conv_weights[ACTIVITY_CONV_FILTERS][ACTIVITY_CONV_KERNEL][ACTIVITY_AXES] = {
+    { {  8,  8,  8 }, {  8,  8,  8 }, {  0,  0,  0 }, { -8, -8, -8 }, { -8, -8, -8 } },
+    { { -8, -8, -8 }, { -8, -8, -8 }, {  0,  0,  0 }, {  8,  8,  8 }, {  8,  8,  8 } },
+    { {  0,  0,  0 }, {  8,  8,  8 }, {-16,-16,-16 }, {  8,  8,  8 }, {  0,  0,  0 } },
+    { {  0,  0,  0 }, { -8, -8, -8 }, { 16, 16, 16 }, { -8, -8, -8 }, {  0,  0,  0 } },
+};
+static const int32_t conv_bias[ACTIVITY_CONV_FILTERS] = { 0, 0, 0, 0 };
+static const uint8_t conv_shift = 4;
+
+static const int8_t dense_weights[ACTIVITY_CLASSES][ACTIVITY_CONV_FILTERS] = {
+    { -8, -8, -8, -8 },        // idle
+    {  8,  8, -8, -8 },        // walking
+    { -4, -4,  8,  8 },        // vibrating
+};
+static const int32_t dense_bias[ACTIVITY_CLASSES] = { 64, 0, 0 };
+static const uint8_t dense_shift = 2;
+
+/* Scratch memory for the intermediate tensors of one inference */
+#define ACTIVITY_ARENA_SIZE     ( sizeof(ActivityConvOut_t) + sizeof(ActivityFeatures_t) + \
+                                  sizeof(ActivityLogits_t) + 3 * INT8_ARENA_ALIGN )
+
+static uint8_t arena_buffer[ACTIVITY_ARENA_SIZE];
+static Int8Arena_t arena;
+
+static ActivityWindow_t window;
+static uint8_t window_fill = 0;
+
+// shared value between BLE service and the classifier
+extern __RETAINED_RW uint8_t CurrentActivityLabel;
+
+STATIC int8_t QuantizeAxis(int16_t raw)
+{
+    return (int8_t)(raw >> ACTIVITY_INPUT_SHIFT);
+}
+
+ActivityLabel_t ActivityClassifierRun(const int8_t input[ACTIVITY_WINDOW_LEN][ACTIVITY_AXES])
+{
+    int8_t (*conv)[ACTIVITY_CONV_FILTERS];
+    int8_t *features;
+    int8_t *logits;
+
+    Int8ArenaReset(&arena);
+    conv     = Int8ArenaAlloc(&arena, sizeof(ActivityConvOut_t));
+    features = Int8ArenaAlloc(&arena, sizeof(ActivityFeatures_t));
+    logits   = Int8ArenaAlloc(&arena, sizeof(ActivityLogits_t));
+
+    if (!conv || !features || !logits) {
+        return ACTIVITY_UNKNOWN;
+    }
+
+    Int8Conv1d(ACTIVITY_WINDOW_LEN, ACTIVITY_AXES, input,
+               ACTIVITY_CONV_FILTERS, ACTIVITY_CONV_KERNEL, ACTIVITY_CONV_STRIDE,
+               conv_weights, conv_bias, conv_shift, true, conv);
+
+    Int8GlobalAvgPool1d(ACTIVITY_CONV_LEN, ACTIVITY_CONV_FILTERS,
+                        (const int8_t (*)[ACTIVITY_CONV_FILTERS])conv, features);
+
+    Int8Dense(ACTIVITY_CONV_FILTERS, features, ACTIVITY_CLASSES, dense_weights,
+              dense_bias, dense_shift, false, logits);
+
+    return (ActivityLabel_t)Int8ArgMax(ACTIVITY_CLASSES, logits);
+}
+
+/*
+ * Collect one sample; once the window is full classify it, publish the label and start
+ * over with a fresh window. Returns true when a new label has been published.
+ */
+bool ActivityClassifierAddSample(int16_t x, int16_t y, int16_t z)
+{
+    window[window_fill][0] = QuantizeAxis(x);
+    window[window_fill][1] = QuantizeAxis(y);
+    window[window_fill][2] = QuantizeAxis(z);
+
+    if (++window_fill < ACTIVITY_WINDOW_LEN) {
+        return false;
+    }
+
+    window_fill = 0;
+    CurrentActivityLabel = ActivityClassifierRun((const int8_t (*)[ACTIVITY_AXES])window);
+
+    return true;
+}
+
+/*
+ * The sensor stopped sampling. Samples collected before the gap say nothing about what
+ * comes after it, so the partial window is dropped and the label is idle until a full
+ * window has been seen again.
+ */
+void ActivityClassifierIdle(void)
+{
+    window_fill = 0;
+    CurrentActivityLabel = ACTIVITY_IDLE;
+}
+
+size_t ActivityClassifierArenaHighWater(void)
+{
+    return arena.high_water;
+}
+
+void ActivityClassifierInit(void)
+{
+    Int8ArenaInit(&arena, arena_buffer, sizeof(arena_buffer));
+    window_fill = 0;
+    CurrentActivityLabel = ACTIVITY_UNKNOWN;
+}
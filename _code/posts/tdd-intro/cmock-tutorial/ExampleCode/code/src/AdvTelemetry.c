@@ -0,0 +1,73 @@
+/**
+ ****************************************************************************************
+ *
+ * @file AdvTelemetry.c
+ *
+ * @brief Latest sensor values as a manufacturer-specific advertising data structure
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "AdvTelemetry.h"
+
+#define AD_TYPE_MANUFACTURER    (0xFF)
+
+enum {
+    OFFSET_LENGTH       = 0,
+    OFFSET_TYPE         = 1,
+    OFFSET_COMPANY      = 2,
+    OFFSET_VERSION      = 4,
+    OFFSET_SEQUENCE     = 5,
+    OFFSET_TEMPERATURE  = 6,
+    OFFSET_ACCELERATION = 8,
+    OFFSET_ACTIVITY     = 14,
+};
+
+static void PutS16(uint8_t *p, int16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+static void Updated(uint8_t *ad)
+{
+    ad[OFFSET_SEQUENCE]++;
+}
+
+void AdvTelemetryInit(uint8_t *ad, uint16_t company_id)
+{
+    memset(ad, 0, ADV_TELEMETRY_LEN);
+
+    ad[OFFSET_LENGTH] = ADV_TELEMETRY_LEN - 1;
+    ad[OFFSET_TYPE] = AD_TYPE_MANUFACTURER;
+    ad[OFFSET_COMPANY] = (uint8_t)company_id;
+    ad[OFFSET_COMPANY + 1] = (uint8_t)(company_id >> 8);
+    ad[OFFSET_VERSION] = ADV_TELEMETRY_VERSION;
+}
+
+void AdvTelemetrySetTemperature(uint8_t *ad, int16_t value)
+{
+    PutS16(&ad[OFFSET_TEMPERATURE], value);
+    Updated(ad);
+}
+
+void AdvTelemetrySetAcceleration(uint8_t *ad, const int16_t value[3])
+{
+    int c;
+
+    for (c = 0; c < 3; c++) {
+        PutS16(&ad[OFFSET_ACCELERATION + 2 * c], value[c]);
+    }
+    Updated(ad);
+}
+
+void AdvTelemetrySetActivity(uint8_t *ad, uint8_t label)
+{
+    ad[OFFSET_ACTIVITY] = label;
+    Updated(ad);
+}
+
+uint8_t AdvTelemetrySequence(const uint8_t *ad)
+{
+    return ad[OFFSET_SEQUENCE];
+}
@@ -0,0 +1,205 @@
+/**
+ ****************************************************************************************
+ *
+ * @file Allocator.c
+ *
+ * @brief Block pools with a fallback heap, accounted per allocation site
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "Allocator.h"
+
+/* Heap blocks follow each other in address order, size includes this header */
+typedef struct {
+    uint32_t size;
+    uint32_t used;
+} HeapBlock_t;
+
+#define HEAP_BLOCK_SIZE         EVENT_POOL_BLOCK_SIZE(sizeof(HeapBlock_t))
+
+static HeapBlock_t *NextBlock(const Allocator_t *alloc, HeapBlock_t *block)
+{
+    uint8_t *next = (uint8_t *)block + block->size;
+
+    return (next < alloc->heap + alloc->heap_len) ? (HeapBlock_t *)next : NULL;
+}
+
+/* Swallow the free blocks right after a free one */
+static void Merge(const Allocator_t *alloc, HeapBlock_t *block)
+{
+    HeapBlock_t *next;
+
+    while ((next = NextBlock(alloc, block)) && !next->used) {
+        block->size += next->size;
+    }
+}
+
+static void *HeapAlloc(Allocator_t *alloc, size_t need)
+{
+    HeapBlock_t *block = alloc->heap_len ? (HeapBlock_t *)alloc->heap : NULL;
+
+    need = EVENT_POOL_BLOCK_SIZE(HEAP_BLOCK_SIZE + need);
+
+    for (; block; block = NextBlock(alloc, block)) {
+        if (block->used) {
+            continue;
+        }
+
+        Merge(alloc, block);
+        if (block->size < need) {
+            continue;
+        }
+
+        /* Split off the rest unless it could not even hold a header */
+        if (block->size - need > HEAP_BLOCK_SIZE) {
+            HeapBlock_t *rest = (HeapBlock_t *)((uint8_t *)block + need);
+
+            rest->size = block->size - need;
+            rest->used = 0;
+            block->size = need;
+        }
+        block->used = 1;
+
+        return (uint8_t *)block + HEAP_BLOCK_SIZE;
+    }
+
+    return NULL;
+}
+
+/* Only the start of a block in use is taken, anything else would break the block chain */
+static bool HeapFree(Allocator_t *alloc, uint8_t *buf)
+{
+    HeapBlock_t *block = alloc->heap_len ? (HeapBlock_t *)alloc->heap : NULL;
+
+    if (buf < alloc->heap + HEAP_BLOCK_SIZE || buf >= alloc->heap + alloc->heap_len) {
+        return false;
+    }
+
+    while (block && (uint8_t *)block + HEAP_BLOCK_SIZE < buf) {
+        block = NextBlock(alloc, block);
+    }
+
+    if (!block || (uint8_t *)block + HEAP_BLOCK_SIZE != buf || !block->used) {
+        return false;
+    }
+    block->used = 0;
+
+    return true;
+}
+
+bool AllocatorInit(Allocator_t *alloc, void *pool_memory, size_t pool_len,
+                   const EventPoolClassConfig_t *classes, uint8_t count,
+                   void *heap, size_t heap_len)
+{
+    EventPoolClassConfig_t with_header[EVENT_POOL_MAX_CLASSES];
+    int c;
+
+    memset(alloc, 0, sizeof(*alloc));
+
+    if (count > EVENT_POOL_MAX_CLASSES) {
+        return false;
+    }
+
+    for (c = 0; c < count; c++) {
+        with_header[c].size = classes[c].size + ALLOCATOR_HEADER_SIZE;
+        with_header[c].count = classes[c].count;
+    }
+
+    if (!EventPoolInit(&alloc->pool, pool_memory, pool_len, with_header, count)) {
+        return false;
+    }
+
+    alloc->heap = heap;
+    alloc->heap_len = heap_len / EVENT_POOL_ALIGN * EVENT_POOL_ALIGN;
+    if (alloc->heap_len > HEAP_BLOCK_SIZE) {
+        HeapBlock_t *block = heap;
+
+        block->size = alloc->heap_len;
+        block->used = 0;
+    } else {
+        alloc->heap_len = 0;
+    }
+
+    return true;
+}
+
+void *AllocatorAlloc(Allocator_t *alloc, size_t size, AllocSite_t *site)
+{
+    AllocHeader_t *header;
+
+    if (!site->registered) {
+        site->registered = true;
+        site->next = alloc->sites;
+        alloc->sites = site;
+    }
+
+    header = EventPoolAlloc(&alloc->pool, size + ALLOCATOR_HEADER_SIZE);
+    if (!header) {
+        header = HeapAlloc(alloc, size + ALLOCATOR_HEADER_SIZE);
+        if (header) {
+            alloc->stats.from_heap++;
+        }
+    }
+
+    if (!header) {
+        site->failed++;
+        alloc->stats.failed++;
+        return NULL;
+    }
+
+    header->site = site;
+    header->size = size;
+
+    site->allocs++;
+    site->live += size;
+    if (site->live > site->peak) {
+        site->peak = site->live;
+    }
+    alloc->stats.live += size;
+    if (alloc->stats.live > alloc->stats.peak) {
+        alloc->stats.peak = alloc->stats.live;
+    }
+
+    return (uint8_t *)header + ALLOCATOR_HEADER_SIZE;
+}
+
+bool AllocatorFree(Allocator_t *alloc, void *buf)
+{
+    AllocHeader_t *header = (AllocHeader_t *)((uint8_t *)buf - ALLOCATOR_HEADER_SIZE);
+    /* Taken before the pool reuses the header as its free list link, used only if buf is */
+    AllocSite_t *site = header->site;
+    uint32_t size = header->size;
+
+    if (!EventPoolFree(&alloc->pool, header) && !HeapFree(alloc, (uint8_t *)header)) {
+        return false;
+    }
+
+    site->live -= size;
+    alloc->stats.live -= size;
+
+    return true;
+}
+
+void AllocatorHeapInfo(Allocator_t *alloc, size_t *free, size_t *largest)
+{
+    HeapBlock_t *block = alloc->heap_len ? (HeapBlock_t *)alloc->heap : NULL;
+
+    *free = 0;
+    *largest = 0;
+
+    for (; block; block = NextBlock(alloc, block)) {
+        size_t payload;
+
+        if (block->used) {
+            continue;
+        }
+
+        Merge(alloc, block);
+        payload = block->size - HEAP_BLOCK_SIZE;
+        *free += payload;
+        if (payload > ALLOCATOR_HEADER_SIZE && payload - ALLOCATOR_HEADER_SIZE > *largest) {
+            *largest = payload - ALLOCATOR_HEADER_SIZE;
+        }
+    }
+}
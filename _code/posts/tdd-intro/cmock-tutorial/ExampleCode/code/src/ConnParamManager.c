@@ -0,0 +1,176 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ConnParamManager.c
+ *
+ * @brief Pick the connection parameter profile of each link from its traffic
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "ConnectionTable.h"
+#include "ConnParamManager.h"
+
+typedef struct {
+    uint16_t      conn_idx;             // CONN_IDX_NONE while the slot is free
+    uint16_t      interval;
+    uint16_t      latency;
+    ConnProfile_t profile;              // what the link runs with
+    ConnProfile_t requested;            // what was last asked for
+    uint32_t      accounted_ms;         // statistics are up to date until here
+    uint32_t      event_rem;            // quarter ms since the last whole event
+    uint32_t      busy_ms;              // last time the link was busy
+} ConnParamLink_t;
+
+static ConnParamConfig_t  cfg;
+static ConnParamLink_t    links[CONN_MAX];
+static ConnProfileStats_t stats[CONN_PROFILE_COUNT];
+
+static ConnParamLink_t *FindLink(uint16_t conn_idx)
+{
+    int i;
+
+    for (i = 0; i < CONN_MAX; i++) {
+        if (links[i].conn_idx == conn_idx) {
+            return &links[i];
+        }
+    }
+
+    return NULL;
+}
+
+static ConnProfile_t Classify(uint16_t interval)
+{
+    return (interval <= cfg.throughput_interval_max) ? CONN_PROFILE_THROUGHPUT :
+                                                       CONN_PROFILE_LOW_POWER;
+}
+
+static void Account(ConnParamLink_t *link, uint32_t now_ms)
+{
+    ConnProfileStats_t *s = &stats[link->profile];
+    uint32_t elapsed = now_ms - link->accounted_ms;
+    uint32_t period = 5 * (uint32_t)link->interval * (1 + link->latency);
+    uint32_t quarters = elapsed * 4 + link->event_rem;
+
+    // one event every interval * 1.25 ms, skipped latency times in a row when idle; polls
+    // come more often than that with a high latency, so the rest carries over to the next
+    s->time_ms += elapsed;
+    s->events += quarters / period;
+    link->event_rem = quarters % period;
+
+    link->accounted_ms = now_ms;
+}
+
+void ConnParamInit(const ConnParamConfig_t *config)
+{
+    int i;
+
+    cfg = *config;
+    memset(stats, 0, sizeof(stats));
+    memset(links, 0, sizeof(links));
+
+    for (i = 0; i < CONN_MAX; i++) {
+        links[i].conn_idx = CONN_IDX_NONE;
+    }
+}
+
+void ConnParamOpen(uint16_t conn_idx, uint32_t now_ms, uint16_t interval, uint16_t latency)
+{
+    ConnParamLink_t *link = FindLink(CONN_IDX_NONE);
+
+    if (!link) {
+        return;
+    }
+
+    link->conn_idx = conn_idx;
+    link->interval = interval ? interval : 1;
+    link->latency = latency;
+    link->profile = Classify(link->interval);
+    link->requested = link->profile;
+    link->accounted_ms = now_ms;
+    link->event_rem = 0;
+
+    // discovery and subscriptions follow right away, treat a new link as busy
+    link->busy_ms = now_ms;
+}
+
+void ConnParamApplied(uint16_t conn_idx, uint32_t now_ms, uint16_t interval, uint16_t latency)
+{
+    ConnParamLink_t *link = FindLink(conn_idx);
+
+    if (!link) {
+        return;
+    }
+
+    Account(link, now_ms);
+
+    // the event spacing starts over with the new parameters
+    link->interval = interval ? interval : 1;
+    link->latency = latency;
+    link->profile = Classify(link->interval);
+    link->event_rem = 0;
+}
+
+void ConnParamClose(uint16_t conn_idx, uint32_t now_ms)
+{
+    ConnParamLink_t *link = FindLink(conn_idx);
+
+    if (link) {
+        Account(link, now_ms);
+        link->conn_idx = CONN_IDX_NONE;
+    }
+}
+
+bool ConnParamPoll(uint16_t conn_idx, uint32_t now_ms, uint32_t bytes, bool bulk,
+                   ConnProfile_t *request)
+{
+    ConnParamLink_t *link = FindLink(conn_idx);
+    ConnProfile_t want;
+
+    if (!link) {
+        return false;
+    }
+
+    Account(link, now_ms);
+    stats[link->profile].bytes += bytes;
+
+    if (bulk || bytes >= cfg.busy_bytes) {
+        link->busy_ms = now_ms;
+    }
+
+    want = (now_ms - link->busy_ms < cfg.idle_ms) ? CONN_PROFILE_THROUGHPUT : CONN_PROFILE_LOW_POWER;
+
+    // a central that turned the request down is not asked again until the need changes
+    if (want == link->requested) {
+        return false;
+    }
+
+    link->requested = want;
+    *request = want;
+    return true;
+}
+
+void ConnParamGetStats(ConnProfile_t profile, ConnProfileStats_t *out)
+{
+    *out = stats[profile];
+}
+
+uint32_t ConnParamThroughput(const ConnProfileStats_t *s)
+{
+    if (!s->time_ms) {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t)s->bytes * 1000 / s->time_ms);
+}
+
+uint32_t ConnParamAverageCurrent(const ConnProfileStats_t *s, uint32_t event_charge_nc,
+                                 uint32_t sleep_ua)
+{
+    if (!s->time_ms) {
+        return sleep_ua;
+    }
+
+    // nC per ms is uA
+    return sleep_ua + (uint32_t)((uint64_t)s->events * event_charge_nc / s->time_ms);
+}
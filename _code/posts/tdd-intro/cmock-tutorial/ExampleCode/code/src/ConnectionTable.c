@@ -0,0 +1,170 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ConnectionTable.c
+ *
+ * @brief Per-central state for fanning sensor updates out to several connections
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "ConnectionTable.h"
+
+static ConnRecord_t records[CONN_MAX];
+
+void ConnTableInit(void)
+{
+    int slot;
+
+    memset(records, 0, sizeof(records));
+    for (slot = 0; slot < CONN_MAX; slot++) {
+        records[slot].conn_idx = CONN_IDX_NONE;
+    }
+}
+
+ConnRecord_t *ConnTableFind(uint16_t conn_idx)
+{
+    int slot;
+
+    for (slot = 0; slot < CONN_MAX; slot++) {
+        if (records[slot].conn_idx == conn_idx) {
+            return &records[slot];
+        }
+    }
+
+    return NULL;
+}
+
+ConnRecord_t *ConnTableAdd(uint16_t conn_idx, uint16_t mtu, uint16_t ll_octets)
+{
+    ConnRecord_t *rec = ConnTableFind(CONN_IDX_NONE);
+
+    if (!rec) {
+        return NULL;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    rec->conn_idx = conn_idx;
+    rec->mtu = mtu;
+    rec->ll_octets = ll_octets;
+    rec->tx_credits = CONN_TX_CREDITS;
+
+    return rec;
+}
+
+void ConnTableRemove(uint16_t conn_idx)
+{
+    ConnRecord_t *rec = ConnTableFind(conn_idx);
+
+    if (rec) {
+        rec->conn_idx = CONN_IDX_NONE;
+    }
+}
+
+uint8_t ConnTableCount(void)
+{
+    uint8_t count = 0;
+    int slot;
+
+    for (slot = 0; slot < CONN_MAX; slot++) {
+        if (records[slot].conn_idx != CONN_IDX_NONE) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+ConnRecord_t *ConnTableAt(uint8_t slot)
+{
+    if (slot >= CONN_MAX || records[slot].conn_idx == CONN_IDX_NONE) {
+        return NULL;
+    }
+
+    return &records[slot];
+}
+
+void ConnSetCcc(ConnRecord_t *rec, uint8_t ch, uint16_t ccc)
+{
+    uint8_t bit = 1 << ch;
+
+    rec->notify_mask &= ~bit;
+    rec->indicate_mask &= ~bit;
+
+    if (ccc & CONN_CCC_NOTIFY) {
+        rec->notify_mask |= bit;
+    }
+    if (ccc & CONN_CCC_INDICATE) {
+        rec->indicate_mask |= bit;
+    }
+}
+
+uint16_t ConnGetCcc(const ConnRecord_t *rec, uint8_t ch)
+{
+    uint16_t ccc = 0;
+
+    if (rec->notify_mask & (1 << ch)) {
+        ccc |= CONN_CCC_NOTIFY;
+    }
+    if (rec->indicate_mask & (1 << ch)) {
+        ccc |= CONN_CCC_INDICATE;
+    }
+
+    return ccc;
+}
+
+bool ConnIsSubscribed(const ConnRecord_t *rec, uint8_t ch)
+{
+    return ((rec->notify_mask | rec->indicate_mask) & (1 << ch)) != 0;
+}
+
+void ConnSetDecimation(ConnRecord_t *rec, uint8_t ch, uint8_t decimation)
+{
+    rec->decimation[ch] = decimation;
+    rec->countdown[ch] = 0;
+}
+
+bool ConnTakeUpdate(ConnRecord_t *rec, uint8_t ch)
+{
+    if (!ConnIsSubscribed(rec, ch)) {
+        return false;
+    }
+
+    if (rec->countdown[ch]) {
+        rec->countdown[ch]--;
+        rec->decimated++;
+        return false;
+    }
+
+    if (rec->tx_credits == 0) {
+        // the countdown is kept, the first update after a credit came back is sent
+        rec->no_credit++;
+        return false;
+    }
+
+    rec->countdown[ch] = rec->decimation[ch] ? rec->decimation[ch] - 1 : 0;
+    rec->tx_credits--;
+    rec->sent++;
+
+    return true;
+}
+
+bool ConnIsDue(const ConnRecord_t *rec, uint8_t ch)
+{
+    return ConnIsSubscribed(rec, ch) && !rec->countdown[ch];
+}
+
+void ConnReturnCredit(ConnRecord_t *rec)
+{
+    if (rec->tx_credits < CONN_TX_CREDITS) {
+        rec->tx_credits++;
+    }
+}
+
+uint32_t ConnTakeBytes(ConnRecord_t *rec)
+{
+    uint32_t bytes = rec->bytes;
+
+    rec->bytes = 0;
+    return bytes;
+}
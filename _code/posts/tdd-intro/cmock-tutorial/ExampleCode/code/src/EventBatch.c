@@ -0,0 +1,67 @@
+/**
+ ****************************************************************************************
+ *
+ * @file EventBatch.c
+ *
+ * @brief Bound how many queued events one wakeup drains, and count the batch sizes
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "EventBatch.h"
+
+static uint8_t Bucket(uint16_t count)
+{
+    uint8_t bucket = 0;
+
+    while (count && bucket < EVENT_BATCH_BUCKETS - 1) {
+        count >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+void EventBatchInit(EventBatch_t *batch, uint16_t max_events, uint32_t budget)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->max_events = max_events;
+    batch->budget = budget;
+}
+
+void EventBatchBegin(EventBatch_t *batch, uint32_t now)
+{
+    batch->start = now;
+    batch->count = 0;
+}
+
+bool EventBatchNext(const EventBatch_t *batch, uint32_t now)
+{
+    if (batch->count == 0) {
+        return true;
+    }
+
+    return batch->count < batch->max_events && (uint32_t)(now - batch->start) <= batch->budget;
+}
+
+void EventBatchHandled(EventBatch_t *batch)
+{
+    batch->count++;
+}
+
+void EventBatchEnd(EventBatch_t *batch, bool pending)
+{
+    EventBatchStats_t *stats = &batch->stats;
+
+    stats->wakeups++;
+    stats->events += batch->count;
+    stats->histogram[Bucket(batch->count)]++;
+
+    if (batch->count > stats->largest) {
+        stats->largest = batch->count;
+    }
+
+    if (pending) {
+        stats->cut_short++;
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ ****************************************************************************************
+ *
+ * @file EventPool.c
+ *
+ * @brief Fixed-size buffers in a few size classes, for short-lived event messages
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "EventPool.h"
+
+static EventPoolClass_t *Owner(EventPool_t *pool, const uint8_t *buf)
+{
+    int c;
+
+    for (c = 0; c < pool->classes; c++) {
+        EventPoolClass_t *cls = &pool->cls[c];
+
+        if (buf >= cls->base && buf < cls->base + (size_t)cls->size * cls->count) {
+            return ((size_t)(buf - cls->base) % cls->size) ? NULL : cls;
+        }
+    }
+
+    return NULL;
+}
+
+bool EventPoolInit(EventPool_t *pool, void *memory, size_t len,
+                   const EventPoolClassConfig_t *config, uint8_t classes)
+{
+    uint8_t *p = memory;
+    size_t used = 0;
+    int c;
+
+    memset(pool, 0, sizeof(*pool));
+
+    if (classes > EVENT_POOL_MAX_CLASSES) {
+        return false;
+    }
+
+    for (c = 0; c < classes; c++) {
+        uint16_t size = EVENT_POOL_BLOCK_SIZE(config[c].size);
+
+        if ((c && size <= pool->cls[c - 1].size) || config[c].count > EVENT_POOL_MAX_BLOCKS) {
+            return false;
+        }
+        used += (size_t)size * config[c].count;
+        pool->cls[c].size = size;
+        pool->cls[c].count = config[c].count;
+    }
+
+    if (used > len) {
+        return false;
+    }
+
+    for (c = 0; c < classes; c++) {
+        EventPoolClass_t *cls = &pool->cls[c];
+        uint16_t i;
+
+        cls->base = p;
+
+        /* Link the blocks in address order, the first one is handed out first */
+        for (i = cls->count; i > 0; i--) {
+            EventPoolBlock_t *block = (EventPoolBlock_t *)(p + (size_t)(i - 1) * cls->size);
+
+            block->next = cls->free;
+            cls->free = block;
+        }
+        p += (size_t)cls->size * cls->count;
+    }
+    pool->classes = classes;
+
+    return true;
+}
+
+void *EventPoolAlloc(EventPool_t *pool, size_t size)
+{
+    EventPoolClass_t *wanted = NULL;
+    int c;
+
+    for (c = 0; c < pool->classes; c++) {
+        EventPoolClass_t *cls = &pool->cls[c];
+        EventPoolBlock_t *block;
+
+        if (cls->size < size) {
+            continue;
+        }
+        if (!wanted) {
+            wanted = cls;
+        }
+        if (!cls->free) {
+            continue;
+        }
+
+        block = cls->free;
+        cls->free = block->next;
+        cls->used |= 1UL << (((uint8_t *)block - cls->base) / cls->size);
+
+        cls->stats.allocs++;
+        if (cls != wanted) {
+            cls->stats.spills++;
+        }
+        if (++cls->stats.in_use > cls->stats.peak) {
+            cls->stats.peak = cls->stats.in_use;
+        }
+
+        return block;
+    }
+
+    if (wanted) {
+        wanted->stats.exhausted++;
+    } else {
+        pool->too_big++;
+    }
+
+    return NULL;
+}
+
+bool EventPoolFree(EventPool_t *pool, void *buf)
+{
+    EventPoolClass_t *cls = Owner(pool, buf);
+    EventPoolBlock_t *block = buf;
+    uint32_t bit;
+
+    if (!cls) {
+        return false;
+    }
+
+    /* A second free would put the block on the list twice */
+    bit = 1UL << (((uint8_t *)buf - cls->base) / cls->size);
+    if (!(cls->used & bit)) {
+        return false;
+    }
+    cls->used &= ~bit;
+
+    block->next = cls->free;
+    cls->free = block;
+    cls->stats.in_use--;
+
+    return true;
+}
@@ -0,0 +1,135 @@
+/**
+ ****************************************************************************************
+ *
+ * @file Int8Engine.c
+ *
+ * @brief Minimal int8 inference kernels with fixed-shape tensors
+ *
+ ****************************************************************************************
+ */
+#include "Int8Engine.h"
+
+void Int8ArenaInit(Int8Arena_t *arena, void *buffer, size_t size)
+{
+    arena->base       = (uint8_t *)buffer;
+    arena->size       = size;
+    arena->used       = 0;
+    arena->high_water = 0;
+}
+
+void *Int8ArenaAlloc(Int8Arena_t *arena, size_t size)
+{
+    size_t start = (arena->used + INT8_ARENA_ALIGN - 1) & ~(size_t)(INT8_ARENA_ALIGN - 1);
+
+    if (start + size > arena->size) {
+        return NULL;
+    }
+
+    arena->used = start + size;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+
+    return arena->base + start;
+}
+
+void Int8ArenaReset(Int8Arena_t *arena)
+{
+    arena->used = 0;
+}
+
+int8_t Int8Requantize(int32_t acc, uint8_t shift)
+{
+    if (shift > 0) {
+        // round half away from zero, the same way the offline quantizer does
+        int32_t half = (int32_t)1 << (shift - 1);
+        acc = (acc >= 0) ? ((acc + half) >> shift) : -((-acc + half) >> shift);
+    }
+
+    if (acc > INT8_MAX) {
+        return INT8_MAX;
+    }
+    if (acc < INT8_MIN) {
+        return INT8_MIN;
+    }
+    return (int8_t)acc;
+}
+
+void Int8Dense(int in_len, const int8_t input[in_len],
+               int out_len, const int8_t weights[out_len][in_len],
+               const int32_t *bias, uint8_t shift, bool relu,
+               int8_t output[out_len])
+{
+    int o, i;
+
+    for (o = 0; o < out_len; o++) {
+        int32_t acc = bias ? bias[o] : 0;
+
+        for (i = 0; i < in_len; i++) {
+            acc += (int32_t)input[i] * weights[o][i];
+        }
+
+        output[o] = Int8Requantize(acc, shift);
+        if (relu && output[o] < 0) {
+            output[o] = 0;
+        }
+    }
+}
+
+void Int8Conv1d(int in_len, int in_ch, const int8_t input[in_len][in_ch],
+                int out_ch, int kernel, int stride,
+                const int8_t weights[out_ch][kernel][in_ch],
+                const int32_t *bias, uint8_t shift, bool relu,
+                int8_t output[][out_ch])
+{
+    int out_len = INT8_CONV1D_OUT_LEN(in_len, kernel, stride);
+    int t, o, k, c;
+
+    for (t = 0; t < out_len; t++) {
+        const int8_t (*in)[in_ch] = &input[t * stride];
+
+        for (o = 0; o < out_ch; o++) {
+            int32_t acc = bias ? bias[o] : 0;
+
+            for (k = 0; k < kernel; k++) {
+                for (c = 0; c < in_ch; c++) {
+                    acc += (int32_t)in[k][c] * weights[o][k][c];
+                }
+            }
+
+            output[t][o] = Int8Requantize(acc, shift);
+            if (relu && output[t][o] < 0) {
+                output[t][o] = 0;
+            }
+        }
+    }
+}
+
+void Int8GlobalAvgPool1d(int len, int ch, const int8_t input[len][ch], int8_t output[ch])
+{
+    int t, c;
+
+    for (c = 0; c < ch; c++) {
+        int32_t sum = 0;
+
+        for (t = 0; t < len; t++) {
+            sum += input[t][c];
+        }
+
+        output[c] = (int8_t)(sum / len);
+    }
+}
+
+int Int8ArgMax(int len, const int8_t values[len])
+{
+    int best = 0;
+    int i;
+
+    for (i = 1; i < len; i++) {
+        if (values[i] > values[best]) {
+            best = i;
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,80 @@
+/**
+ ****************************************************************************************
+ *
+ * @file LazySampler.c
+ *
+ * @brief Sample a sensor only when one of its reads finds the cached value stale
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "LazySampler.h"
+
+void LazySamplerInit(LazySampler_t *sampler, SensorTime_t stale_after)
+{
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->stale_after = stale_after;
+}
+
+LazyRead_t LazySamplerRead(LazySampler_t *sampler, uint16_t conn_idx, SensorTime_t now,
+                           bool *start_measurement)
+{
+    *start_measurement = false;
+
+    if (sampler->valid && !SENSOR_TIME_AFTER_EQ(now, sampler->last_sample + sampler->stale_after)) {
+        return LAZY_READ_FRESH;
+    }
+
+    if (sampler->num_waiting == LAZY_MAX_WAITERS) {
+        return LAZY_READ_REJECTED;
+    }
+
+    sampler->waiting[sampler->num_waiting++] = conn_idx;
+
+    if (!sampler->pending) {
+        sampler->pending = true;
+        *start_measurement = true;
+    }
+
+    return LAZY_READ_DEFERRED;
+}
+
+static uint8_t TakeWaiting(LazySampler_t *sampler, uint16_t waiting[LAZY_MAX_WAITERS])
+{
+    uint8_t count = sampler->num_waiting;
+
+    sampler->pending = false;
+
+    memcpy(waiting, sampler->waiting, count * sizeof(sampler->waiting[0]));
+    sampler->num_waiting = 0;
+
+    return count;
+}
+
+uint8_t LazySamplerSampled(LazySampler_t *sampler, SensorTime_t timestamp,
+                           uint16_t waiting[LAZY_MAX_WAITERS])
+{
+    sampler->last_sample = timestamp;
+    sampler->valid = true;
+
+    return TakeWaiting(sampler, waiting);
+}
+
+/* The next stale read starts a new measurement */
+uint8_t LazySamplerFailed(LazySampler_t *sampler, uint16_t waiting[LAZY_MAX_WAITERS])
+{
+    return TakeWaiting(sampler, waiting);
+}
+
+void LazySamplerDrop(LazySampler_t *sampler, uint16_t conn_idx)
+{
+    uint8_t i = 0;
+
+    while (i < sampler->num_waiting) {
+        if (sampler->waiting[i] == conn_idx) {
+            sampler->waiting[i] = sampler->waiting[--sampler->num_waiting];
+        } else {
+            i++;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ ****************************************************************************************
+ *
+ * @file PoisonCheck.c
+ *
+ * @brief Verify poisoned memory areas a bounded slice at a time
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "PoisonCheck.h"
+
+void PoisonCheckInit(PoisonCheck_t *chk, uint32_t pattern, uint16_t slice, uint32_t period)
+{
+    memset(chk, 0, sizeof(*chk));
+    chk->pattern = pattern;
+    chk->slice = slice;
+    chk->period = period;
+}
+
+bool PoisonCheckAddArea(PoisonCheck_t *chk, uint32_t *start, size_t words)
+{
+    size_t i;
+
+    if (chk->count == POISON_CHECK_MAX_AREAS) {
+        return false;
+    }
+
+    for (i = 0; i < words; i++) {
+        start[i] = chk->pattern;
+    }
+
+    chk->areas[chk->count].start = start;
+    chk->areas[chk->count].words = words;
+    chk->count++;
+
+    return true;
+}
+
+bool PoisonCheckStep(PoisonCheck_t *chk, uint32_t now, const uint32_t **bad)
+{
+    uint16_t budget = chk->slice;
+
+    if (!chk->sweeping) {
+        if (chk->sweeps && (uint32_t)(now - chk->sweep_start) < chk->period) {
+            return true;
+        }
+
+        chk->sweeping = true;
+        chk->sweep_start = now;
+        chk->area = 0;
+        chk->offset = 0;
+    }
+
+    while (budget && chk->area < chk->count) {
+        const PoisonArea_t *area = &chk->areas[chk->area];
+        size_t n = area->words - chk->offset;
+        size_t i;
+
+        if (n > budget) {
+            n = budget;
+        }
+
+        for (i = chk->offset; i < chk->offset + n; i++) {
+            if (area->start[i] != chk->pattern) {
+                *bad = &area->start[i];
+                return false;
+            }
+        }
+
+        budget -= n;
+        chk->offset += n;
+        if (chk->offset == area->words) {
+            chk->area++;
+            chk->offset = 0;
+        }
+    }
+
+    if (chk->area == chk->count) {
+        chk->sweeping = false;
+        chk->sweeps++;
+        chk->last_sweep = now - chk->sweep_start;
+        if (chk->last_sweep > chk->period) {
+            chk->overdue++;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,74 @@
+/**
+ ****************************************************************************************
+ *
+ * @file PublishPolicy.c
+ *
+ * @brief Decide whether a new sample is worth publishing
+ *
+ ****************************************************************************************
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "PublishPolicy.h"
+
+static bool Significant(const PublishPolicy_t *policy, int16_t last, int16_t value)
+{
+    const PublishPolicyConfig_t *config = &policy->config;
+    uint32_t change = (uint32_t)abs((int32_t)value - last);
+    uint32_t reference = (uint32_t)abs(last);
+
+    if (!config->deadband && !config->relative_permille) {
+        return change != 0;
+    }
+
+    if (config->deadband && change > config->deadband) {
+        return true;
+    }
+
+    return config->relative_permille && change * 1000 > reference * config->relative_permille;
+}
+
+void PublishPolicyInit(PublishPolicy_t *policy, const PublishPolicyConfig_t *config,
+                       uint8_t channels)
+{
+    memset(policy, 0, sizeof(*policy));
+    policy->config = *config;
+    policy->channels = channels;
+}
+
+void PublishPolicyConfigure(PublishPolicy_t *policy, const PublishPolicyConfig_t *config)
+{
+    policy->config = *config;
+}
+
+bool PublishPolicyCheck(PublishPolicy_t *policy, const SensorSample_t *sample)
+{
+    SensorTime_t elapsed = sample->timestamp - policy->last_time;
+    bool publish = !policy->valid;
+    int c;
+
+    if (!publish && elapsed < policy->config.min_interval) {
+        policy->suppressed++;
+        return false;
+    }
+
+    if (policy->config.max_interval && elapsed >= policy->config.max_interval) {
+        publish = true;
+    }
+
+    for (c = 0; c < policy->channels && !publish; c++) {
+        publish = Significant(policy, policy->last[c], sample->value[c]);
+    }
+
+    if (!publish) {
+        policy->suppressed++;
+        return false;
+    }
+
+    policy->valid = true;
+    policy->last_time = sample->timestamp;
+    memcpy(policy->last, sample->value, sizeof(policy->last));
+    policy->published++;
+
+    return true;
+}
@@ -0,0 +1,130 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SampleBatch.c
+ *
+ * @brief Buffer timestamped samples and pack them into MTU-sized attribute payloads
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "SampleBatch.h"
+
+static const SensorSample_t *BatchSample(const SampleBatch_t *batch, uint8_t index)
+{
+    return &batch->samples[(batch->head + index) % SAMPLE_BATCH_LEN];
+}
+
+static uint8_t *PutU16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t *PutU32(uint8_t *p, uint32_t value)
+{
+    p = PutU16(p, (uint16_t)value);
+    return PutU16(p, (uint16_t)(value >> 16));
+}
+
+void SampleBatchInit(SampleBatch_t *batch, uint8_t channels)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->channels = channels;
+}
+
+void SampleBatchPush(SampleBatch_t *batch, const SensorSample_t *sample)
+{
+    if (batch->count == SAMPLE_BATCH_LEN) {
+        batch->head = (batch->head + 1) % SAMPLE_BATCH_LEN;
+        batch->count--;
+        batch->dropped++;
+    }
+
+    batch->samples[(batch->head + batch->count) % SAMPLE_BATCH_LEN] = *sample;
+    batch->count++;
+}
+
+void SampleBatchConsume(SampleBatch_t *batch, uint8_t count)
+{
+    if (count > batch->count) {
+        count = batch->count;
+    }
+
+    batch->head = (batch->head + count) % SAMPLE_BATCH_LEN;
+    batch->count -= count;
+}
+
+uint8_t SampleBatchCapacity(const SampleBatch_t *batch, size_t max_len)
+{
+    size_t capacity;
+
+    if (max_len <= SAMPLE_BATCH_HEADER_LEN) {
+        return 0;
+    }
+
+    capacity = (max_len - SAMPLE_BATCH_HEADER_LEN) / SAMPLE_BATCH_SAMPLE_LEN(batch->channels);
+    return (capacity > SAMPLE_BATCH_LEN) ? SAMPLE_BATCH_LEN : (uint8_t)capacity;
+}
+
+size_t SampleBatchPack(const SampleBatch_t *batch, uint8_t first, uint8_t *pdu,
+                       size_t max_len, uint8_t *packed)
+{
+    uint8_t capacity = SampleBatchCapacity(batch, max_len);
+    SensorTime_t base;
+    uint8_t *p;
+    uint8_t n;
+    int c;
+
+    *packed = 0;
+    if (capacity == 0 || first >= batch->count) {
+        return 0;
+    }
+
+    base = BatchSample(batch, first)->timestamp;
+    p = pdu + SAMPLE_BATCH_HEADER_LEN;
+
+    for (n = 0; n < capacity && first + n < batch->count; n++) {
+        const SensorSample_t *sample = BatchSample(batch, first + n);
+        SensorTime_t dt = sample->timestamp - base;
+
+        if (dt > UINT16_MAX) {
+            // the next payload starts a new base
+            break;
+        }
+
+        p = PutU16(p, (uint16_t)dt);
+        for (c = 0; c < batch->channels; c++) {
+            p = PutU16(p, (uint16_t)sample->value[c]);
+        }
+    }
+
+    pdu[0] = n;
+    pdu[1] = batch->channels;
+    PutU32(&pdu[2], base);
+
+    *packed = n;
+    return (size_t)(p - pdu);
+}
+
+void SampleBatchAccount(SampleBatchStats_t *stats, const SampleBatch_t *batch,
+                        size_t pdu_len, uint8_t packed, uint16_t ll_octets)
+{
+    size_t l2cap_len = pdu_len + SAMPLE_BATCH_ATT_OVERHEAD + SAMPLE_BATCH_L2CAP_OVERHEAD;
+    size_t ll_pdus = (l2cap_len + ll_octets - 1) / ll_octets;
+
+    stats->pdus++;
+    stats->samples += packed;
+    stats->payload_bytes += packed * SAMPLE_BATCH_SAMPLE_LEN(batch->channels);
+    stats->air_bytes += l2cap_len + ll_pdus * SAMPLE_BATCH_LL_OVERHEAD;
+}
+
+uint16_t SampleBatchEfficiency(const SampleBatchStats_t *stats)
+{
+    if (stats->air_bytes == 0) {
+        return 0;
+    }
+
+    return (uint16_t)(((uint64_t)stats->payload_bytes * 1000) / stats->air_bytes);
+}
@@ -0,0 +1,75 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SampleLog.c
+ *
+ * @brief Sample history kept as fixed-size records in a byte ring
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "SampleLog.h"
+
+void SampleLogInit(SampleLog_t *log, uint8_t *storage, uint32_t size)
+{
+    log->storage = storage;
+    log->size = size - size % SAMPLE_LOG_RECORD_LEN;
+    log->head = 0;
+    log->tail = 0;
+}
+
+void SampleLogAppend(SampleLog_t *log, uint8_t source, uint8_t channels,
+                     const SensorSample_t *sample)
+{
+    // the size is a multiple of the record length, so a record never wraps
+    uint8_t *p = &log->storage[log->head % log->size];
+    int c;
+
+    if (log->head - log->tail == log->size) {
+        log->tail += SAMPLE_LOG_RECORD_LEN;
+    }
+
+    p[0] = (uint8_t)sample->timestamp;
+    p[1] = (uint8_t)(sample->timestamp >> 8);
+    p[2] = (uint8_t)(sample->timestamp >> 16);
+    p[3] = (uint8_t)(sample->timestamp >> 24);
+    p[4] = source;
+    p[5] = channels;
+
+    for (c = 0; c < SENSOR_MAX_CHANNELS; c++) {
+        uint16_t value = (c < channels) ? (uint16_t)sample->value[c] : 0;
+
+        p[6 + 2 * c] = (uint8_t)value;
+        p[7 + 2 * c] = (uint8_t)(value >> 8);
+    }
+
+    log->head += SAMPLE_LOG_RECORD_LEN;
+}
+
+uint32_t SampleLogPeek(const SampleLog_t *log, uint32_t *offset, const uint8_t **data)
+{
+    uint32_t pos;
+    uint32_t len;
+
+    *offset -= *offset % SAMPLE_LOG_RECORD_LEN;
+
+    if (*offset < log->tail) {
+        *offset = log->tail;
+    }
+
+    if (*offset >= log->head) {
+        *offset = log->head;
+        return 0;
+    }
+
+    pos = *offset % log->size;
+    len = log->head - *offset;
+
+    // stop at the end of the ring, the rest starts over at the beginning of the storage
+    if (len > log->size - pos) {
+        len = log->size - pos;
+    }
+
+    *data = &log->storage[pos];
+    return len;
+}
@@ -0,0 +1,186 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SensorExecutor.c
+ *
+ * @brief One task running every sensor driver as a stackless coroutine
+ *
+ ****************************************************************************************
+ */
+#include "SensorExecutor.h"
+#include "app_rtos.h"
+
+static OS_TASK handle = NULL;
+static SensorThread_t *threads = NULL;
+/* Only ever touched on the executor task, by the threads */
+static SensorThread_t *bus_owner = NULL;
+
+#define NOTIF_RUN                       (1 << 1)
+
+static void Wake(void)
+{
+    if (handle) {
+        OS_TASK_NOTIFY(handle, NOTIF_RUN, OS_NOTIFY_SET_BITS);
+    }
+}
+
+uint32_t SensorThreadTakeEvents(SensorThread_t *thread, uint32_t mask)
+{
+    uint32_t events;
+
+    OS_ENTER_CRITICAL_SECTION();
+    events = thread->events & mask;
+    thread->events &= ~events;
+    OS_LEAVE_CRITICAL_SECTION();
+
+    return events;
+}
+
+void SensorThreadStartDelay(SensorThread_t *thread, OS_TICK_TIME ticks)
+{
+    thread->delayed = true;
+    thread->delay_start = OS_GET_TICK_COUNT();
+    thread->delay = ticks;
+}
+
+bool SensorThreadDelayOver(SensorThread_t *thread)
+{
+    if ((OS_TICK_TIME)(OS_GET_TICK_COUNT() - thread->delay_start) < thread->delay) {
+        return false;
+    }
+
+    thread->delayed = false;
+    return true;
+}
+
+/*
+ * Runs from the I2C interrupt once the transfer is over. The OSAL macro switches to the
+ * executor on return from the interrupt when it has a higher priority than the task that
+ * was interrupted.
+ */
+STATIC void SensorExecutorI2cDone(void *user_data, HW_I2C_ABORT_SOURCE error)
+{
+    SensorThread_t *thread = user_data;
+
+    thread->i2c_error = error;
+    thread->i2c_busy = false;
+    if (handle) {
+        OS_TASK_NOTIFY_FROM_ISR(handle, NOTIF_RUN, OS_NOTIFY_SET_BITS);
+    }
+}
+
+void SensorThreadStartI2cRead(SensorThread_t *thread, i2c_device dev, const uint8_t *wbuf,
+                              size_t wlen, uint8_t *rbuf, size_t rlen)
+{
+    thread->i2c_busy = true;
+    ad_i2c_async_transact(dev, wbuf, wlen, rbuf, rlen, SensorExecutorI2cDone, thread);
+}
+
+bool SensorThreadTakeBus(SensorThread_t *thread)
+{
+    if (bus_owner && bus_owner != thread) {
+        return false;
+    }
+
+    bus_owner = thread;
+    return true;
+}
+
+void SensorThreadGiveBus(SensorThread_t *thread)
+{
+    if (bus_owner != thread) {
+        return;
+    }
+
+    /* Threads ahead of this one in the list only see it free on the next pass */
+    bus_owner = NULL;
+    Wake();
+}
+
+STATIC OS_TICK_TIME SensorExecutorRun(void)
+{
+    OS_TICK_TIME timeout = OS_TASK_NOTIFY_FOREVER;
+    SensorThread_t *thread;
+
+    for (thread = threads; thread; thread = thread->next) {
+        OS_TICK_TIME elapsed;
+
+        if (!thread->run) {
+            continue;
+        }
+
+        if (thread->run(thread) == CO_DONE) {
+            thread->run = NULL;
+            continue;
+        }
+
+        if (!thread->delayed) {
+            continue;
+        }
+
+        elapsed = (OS_TICK_TIME)(OS_GET_TICK_COUNT() - thread->delay_start);
+        if (elapsed >= thread->delay) {
+            /* Ran out while the others were running, come back right away */
+            timeout = 0;
+        } else if (thread->delay - elapsed < timeout) {
+            timeout = thread->delay - elapsed;
+        }
+    }
+
+    return timeout;
+}
+
+static void SensorExecutorTask(void *param)
+{
+    OS_TICK_TIME timeout = OS_TASK_NOTIFY_FOREVER;
+
+    for (;;) {
+        uint32_t notif;
+
+        /* A timeout only means a delay ran out, the threads check that themselves */
+        OS_TASK_NOTIFY_WAIT(0, (uint32_t) -1, &notif, timeout);
+
+        timeout = SensorExecutorRun();
+    }
+}
+
+void SensorExecutorInit(void)
+{
+    threads = NULL;
+    bus_owner = NULL;
+
+    APP_TASK_CREATE("sensors", SensorExecutorTask, NULL, SENSOR_EXECUTOR_STACK_SIZE,
+                                                        OS_TASK_PRIORITY_NORMAL, handle);
+}
+
+OS_TASK SensorExecutorGetTask(void)
+{
+    return handle;
+}
+
+void SensorExecutorAdd(SensorThread_t *thread, SensorThreadFn_t run)
+{
+    CO_INIT(&thread->co);
+    thread->run = run;
+    thread->events = 0;
+    thread->delayed = false;
+    thread->i2c_busy = false;
+    thread->i2c_error = 0;
+
+    OS_ENTER_CRITICAL_SECTION();
+    thread->next = threads;
+    threads = thread;
+    OS_LEAVE_CRITICAL_SECTION();
+
+    /* Let it run up to its first wait */
+    Wake();
+}
+
+void SensorExecutorSignal(SensorThread_t *thread, uint32_t events)
+{
+    OS_ENTER_CRITICAL_SECTION();
+    thread->events |= events;
+    OS_LEAVE_CRITICAL_SECTION();
+
+    Wake();
+}
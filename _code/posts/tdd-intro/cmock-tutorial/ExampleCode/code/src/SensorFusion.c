@@ -0,0 +1,171 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SensorFusion.c
+ *
+ * @brief Align temperature and accelerometer samples onto one timeline
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "SensorFusion.h"
+
+typedef struct {
+    SensorSample_t history[FUSION_HISTORY_LEN];     // ring, oldest overwritten first
+    uint8_t        head;                            // slot of the newest sample
+    uint8_t        count;
+    uint8_t        channels;
+} FusionStream_t;
+
+typedef enum {
+    FUSION_VALUE_EXACT = 0,     // interpolated between two samples or an exact hit
+    FUSION_VALUE_PENDING,       // stream has not reached t yet, newest value held
+    FUSION_VALUE_HELD,          // t predates the history, oldest value held
+} FusionValue_t;
+
+static FusionStream_t streams[SENSOR_STREAMS];
+static SensorTime_t frame_period;
+static SensorTime_t max_lag;
+static SensorTime_t next_frame;
+static bool timeline_started;
+static SensorFrameCb_t frame_cb;
+
+static const uint8_t stream_channels[SENSOR_STREAMS] = {
+    [SENSOR_STREAM_TEMPERATURE]  = 1,
+    [SENSOR_STREAM_ACCELERATION] = 3,
+};
+
+STATIC int16_t Interpolate(const SensorSample_t *a, const SensorSample_t *b,
+                           SensorTime_t t, int channel)
+{
+    int32_t span = (int32_t)(b->timestamp - a->timestamp);
+    int32_t offset = (int32_t)(t - a->timestamp);
+    int32_t delta = (int32_t)b->value[channel] - a->value[channel];
+
+    if (span <= 0 || offset <= 0) {
+        return a->value[channel];
+    }
+    if (offset >= span) {
+        return b->value[channel];
+    }
+
+    return (int16_t)(a->value[channel] + (delta * offset) / span);
+}
+
+static const SensorSample_t *StreamSample(const FusionStream_t *s, int age)
+{
+    return &s->history[(s->head + FUSION_HISTORY_LEN - age) % FUSION_HISTORY_LEN];
+}
+
+/* Value of a stream at time t */
+static FusionValue_t StreamValueAt(const FusionStream_t *s, SensorTime_t t, int16_t *out)
+{
+    const SensorSample_t *newer, *older;
+    int age, c;
+
+    if (s->count == 0) {
+        return FUSION_VALUE_PENDING;
+    }
+
+    newer = StreamSample(s, 0);
+    if (!SENSOR_TIME_AFTER_EQ(newer->timestamp, t)) {
+        // not there yet, hold the newest value in case the caller gives up waiting
+        for (c = 0; c < s->channels; c++) {
+            out[c] = newer->value[c];
+        }
+        return FUSION_VALUE_PENDING;
+    }
+
+    // walk back to the pair bracketing t, the oldest sample is held if t predates it
+    for (age = 1; age < s->count; age++) {
+        older = StreamSample(s, age);
+        if (SENSOR_TIME_AFTER_EQ(t, older->timestamp)) {
+            for (c = 0; c < s->channels; c++) {
+                out[c] = Interpolate(older, newer, t, c);
+            }
+            return FUSION_VALUE_EXACT;
+        }
+        newer = older;
+    }
+
+    for (c = 0; c < s->channels; c++) {
+        out[c] = newer->value[c];
+    }
+    return (newer->timestamp == t) ? FUSION_VALUE_EXACT : FUSION_VALUE_HELD;
+}
+
+static int16_t *FrameChannels(SensorFrame_t *frame, SensorStream_t stream)
+{
+    return (stream == SENSOR_STREAM_TEMPERATURE) ? &frame->temperature : frame->acceleration;
+}
+
+static void EmitReadyFrames(SensorTime_t newest)
+{
+    for (;;) {
+        SensorFrame_t frame;
+        uint8_t pending = 0;
+        bool lagging;
+        int s;
+
+        memset(&frame, 0, sizeof(frame));
+        frame.timestamp = next_frame;
+
+        for (s = 0; s < SENSOR_STREAMS; s++) {
+            switch (StreamValueAt(&streams[s], next_frame, FrameChannels(&frame, s))) {
+            case FUSION_VALUE_PENDING:
+                pending |= (1 << s);
+                break;
+            case FUSION_VALUE_HELD:
+                frame.stale_mask |= (1 << s);
+                break;
+            default:
+                break;
+            }
+        }
+
+        lagging = !SENSOR_TIME_AFTER_EQ(next_frame + max_lag, newest);
+        if (pending && !lagging) {
+            return;
+        }
+        frame.stale_mask |= pending;
+
+        if (frame_cb) {
+            frame_cb(&frame);
+        }
+        next_frame += frame_period;
+    }
+}
+
+void SensorFusionPush(SensorStream_t stream, const SensorSample_t *sample)
+{
+    FusionStream_t *s = &streams[stream];
+
+    if (!timeline_started) {
+        // first grid point at or after the first sample
+        next_frame = ((sample->timestamp + frame_period - 1) / frame_period) * frame_period;
+        timeline_started = true;
+    }
+
+    s->head = (s->head + 1) % FUSION_HISTORY_LEN;
+    s->history[s->head] = *sample;
+    if (s->count < FUSION_HISTORY_LEN) {
+        s->count++;
+    }
+
+    EmitReadyFrames(sample->timestamp);
+}
+
+void SensorFusionInit(SensorTime_t period, SensorTime_t lag, SensorFrameCb_t cb)
+{
+    int s;
+
+    memset(streams, 0, sizeof(streams));
+    for (s = 0; s < SENSOR_STREAMS; s++) {
+        streams[s].channels = stream_channels[s];
+    }
+
+    frame_period = period;
+    max_lag = lag;
+    frame_cb = cb;
+    timeline_started = false;
+}
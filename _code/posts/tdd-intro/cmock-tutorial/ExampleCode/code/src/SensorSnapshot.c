@@ -0,0 +1,95 @@
+/**
+ ****************************************************************************************
+ *
+ * @file SensorSnapshot.c
+ *
+ * @brief Latest value of every sensor packed into one characteristic value
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "SensorSnapshot.h"
+
+enum {
+    OFFSET_VERSION      = 0,
+    OFFSET_VALID        = 1,
+    OFFSET_TEMPERATURE  = 2,
+    OFFSET_ACCELERATION = 8,
+    OFFSET_TILT         = 18,
+    OFFSET_ACTIVITY     = 30,
+    OFFSET_FRAME        = 35,
+};
+
+static void PutU16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void PutU32(uint8_t *p, uint32_t value)
+{
+    PutU16(&p[0], (uint16_t)value);
+    PutU16(&p[2], (uint16_t)(value >> 16));
+}
+
+/* Every field starts with its timestamp */
+static uint8_t *Field(uint8_t *pdu, uint8_t offset, uint8_t bit, SensorTime_t timestamp)
+{
+    pdu[OFFSET_VALID] |= bit;
+    PutU32(&pdu[offset], timestamp);
+
+    return &pdu[offset + sizeof(uint32_t)];
+}
+
+void SensorSnapshotInit(uint8_t *pdu)
+{
+    memset(pdu, 0, SENSOR_SNAPSHOT_LEN);
+
+    pdu[OFFSET_VERSION] = SENSOR_SNAPSHOT_VERSION;
+}
+
+void SensorSnapshotSetTemperature(uint8_t *pdu, const SensorSample_t *sample)
+{
+    uint8_t *p = Field(pdu, OFFSET_TEMPERATURE, SNAPSHOT_TEMPERATURE, sample->timestamp);
+
+    PutU16(p, (uint16_t)sample->value[0]);
+}
+
+void SensorSnapshotSetAcceleration(uint8_t *pdu, const SensorSample_t *sample)
+{
+    uint8_t *p = Field(pdu, OFFSET_ACCELERATION, SNAPSHOT_ACCELERATION, sample->timestamp);
+    int c;
+
+    for (c = 0; c < 3; c++) {
+        PutU16(&p[2 * c], (uint16_t)sample->value[c]);
+    }
+}
+
+void SensorSnapshotSetTilt(uint8_t *pdu, SensorTime_t timestamp, const Tilt_t *tilt)
+{
+    uint8_t *p = Field(pdu, OFFSET_TILT, SNAPSHOT_TILT, timestamp);
+
+    PutU16(&p[0], (uint16_t)tilt->pitch);
+    PutU16(&p[2], (uint16_t)tilt->roll);
+    PutU16(&p[4], (uint16_t)tilt->tilt);
+    PutU16(&p[6], tilt->magnitude);
+}
+
+void SensorSnapshotSetActivity(uint8_t *pdu, SensorTime_t timestamp, uint8_t label)
+{
+    uint8_t *p = Field(pdu, OFFSET_ACTIVITY, SNAPSHOT_ACTIVITY, timestamp);
+
+    p[0] = label;
+}
+
+void SensorSnapshotSetFrame(uint8_t *pdu, const SensorFrame_t *frame)
+{
+    uint8_t *p = Field(pdu, OFFSET_FRAME, SNAPSHOT_FRAME, frame->timestamp);
+    int c;
+
+    PutU16(&p[0], (uint16_t)frame->temperature);
+    for (c = 0; c < 3; c++) {
+        PutU16(&p[2 + 2 * c], (uint16_t)frame->acceleration[c]);
+    }
+    p[8] = frame->stale_mask;
+}
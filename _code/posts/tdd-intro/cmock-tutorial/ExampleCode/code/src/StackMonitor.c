@@ -0,0 +1,86 @@
+/**
+ ****************************************************************************************
+ *
+ * @file StackMonitor.c
+ *
+ * @brief Track the stack high-water mark of tasks and suggest right-sized stacks
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "StackMonitor.h"
+
+static void PutU16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+void StackMonitorInit(StackMonitor_t *mon, StackMonitorMeasure_t measure)
+{
+    memset(mon, 0, sizeof(*mon));
+    mon->measure = measure;
+}
+
+bool StackMonitorAdd(StackMonitor_t *mon, const char *name, void *task, uint16_t size)
+{
+    StackMonitorEntry_t *entry;
+
+    if (mon->count == STACK_MONITOR_MAX_TASKS) {
+        return false;
+    }
+
+    entry = &mon->tasks[mon->count++];
+    entry->name = name;
+    entry->task = task;
+    entry->size = size;
+    entry->min_free = size;
+    entry->measured = false;
+
+    return true;
+}
+
+const StackMonitorEntry_t *StackMonitorStep(StackMonitor_t *mon)
+{
+    StackMonitorEntry_t *entry;
+    uint32_t free;
+
+    if (!mon->count) {
+        return NULL;
+    }
+
+    entry = &mon->tasks[mon->next];
+    mon->next = (mon->next + 1) % mon->count;
+
+    free = mon->measure(entry->task);
+    if (free < entry->min_free) {
+        entry->min_free = (uint16_t)free;
+    }
+    entry->measured = true;
+
+    return entry;
+}
+
+uint16_t StackMonitorUsed(const StackMonitorEntry_t *entry)
+{
+    return entry->measured ? entry->size - entry->min_free : 0;
+}
+
+uint16_t StackMonitorSuggest(const StackMonitorEntry_t *entry, uint8_t margin_percent)
+{
+    uint32_t size = (uint32_t)StackMonitorUsed(entry) * (100 + margin_percent) / 100;
+
+    return (uint16_t)((size + 7) & ~7UL);
+}
+
+void StackMonitorPack(const StackMonitor_t *mon, uint8_t *pdu)
+{
+    int i;
+
+    memset(pdu, 0, STACK_MONITOR_PDU_LEN);
+    pdu[0] = mon->count;
+    for (i = 0; i < mon->count; i++) {
+        PutU16(&pdu[1 + 4 * i], mon->tasks[i].size);
+        PutU16(&pdu[3 + 4 * i], StackMonitorUsed(&mon->tasks[i]));
+    }
+}
@@ -17,12 +17,25 @@ static const uint8_t SI7060_ID           = 0xC0    ;// chipID | revID
 static const uint8_t SI7060_DSPSIGM      = 0xC1    ;// most significant bits temperature conversion
 static const uint8_t SI7060_DSPSIGL      = 0xC2    ;// least significant bits temperature conversion
 
-static OS_TASK handle = NULL;
+static SensorThread_t thread;
+static i2c_device thread_dev;
+static uint8_t thread_msb, thread_lsb;
+static uint8_t thread_attempts;
 
 #define NOTIF_DO_MEASUREMENT            (1 << 1)
 
+/* A failed transfer is not a sample, the measurement is tried again after this */
+#define TEMP_I2C_RETRY_MS               (100)
+
+/* Attempts before a measurement is given up and reported as failed */
+#define TEMP_I2C_MAX_ATTEMPTS           (3)
+
 extern __RETAINED_RW int16_t CurrentTemperatureValue;
 
+static SensorSample_t LatestSample;
+static SensorSampleCb_t SampleCb = NULL;
+static SensorSampleCb_t FailCb = NULL;
+
 STATIC int16_t ConvertTemperatureFromRegisters(uint8_t RegisterMostSignificantByte,
                 uint8_t RegisterLessSignificantByte){
 
@@ -50,6 +63,20 @@ STATIC void ReadSensorRegisters( uint8_t *RegisterWithMSB, uint8_t *RegisterWith
     ad_i2c_close(i2c_dev);
 }
 
+static void StoreTemperature(int16_t Temperature, SensorTime_t Timestamp)
+{
+    CurrentTemperatureValue = Temperature;    
+
+    OS_ENTER_CRITICAL_SECTION();
+    LatestSample.timestamp = Timestamp;
+    LatestSample.value[0] = Temperature;
+    OS_LEAVE_CRITICAL_SECTION();
+
+    if (SampleCb) {
+        SampleCb();
+    }
+}
+
 STATIC int16_t ReadTemperatureFromI2C(void)
 {
     uint8_t _dspsigm, _dspsigl;
@@ -57,29 +84,79 @@ STATIC int16_t ReadTemperatureFromI2C(void)
 
     ReadSensorRegisters( &_dspsigm, &_dspsigl); 
     Temperature = ConvertTemperatureFromRegisters(_dspsigm, _dspsigl);
-    
-    CurrentTemperatureValue = Temperature;    
+    StoreTemperature(Temperature, OS_GET_TICK_COUNT());
+
     return Temperature; 
 }
 
-STATIC void TemperatureDriverTask(void *param)
+/*
+ * Same as ReadTemperatureFromI2C() but waits for the bus in the executor instead of
+ * blocking, everything kept across a wait lives in file scope. Reads parked on the lazy
+ * sampler wait for this measurement, so a failed one is retried a few times and then
+ * reported, so that they are answered before the peer's ATT timeout.
+ */
+STATIC CoState_t TemperatureDriverThread(SensorThread_t *t)
 {
-    for (;;) {
-        OS_BASE_TYPE ret;
-        uint32_t notif;
+    uint32_t events;
 
-        ret = OS_TASK_NOTIFY_WAIT(0, (uint32_t) -1, &notif, OS_TASK_NOTIFY_FOREVER);
-        OS_ASSERT(ret == OS_OK);
+    CO_BEGIN(&t->co);
 
-        if (notif & NOTIF_DO_MEASUREMENT) {
-            ReadTemperatureFromI2C();
+    for (;;) {
+        SENSOR_WAIT_EVENT(t, NOTIF_DO_MEASUREMENT, events);
+
+        for (thread_attempts = 1; ; thread_attempts++) {
+            SENSOR_I2C_TAKE(t);
+            thread_dev = ad_i2c_open(SI7060);
+            SENSOR_I2C_READ(t, thread_dev, &SI7060_DSPSIGM, sizeof(SI7060_DSPSIGM),
+                                                        &thread_msb, sizeof(thread_msb));
+            if (!t->i2c_error) {
+                SENSOR_I2C_READ(t, thread_dev, &SI7060_DSPSIGL, sizeof(SI7060_DSPSIGL),
+                                                        &thread_lsb, sizeof(thread_lsb));
+            }
+            ad_i2c_close(thread_dev);
+            SENSOR_I2C_GIVE(t);
+
+            if (!t->i2c_error || thread_attempts == TEMP_I2C_MAX_ATTEMPTS) {
+                break;
+            }
+            SENSOR_DELAY(t, OS_MS_2_TICKS(TEMP_I2C_RETRY_MS));
+        }
+
+        if (t->i2c_error) {
+            if (FailCb) {
+                FailCb();
+            }
+            continue;
         }
+
+        // [6:0]bits are the conversion result
+        StoreTemperature(ConvertTemperatureFromRegisters(thread_msb & 0x7F, thread_lsb),
+                                                        OS_GET_TICK_COUNT());
     }
+
+    CO_END(&t->co);
 }
 
 void DoMeasurementTemperature(void)
 {
-    OS_TASK_NOTIFY(handle, NOTIF_DO_MEASUREMENT, OS_NOTIFY_SET_BITS);
+    SensorExecutorSignal(&thread, NOTIF_DO_MEASUREMENT);
+}
+
+void TemperatureDriverRegisterSampleCb(SensorSampleCb_t cb)
+{
+    SampleCb = cb;
+}
+
+void TemperatureDriverRegisterFailCb(SensorSampleCb_t cb)
+{
+    FailCb = cb;
+}
+
+void TemperatureDriverGetSample(SensorSample_t *sample)
+{
+    OS_ENTER_CRITICAL_SECTION();
+    *sample = LatestSample;
+    OS_LEAVE_CRITICAL_SECTION();
 }
 
 void InitTemperatureSensorDriver(void)
@@ -89,5 +166,8 @@ void InitTemperatureSensorDriver(void)
      * register of the sensor after power up.
      */
 
-    OS_TASK_CREATE("temp_sensor", TemperatureDriverTask, NULL, 400, OS_TASK_PRIORITY_NORMAL, handle);
+    /* First value right away, before anyone asks for a measurement */
+    ReadTemperatureFromI2C();
+
+    SensorExecutorAdd(&thread, TemperatureDriverThread);
 }
@@ -0,0 +1,153 @@
+/**
+ ****************************************************************************************
+ *
+ * @file TiltEstimator.c
+ *
+ * @brief Fixed-point pitch, roll and tilt from accelerometer XYZ
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "TiltEstimator.h"
+
+/* atan(2^-i) in millidegrees */
+static const int32_t cordic_atan[CORDIC_ITERATIONS] = {
+    45000, 26565, 14036, 7125, 3576, 1790, 895, 448,
+    224, 112, 56, 28, 14, 7, 3, 2,
+};
+
+/* Fractional bits added to the inputs so the shifts in the loop keep their precision */
+#define CORDIC_PRESHIFT         (8)
+
+/* 1/K of the CORDIC rotation gain, Q16 */
+#define CORDIC_INV_GAIN_Q16     (39797u)
+
+/* Filter state keeps 8 fractional bits so small steps do not stall */
+#define TILT_FILTER_FRAC        (8)
+
+static uint8_t filter_shift;
+static int16_t axis_offset[3];
+static int32_t filtered[3];
+static uint8_t filter_primed;
+
+STATIC int32_t WrapAngle(int32_t angle, int32_t half_turn)
+{
+    while (angle > half_turn) {
+        angle -= 2 * half_turn;
+    }
+    while (angle <= -half_turn) {
+        angle += 2 * half_turn;
+    }
+    return angle;
+}
+
+/*
+ * Rotate (x, y) onto the positive x axis. Returns the rotated angle in centidegrees and,
+ * from the same pass, the length of the vector in *magnitude.
+ */
+static int32_t CordicVector(int32_t x, int32_t y, uint32_t *magnitude)
+{
+    int32_t angle = 0;
+    int i;
+
+    if (x == 0 && y == 0) {
+        *magnitude = 0;
+        return 0;
+    }
+
+    x <<= CORDIC_PRESHIFT;
+    y <<= CORDIC_PRESHIFT;
+
+    // bring the vector into the right half plane, where vectoring converges
+    if (x < 0) {
+        angle = (y >= 0) ? 180000 : -180000;
+        x = -x;
+        y = -y;
+    }
+
+    for (i = 0; i < CORDIC_ITERATIONS; i++) {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+
+        if (y > 0) {
+            x += dx;
+            y -= dy;
+            angle += cordic_atan[i];
+        } else {
+            x -= dx;
+            y += dy;
+            angle -= cordic_atan[i];
+        }
+    }
+
+    *magnitude = (((uint32_t)x >> CORDIC_PRESHIFT) * CORDIC_INV_GAIN_Q16 + 0x8000u) >> 16;
+
+    // millidegrees to centidegrees, rounded
+    angle = (angle >= 0) ? (angle + 5) / 10 : (angle - 5) / 10;
+    return WrapAngle(angle, TILT_CENTIDEG_180);
+}
+
+int32_t CordicAtan2(int32_t y, int32_t x)
+{
+    uint32_t magnitude;
+
+    return CordicVector(x, y, &magnitude);
+}
+
+uint32_t CordicHypot(int32_t x, int32_t y)
+{
+    uint32_t magnitude;
+
+    CordicVector(x, y, &magnitude);
+    return magnitude;
+}
+
+static int16_t FilterAngle(int idx, int32_t angle)
+{
+    int32_t target = angle << TILT_FILTER_FRAC;
+    int32_t half_turn = (int32_t)TILT_CENTIDEG_180 << TILT_FILTER_FRAC;
+
+    if (!filter_shift || !(filter_primed & (1 << idx))) {
+        filtered[idx] = target;
+        filter_primed |= (1 << idx);
+    } else {
+        // step along the short way round so roll does not swing through 0 at +-180
+        filtered[idx] += WrapAngle(target - filtered[idx], half_turn) >> filter_shift;
+        filtered[idx] = WrapAngle(filtered[idx], half_turn);
+    }
+
+    return (int16_t)((filtered[idx] + (1 << (TILT_FILTER_FRAC - 1))) >> TILT_FILTER_FRAC);
+}
+
+void TiltEstimatorUpdate(const int16_t xyz[3], Tilt_t *out)
+{
+    int32_t x = (int32_t)xyz[0] - axis_offset[0];
+    int32_t y = (int32_t)xyz[1] - axis_offset[1];
+    int32_t z = (int32_t)xyz[2] - axis_offset[2];
+    uint32_t yz, xy, out_magnitude;
+    int32_t roll, pitch, tilt;
+
+    // four vectoring passes; each one yields an angle and the magnitude for the next
+    roll  = CordicVector(z, y, &yz);
+    pitch = CordicVector((int32_t)yz, -x, &out_magnitude);
+    CordicVector(x, y, &xy);
+    tilt  = CordicVector(z, (int32_t)xy, &xy);
+
+    out->roll  = FilterAngle(0, roll);
+    out->pitch = FilterAngle(1, pitch);
+    out->tilt  = FilterAngle(2, tilt);
+    out->magnitude = (uint16_t)out_magnitude;
+}
+
+void TiltEstimatorSetOffsets(const int16_t offsets[3])
+{
+    memcpy(axis_offset, offsets, sizeof(axis_offset));
+}
+
+void TiltEstimatorInit(uint8_t shift)
+{
+    filter_shift = shift;
+    filter_primed = 0;
+    memset(filtered, 0, sizeof(filtered));
+    memset(axis_offset, 0, sizeof(axis_offset));
+}
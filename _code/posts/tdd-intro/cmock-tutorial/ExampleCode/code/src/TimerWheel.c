@@ -0,0 +1,201 @@
+/**
+ ****************************************************************************************
+ *
+ * @file TimerWheel.c
+ *
+ * @brief Hierarchical timer wheel running periodic jobs off a single wakeup source
+ *
+ ****************************************************************************************
+ */
+#include <string.h>
+#include "TimerWheel.h"
+
+#define SLOT_MASK               (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level)      ((level) * TIMER_WHEEL_BITS)
+#define LEVEL_SPAN(level)       ((uint32_t)1 << LEVEL_SHIFT((level) + 1))
+#define MAX_AHEAD               (LEVEL_SPAN(TIMER_WHEEL_LEVELS - 1) - 1)
+
+static void Link(TimerJob_t **head, TimerJob_t *job)
+{
+    job->next = *head;
+    if (job->next) {
+        job->next->pprev = &job->next;
+    }
+    job->pprev = head;
+    *head = job;
+}
+
+static void Unlink(TimerJob_t *job)
+{
+    *job->pprev = job->next;
+    if (job->next) {
+        job->next->pprev = job->pprev;
+    }
+    job->next = NULL;
+    job->pprev = NULL;
+}
+
+/* File the job in the slot of the first wheel run at or after its due tick */
+static void File(TimerWheel_t *wheel, TimerJob_t *job)
+{
+    int32_t delta = (int32_t)(job->due - wheel->base);
+    uint32_t ahead = 0;
+    int level;
+
+    if (delta > 0) {
+        ahead = ((uint32_t)delta + wheel->resolution - 1) / wheel->resolution;
+    }
+    if (ahead > MAX_AHEAD) {
+        ahead = MAX_AHEAD;
+    }
+    job->expires = wheel->current + ahead;
+
+    for (level = 0; ahead >= LEVEL_SPAN(level); level++) {
+    }
+
+    Link(&wheel->slots[level][(job->expires >> LEVEL_SHIFT(level)) & SLOT_MASK], job);
+}
+
+/* Move the jobs of one upper slot down, now that it is close enough */
+static void Cascade(TimerWheel_t *wheel, int level)
+{
+    TimerJob_t **head = &wheel->slots[level][(wheel->current >> LEVEL_SHIFT(level)) & SLOT_MASK];
+
+    while (*head) {
+        TimerJob_t *job = *head;
+
+        Unlink(job);
+        File(wheel, job);
+    }
+}
+
+static uint32_t Align(uint32_t due, uint32_t align)
+{
+    if (align > 1) {
+        due = (due + align - 1) / align * align;
+    }
+
+    return due;
+}
+
+void TimerWheelInit(TimerWheel_t *wheel, uint32_t resolution, uint32_t now)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->resolution = resolution ? resolution : 1;
+    wheel->base = now;
+}
+
+void TimerJobInit(TimerJob_t *job, uint32_t period, uint32_t align, uint32_t slack,
+                  TimerJobCb_t cb)
+{
+    memset(job, 0, sizeof(*job));
+    job->period = period;
+    job->align = align;
+    job->slack = slack;
+    job->cb = cb;
+}
+
+void TimerWheelStart(TimerWheel_t *wheel, TimerJob_t *job, uint32_t now)
+{
+    TimerWheelStop(wheel, job);
+
+    job->due = Align(now + job->period, job->align);
+    File(wheel, job);
+}
+
+void TimerWheelStop(TimerWheel_t *wheel, TimerJob_t *job)
+{
+    if (job->pprev) {
+        Unlink(job);
+    }
+}
+
+bool TimerWheelRunning(const TimerJob_t *job)
+{
+    return job->pprev != NULL;
+}
+
+void TimerWheelSetPeriod(TimerWheel_t *wheel, TimerJob_t *job, uint32_t period, uint32_t now)
+{
+    job->period = period;
+
+    if (TimerWheelRunning(job)) {
+        TimerWheelStart(wheel, job, now);
+    }
+}
+
+uint16_t TimerWheelAdvance(TimerWheel_t *wheel, uint32_t now)
+{
+    uint16_t fired = 0;
+
+    while ((int32_t)(now - wheel->base) >= 0) {
+        TimerJob_t **head = &wheel->slots[0][wheel->current & SLOT_MASK];
+        int level;
+
+        /* Entering a new span of level 0 (or above): bring the next jobs down */
+        for (level = 1; level < TIMER_WHEEL_LEVELS &&
+                !(wheel->current & (LEVEL_SPAN(level - 1) - 1)); level++) {
+            Cascade(wheel, level);
+        }
+
+        while (*head) {
+            TimerJob_t *job = *head;
+            uint32_t next = job->due + job->period;
+
+            Unlink(job);
+
+            /* Missed periods are skipped rather than run back to back */
+            if ((int32_t)(next - now) <= 0) {
+                next = Align(now + job->period, job->align);
+            }
+            job->due = next;
+            File(wheel, job);
+
+            job->cb(job);
+            fired++;
+        }
+
+        wheel->current++;
+        wheel->base += wheel->resolution;
+    }
+
+    if (fired) {
+        wheel->wakeups++;
+        wheel->fired += fired;
+    }
+
+    return fired;
+}
+
+bool TimerWheelNextWakeup(const TimerWheel_t *wheel, uint32_t *when)
+{
+    bool found = false;
+    int32_t earliest = 0;
+    int level, slot;
+
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            const TimerJob_t *job;
+
+            for (job = wheel->slots[level][slot]; job; job = job->next) {
+                /* A job cannot run before its slot does, however little slack it has */
+                int32_t run = (int32_t)((job->expires - wheel->current) * wheel->resolution);
+                int32_t deadline = (int32_t)(job->due + job->slack - wheel->base);
+
+                if (deadline < run) {
+                    deadline = run;
+                }
+                if (!found || deadline < earliest) {
+                    earliest = deadline;
+                    found = true;
+                }
+            }
+        }
+    }
+
+    if (found) {
+        *when = wheel->base + (uint32_t)earliest;
+    }
+
+    return found;
+}
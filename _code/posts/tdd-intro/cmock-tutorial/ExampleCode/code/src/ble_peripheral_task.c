@@ -13,6 +13,7 @@
  */
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -21,6 +22,7 @@
 #include "ble_att.h"
 #include "ble_common.h"
 #include "ble_gap.h"
+#include "ble_gattc.h"
 #include "ble_gatts.h"
 #include "ble_service.h"
 #include "ble_uuid.h"
@@ -40,32 +42,142 @@
 #include <platform_devices.h>
 
 #include "common.h"
+#include "app_rtos.h"
 
 #include "sensors_service.h"
+#include "SensorFusion.h"
+#include "LazySampler.h"
+#include "history_transfer.h"
+#include "ConnParamManager.h"
+#include "AdvTelemetry.h"
+#include "PublishPolicy.h"
+#include "EventBatch.h"
+#include "TimerWheel.h"
+#include "SensorExecutor.h"
+#include "Allocator.h"
+#include "StackMonitor.h"
 
 /*
  * Notification bits reservation
  * bit #0 is always assigned to BLE event queue notification
  */
-#define TEMP_MEAS_TIMER_NOTIF       (1 << 2)
+#define TIMER_WHEEL_NOTIF           (1 << 2)
 #define TEMP_SENSOR_NOTIF           (1 << 3)
-#define ACC_MEAS_TIMER_NOTIF        (1 << 4)
 #define ACC_SENSOR_NOTIF            (1 << 5)
+#define ACC_MODE_NOTIF              (1 << 6)
+#define TEMP_ERROR_NOTIF            (1 << 7)
 
 /*
- * BLE peripheral advertising data
+ * Accelerometer polling periods. While idle the sensor runs at its lowest ODR and is only
+ * polled for latched wake-up events, so the CPU can stay asleep much longer.
  */
-static const uint8_t adv_data[] = {
+#define ACC_ACTIVE_MEAS_PERIOD_MS   (1 * 1000)
+#define ACC_IDLE_MEAS_PERIOD_MS     (10 * 1000)
+
+/*
+ * The activity model expects ACTIVITY_WINDOW_LEN samples at 25 Hz, a label every ~1.3 s.
+ * The FIFO collects them between polls, so a window fills well within ACC_IDLE_TIMEOUT_MS
+ * and one poll never brings more than the watermark.
+ */
+#define ACTIVITY_ODR                (0x0A)      // CTRL1_A ODR[3:0], low-power 25 Hz
+#define ACTIVITY_FIFO_WATERMARK     (ACC_FIFO_MAX_WATERMARK)
+
+/*
+ * Periodic jobs start on a whole second and may run a little late, so that jobs due close
+ * together share one wakeup
+ */
+#define JOB_ALIGN_MS                (1000)
+#define TEMP_MEAS_SLACK_MS          (200)
+#define ACC_MEAS_SLACK_MS           (100)
+#define CONN_PARAM_SLACK_MS         (500)
+#define STACK_SLACK_MS              (2000)
+
+/* Temperature is sampled on a timer unless reads trigger it and nothing is advertised */
+#define TEMP_MEAS_TIMER             (!CFG_TEMP_LAZY_SAMPLING || CFG_ADV_TELEMETRY)
+#define TEMP_MEAS_PERIOD_MS         (2 * 1000)
+
+/*
+ * Common timeline for the combined sensor frames. A frame waits at most FUSION_MAX_LAG_MS
+ * for the slowest stream (temperature, every 2 s) before it is emitted with held values.
+ */
+#define FUSION_FRAME_PERIOD_MS      (1 * 1000)
+#define FUSION_MAX_LAG_MS           (3 * 1000)
+
+/* LL transmit time for CFG_LL_DATA_LENGTH octets on the 1M PHY: preamble, AA, header, MIC, CRC */
+#define LL_DATA_TIME(octets)        ( ((octets) + 14) * 8 )
+
+/*
+ * Connection parameters asked for by ConnParamManager. The supervision timeout covers two
+ * latency-stretched intervals. The connection event length is up to the central, the
+ * throughput profile relies on the data length extension to fill each event.
+ */
+static const gap_conn_params_t conn_profiles[CONN_PROFILE_COUNT] = {
+        [CONN_PROFILE_LOW_POWER] = {
+                .interval_min  = BLE_CONN_INTERVAL_FROM_MS(400),
+                .interval_max  = BLE_CONN_INTERVAL_FROM_MS(500),
+                .slave_latency = 4,
+                .sup_timeout   = BLE_SUPERVISION_TMO_FROM_MS(6000),
+        },
+        [CONN_PROFILE_THROUGHPUT] = {
+                .interval_min  = BLE_CONN_INTERVAL_FROM_MS(7.5),
+                .interval_max  = BLE_CONN_INTERVAL_FROM_MS(15),
+                .slave_latency = 0,
+                .sup_timeout   = BLE_SUPERVISION_TMO_FROM_MS(2000),
+        },
+};
+
+static const ConnParamConfig_t conn_param_config = {
+        .busy_bytes              = CFG_CONN_BUSY_BYTES,
+        .idle_ms                 = CFG_CONN_IDLE_MS,
+        .throughput_interval_max = BLE_CONN_INTERVAL_FROM_MS(15),
+};
+
+/*
+ * The stack puts its own 3-byte flags structure in front of the advertising data, which
+ * leaves 28 of the 31 bytes
+ */
+#define ADV_DATA_MAX_LEN            (28)
+
+#define ADV_CONN_MODE               (CFG_ADV_CONNECTABLE ? GAP_CONN_MODE_UNDIRECTED : \
+                                                           GAP_CONN_MODE_NON_CONN)
+
+static const uint8_t adv_name[] = {
         0x0E, GAP_DATA_TYPE_LOCAL_NAME,
         'D', 'i', 'a', 'l', 'o', 'g', ' ', 'C','u','s','t','o','m'
 };
 
+#if CFG_ADV_TELEMETRY
+/*
+ * BLE peripheral advertising data is the telemetry structure, rewritten in place with
+ * every sample. The name does not fit next to it and goes into the scan response.
+ */
+__RETAINED_RW static uint8_t adv_data[ADV_TELEMETRY_LEN];
+
+#define ADV_TELEMETRY               (adv_data)
+
+_Static_assert(sizeof(adv_data) <= ADV_DATA_MAX_LEN, "advertising data does not fit");
+#else
+/* Without telemetry the name is the advertising data */
+_Static_assert(sizeof(adv_name) <= ADV_DATA_MAX_LEN, "advertising data does not fit");
+#endif
+
 /* Task used by application */
 static OS_TASK ble_peripheral_task_handle;
 
-/* Timer used to read periodical measurements */
-PRIVILEGED_DATA static OS_TIMER temp_meas_timer;
-PRIVILEGED_DATA static OS_TIMER acc_meas_timer;
+/*
+ * Periodic work runs off one timer wheel owned by this task, woken up by a single one-shot
+ * OS timer programmed for the next deadline
+ */
+PRIVILEGED_DATA static OS_TIMER wheel_timer;
+PRIVILEGED_DATA static TimerWheel_t wheel;
+#if TEMP_MEAS_TIMER
+PRIVILEGED_DATA static TimerJob_t temp_meas_job;
+#endif
+PRIVILEGED_DATA static TimerJob_t acc_meas_job;
+PRIVILEGED_DATA static TimerJob_t conn_param_job;
+#if CFG_STACK_MONITOR
+PRIVILEGED_DATA static TimerJob_t stack_job;
+#endif
 
 static void notif_timer_cb(OS_TIMER timer)
 {
@@ -74,6 +186,34 @@ static void notif_timer_cb(OS_TIMER timer)
         OS_TASK_NOTIFY(ble_peripheral_task_handle, notif, OS_NOTIFY_SET_BITS);
 }
 
+/* Program the wakeup for the latest moment that still suits every job */
+static void rearm_wheel(void)
+{
+        uint32_t when;
+        int32_t delay;
+
+        if (!TimerWheelNextWakeup(&wheel, &when)) {
+                OS_TIMER_STOP(wheel_timer, OS_TIMER_FOREVER);
+                return;
+        }
+
+        delay = (int32_t)(when - OS_GET_TICK_COUNT());
+        OS_TIMER_CHANGE_PERIOD(wheel_timer, delay > 0 ? delay : 1, OS_TIMER_FOREVER);
+}
+
+
+/* Hand the current advertising data to the stack, it is used from the next event on */
+static void update_adv_data(void)
+{
+        ble_error_t err;
+
+#if CFG_ADV_TELEMETRY
+        err = ble_gap_adv_data_set(sizeof(adv_data), adv_data, sizeof(adv_name), adv_name);
+#else
+        err = ble_gap_adv_data_set(sizeof(adv_name), adv_name, 0, NULL);
+#endif
+        OS_ASSERT(err == BLE_STATUS_OK);
+}
 
 static void set_alerting(bool new_alerting)
 {
@@ -135,39 +275,372 @@ static void do_alert(uint8_t level)
 /*
  * Main code
  */
+/* Handle of custom BLE service */
+__RETAINED_RW ble_service_t *ss = NULL;
+
+/* Samples waiting to be sent, packed into MTU-sized notifications */
+PRIVILEGED_DATA static SampleBatch_t temp_batch;
+#if CFG_RAW_ACCELERATION
+PRIVILEGED_DATA static SampleBatch_t acc_batch;
+#endif
+
+/* Characteristic whose configuration drives the accelerometer */
+#if CFG_RAW_ACCELERATION
+#define ACC_CONFIG_CHAR             SENSORS_CHAR_ACCELERATION
+#else
+#define ACC_CONFIG_CHAR             SENSORS_CHAR_ACTIVITY
+#endif
+
+/*
+ * Sampling and publish configuration at boot, centrals change it at run time through the
+ * configuration characteristic. Publish policies are applied before a value is notified,
+ * written to the attribute database or advertised. Temperature comes in whole degrees,
+ * acceleration in raw LSB (16384 is 1 g) and tilt in centidegrees. The history log keeps
+ * every sample regardless.
+ */
+static const sensors_config_t default_config[SENSORS_CHAR_COUNT] = {
+#if TEMP_MEAS_TIMER
+        [SENSORS_CHAR_TEMPERATURE]  = { .period_ms = TEMP_MEAS_PERIOD_MS, .max_interval_ms = 60 * 1000 },
+#else
+        [SENSORS_CHAR_TEMPERATURE]  = { .max_interval_ms = 60 * 1000 },
+#endif
+#if CFG_RAW_ACCELERATION
+        [SENSORS_CHAR_ACCELERATION] = { .period_ms = ACC_ACTIVE_MEAS_PERIOD_MS,
+                                        .odr = ACC_ACTIVE_CTRL1 >> 4,
+                                        .deadband = 320, .max_interval_ms = 10 * 1000 },
+        [SENSORS_CHAR_ACTIVITY]     = { .max_interval_ms = 60 * 1000 },
+#else
+        [SENSORS_CHAR_ACTIVITY]     = { .period_ms = ACC_ACTIVE_MEAS_PERIOD_MS,
+                                        .odr = ACTIVITY_ODR,
+                                        .fifo_watermark = ACTIVITY_FIFO_WATERMARK,
+                                        .max_interval_ms = 60 * 1000 },
+#endif
+        [SENSORS_CHAR_TILT]         = { .deadband = 50, .max_interval_ms = 10 * 1000 },
+};
+
+PRIVILEGED_DATA static PublishPolicy_t policies[SENSORS_CHAR_COUNT];
+
+/* Accelerometer polling period while active, the idle one stays fixed */
+PRIVILEGED_DATA static uint32_t acc_active_period_ms;
+
+/* One FIFO drain taken from the driver, too big for the task stack */
+PRIVILEGED_DATA static SensorSample_t acc_samples[ACC_FIFO_MAX_WATERMARK];
+
+/* Last activity label sent, it only moves once per classifier window */
+PRIVILEGED_DATA static uint8_t notified_activity;
+
+/* Latest published value of every sensor, read in one go by gateways */
+PRIVILEGED_DATA static uint8_t snapshot[SENSOR_SNAPSHOT_LEN];
+
+/* BLE events handled per wakeup */
+PRIVILEGED_DATA static EventBatch_t ble_batch;
+
+#if CFG_APP_ALLOCATOR
+/* Application buffers, zeroed at startup so everything goes to OS_MALLOC until set up */
+static const EventPoolClassConfig_t app_pool_classes[] = CFG_APP_POOL_CLASSES;
+PRIVILEGED_DATA static struct {
+        uint32_t pool[CFG_APP_POOL_SIZE / sizeof(uint32_t)];
+#if CFG_POISON_CHECK
+        uint32_t pool_guard[CFG_POISON_GUARD_WORDS];    /* red zones, catch overruns */
+#endif
+        uint32_t heap[CFG_APP_HEAP_SIZE / sizeof(uint32_t)];
+#if CFG_POISON_CHECK
+        uint32_t heap_guard[CFG_POISON_GUARD_WORDS];
+#endif
+} app_memory;
+PRIVILEGED_DATA static Allocator_t app_alloc;
+#endif
+#if CFG_BLE_EVT_POOL
+INITIALISED_PRIVILEGED_DATA static AllocSite_t ble_evt_site = ALLOC_SITE_INIT("ble events");
+#endif
+
+#if CFG_STACK_MONITOR
+/* Stack high-water marks of the application tasks, and their debug characteristic value */
+PRIVILEGED_DATA static StackMonitor_t stack_monitor;
+PRIVILEGED_DATA static uint8_t stack_pdu[STACK_MONITOR_PDU_LEN];
+#endif
+
+#if CFG_TEMP_LAZY_SAMPLING
+/* Temperature is only measured when a read finds the cached value stale */
+PRIVILEGED_DATA static LazySampler_t temp_sampler;
+#endif
+
 static void handle_evt_gap_connected(ble_evt_gap_connected_t *evt)
 {
         /**
          * Manage connection information
          */
+
+        /* Ask for bigger ATT and LL payloads, sample batches are sized after the outcome */
+        ble_gattc_exchange_mtu(evt->conn_idx);
+        ble_gap_data_length_set(evt->conn_idx, CFG_LL_DATA_LENGTH, LL_DATA_TIME(CFG_LL_DATA_LENGTH));
+
+#if dg_configBLE_L2CAP_COC
+        history_listen(evt->conn_idx);
+#endif
+
+        ConnParamOpen(evt->conn_idx, OS_TICKS_2_MS(OS_GET_TICK_COUNT()),
+                        evt->conn_params.interval_min, evt->conn_params.slave_latency);
+        if (!TimerWheelRunning(&conn_param_job)) {
+                TimerWheelStart(&wheel, &conn_param_job, OS_GET_TICK_COUNT());
+                rearm_wheel();
+        }
+
+        /* Keep advertising so further centrals can subscribe as well */
+        if (ConnTableCount() < CONN_MAX) {
+                ble_gap_adv_start(ADV_CONN_MODE);
+        }
+}
+
+#if defined CONFIG_RETARGET
+static void report_conn_profiles(void)
+{
+        static const char *const names[CONN_PROFILE_COUNT] = { "low power", "throughput" };
+        ConnProfileStats_t stats;
+        int profile;
+
+        for (profile = 0; profile < CONN_PROFILE_COUNT; profile++) {
+                ConnParamGetStats(profile, &stats);
+                printf("%s: %lu ms, %lu B/s, ~%lu uA\r\n", names[profile], stats.time_ms,
+                                ConnParamThroughput(&stats),
+                                ConnParamAverageCurrent(&stats, CFG_CONN_EVENT_CHARGE_NC,
+                                                                CFG_SLEEP_CURRENT_UA));
+        }
+}
+#endif
+
+#if defined CONFIG_RETARGET
+static void report_event_batches(void)
+{
+        const EventBatchStats_t *stats = &ble_batch.stats;
+
+        printf("ble events: %lu in %lu wakeups, largest batch %u, %lu cut short\r\n",
+                        stats->events, stats->wakeups, stats->largest, stats->cut_short);
+        printf("batch sizes 0/1/2-3/4-7/8-15/16+: %lu/%lu/%lu/%lu/%lu/%lu\r\n",
+                        stats->histogram[0], stats->histogram[1], stats->histogram[2],
+                        stats->histogram[3], stats->histogram[4], stats->histogram[5]);
+}
+#endif
+
+#if defined CONFIG_RETARGET && CFG_APP_ALLOCATOR
+static void report_allocator(void)
+{
+        const EventPool_t *pool = &app_alloc.pool;
+        const AllocSite_t *site;
+        size_t free, largest;
+        int c;
+
+        for (c = 0; c < pool->classes; c++) {
+                const EventPoolClass_t *cls = &pool->cls[c];
+
+                printf("pool %u B: peak %u/%u, %lu allocs, %lu spilled, %lu exhausted\r\n",
+                                cls->size, cls->stats.peak, cls->count, cls->stats.allocs,
+                                cls->stats.spills, cls->stats.exhausted);
+        }
+
+        for (site = app_alloc.sites; site; site = site->next) {
+                printf("%s: %lu B live, peak %lu B, %lu allocs, %lu failed\r\n", site->name,
+                                site->live, site->peak, site->allocs, site->failed);
+        }
+
+        AllocatorHeapInfo(&app_alloc, &free, &largest);
+        printf("app heap: %u B free, largest %u B, %lu allocs from heap, %lu failed\r\n",
+                        free, largest, app_alloc.stats.from_heap, app_alloc.stats.failed);
+
+        /* The FreeRTOS heap, to size configTOTAL_HEAP_SIZE from */
+        printf("os heap: %u B free, never below %u B\r\n", xPortGetFreeHeapSize(),
+                        xPortGetMinimumEverFreeHeapSize());
+}
+#endif
+
+#if defined CONFIG_RETARGET && CFG_STACK_MONITOR
+static void report_stacks(void)
+{
+        int i;
+
+        for (i = 0; i < stack_monitor.count; i++) {
+                const StackMonitorEntry_t *entry = &stack_monitor.tasks[i];
+
+                if (!entry->measured) {
+                        printf("%s stack: %u B, not measured yet\r\n", entry->name, entry->size);
+                        continue;
+                }
+                printf("%s stack: %u B, peak %u B, suggested %u B\r\n", entry->name, entry->size,
+                                StackMonitorUsed(entry),
+                                StackMonitorSuggest(entry, CFG_STACK_MARGIN_PERCENT));
+        }
 }
+#endif
 
 static void handle_evt_gap_disconnected(ble_evt_gap_disconnected_t *evt)
 {
+        ConnParamClose(evt->conn_idx, OS_TICKS_2_MS(OS_GET_TICK_COUNT()));
+        if (ConnTableCount() == 0) {
+                TimerWheelStop(&wheel, &conn_param_job);
+                rearm_wheel();
+        }
+
+#if defined CONFIG_RETARGET
+        SampleBatchStats_t stats;
+
+        report_conn_profiles();
+
+        sensors_get_batch_stats(ss, SENSORS_CHAR_TEMPERATURE, &stats);
+        printf("temperature: %lu samples in %lu PDUs, efficiency %u/1000\r\n",
+                        stats.samples, stats.pdus, SampleBatchEfficiency(&stats));
+#if CFG_RAW_ACCELERATION
+        sensors_get_batch_stats(ss, SENSORS_CHAR_ACCELERATION, &stats);
+        printf("acceleration: %lu samples in %lu PDUs, efficiency %u/1000\r\n",
+                        stats.samples, stats.pdus, SampleBatchEfficiency(&stats));
+#endif
+
+        report_event_batches();
+#if CFG_APP_ALLOCATOR
+        report_allocator();
+#endif
+        printf("timer wheel: %lu jobs in %lu wakeups\r\n", wheel.fired, wheel.wakeups);
+#if CFG_STACK_MONITOR
+        report_stacks();
+#endif
+#endif
+
+#if CFG_TEMP_LAZY_SAMPLING
+        LazySamplerDrop(&temp_sampler, evt->conn_idx);
+#endif
+
+        /* A record was freed, advertising stopped when the table was full */
+        if (ConnTableCount() == CONN_MAX - 1) {
+                ble_gap_adv_start(ADV_CONN_MODE);
+        }
+}
+
+static void handle_evt_gap_conn_param_updated(ble_evt_gap_conn_param_updated_t *evt)
+{
+        ConnParamApplied(evt->conn_idx, OS_TICKS_2_MS(OS_GET_TICK_COUNT()),
+                        evt->conn_params.interval_min, evt->conn_params.slave_latency);
+}
+
+/* Move every link to the profile its recent traffic calls for */
+static void poll_conn_params(void)
+{
+        uint32_t now = OS_TICKS_2_MS(OS_GET_TICK_COUNT());
+        uint8_t slot;
+
+        for (slot = 0; slot < CONN_MAX; slot++) {
+                ConnRecord_t *rec = ConnTableAt(slot);
+                ConnProfile_t profile;
+                uint32_t bytes;
+                bool bulk = false;
+
+                if (!rec) {
+                        continue;
+                }
+
+                bytes = ConnTakeBytes(rec);
+#if dg_configBLE_L2CAP_COC
+                uint32_t history_bytes;
+
+                bulk = history_take_activity(rec->conn_idx, &history_bytes);
+                bytes += history_bytes;
+#endif
+                if (ConnParamPoll(rec->conn_idx, now, bytes, bulk, &profile)) {
+                        ble_gap_conn_param_update(rec->conn_idx, &conn_profiles[profile]);
+                }
+        }
+}
+
+static void handle_evt_gattc_mtu_changed(ble_evt_gattc_mtu_changed_t *evt)
+{
+        sensors_set_mtu(ss, evt->conn_idx, evt->mtu);
+}
+
+static void handle_evt_gap_data_length_changed(ble_evt_gap_data_length_changed_t *evt)
+{
+        sensors_set_data_length(ss, evt->conn_idx, evt->max_tx_length);
 }
 
 static void handle_evt_gap_adv_completed(ble_evt_gap_adv_completed_t *evt)
 {
-        // restart advertising so we can connect again
-        ble_gap_adv_start(GAP_CONN_MODE_UNDIRECTED);
+        // restart advertising so we can connect again, while records are left
+        if (ConnTableCount() < CONN_MAX) {
+                ble_gap_adv_start(ADV_CONN_MODE);
+        }
+}
+
+#if TEMP_MEAS_TIMER
+static void temp_meas_job_cb(TimerJob_t *job)
+{
+        DoMeasurementTemperature();
+}
+#endif
+
+static void acc_meas_job_cb(TimerJob_t *job)
+{
+        i2c_acc_do_measurement();
+}
+
+static void conn_param_job_cb(TimerJob_t *job)
+{
+        poll_conn_params();
+}
+
+#if CFG_STACK_MONITOR
+/* Untouched bytes at the end of the painted stack, a scan of just that part */
+static uint32_t stack_unused(void *task)
+{
+        return uxTaskGetStackHighWaterMark((OS_TASK) task) * sizeof(StackType_t);
 }
 
+static void stack_job_cb(TimerJob_t *job)
+{
+        StackMonitorStep(&stack_monitor);
+        StackMonitorPack(&stack_monitor, stack_pdu);
+        sensors_set_stack_usage(ss, stack_pdu);
+}
+
+static void setup_stack_monitor(void)
+{
+        StackMonitorInit(&stack_monitor, stack_unused);
+        StackMonitorAdd(&stack_monitor, "ble peripheral", ble_peripheral_task_handle,
+                                                        BLE_PERIPHERAL_TASK_STACK_SIZE);
+        StackMonitorAdd(&stack_monitor, "sensors", SensorExecutorGetTask(),
+                                                        SENSOR_EXECUTOR_STACK_SIZE);
+
+        TimerJobInit(&stack_job, OS_MS_2_TICKS(CFG_STACK_MONITOR_PERIOD_MS),
+                        OS_MS_2_TICKS(JOB_ALIGN_MS), OS_MS_2_TICKS(STACK_SLACK_MS), stack_job_cb);
+        TimerWheelStart(&wheel, &stack_job, OS_GET_TICK_COUNT());
+        rearm_wheel();
+}
+#endif
+
 static void setup_timers(void)
 {
-        /* Create timer for Temperature Sensor (TS) to send periodic measurements 2 seg*/
-        temp_meas_timer = OS_TIMER_CREATE("temp_meas", 2*1000, OS_TIMER_SUCCESS,
-                                                        OS_UINT_TO_PTR(TEMP_MEAS_TIMER_NOTIF),
+        OS_TICK_TIME now = OS_GET_TICK_COUNT();
+
+        wheel_timer = APP_TIMER_CREATE("wheel", 1, OS_TIMER_ONCE, OS_UINT_TO_PTR(TIMER_WHEEL_NOTIF),
                                                                                 notif_timer_cb);
+        OS_ASSERT(wheel_timer);
+        TimerWheelInit(&wheel, OS_MS_2_TICKS(CFG_TIMER_WHEEL_RESOLUTION_MS), now);
 
-        OS_ASSERT(temp_meas_timer);
-        OS_TIMER_START(temp_meas_timer, OS_TIMER_FOREVER);
+#if TEMP_MEAS_TIMER
+        /* Temperature Sensor (TS) periodic measurements */
+        TimerJobInit(&temp_meas_job, OS_MS_2_TICKS(default_config[SENSORS_CHAR_TEMPERATURE].period_ms),
+                        OS_MS_2_TICKS(JOB_ALIGN_MS), OS_MS_2_TICKS(TEMP_MEAS_SLACK_MS),
+                                                                        temp_meas_job_cb);
+        TimerWheelStart(&wheel, &temp_meas_job, now);
+#endif
 
-        /* Create timer for accelerometer (CS) to send periodic measurements 1 seg*/
-        acc_meas_timer = OS_TIMER_CREATE("acc_meas", 1*1000, OS_TIMER_SUCCESS,
-                                                        OS_UINT_TO_PTR(ACC_MEAS_TIMER_NOTIF),
-                                                                                notif_timer_cb);
-        OS_ASSERT(acc_meas_timer);
-        OS_TIMER_START(acc_meas_timer, OS_TIMER_FOREVER);
+        /* Accelerometer (CS) periodic measurements */
+        TimerJobInit(&acc_meas_job, OS_MS_2_TICKS(acc_active_period_ms), OS_MS_2_TICKS(JOB_ALIGN_MS),
+                                        OS_MS_2_TICKS(ACC_MEAS_SLACK_MS), acc_meas_job_cb);
+        TimerWheelStart(&wheel, &acc_meas_job, now);
+
+        /* Connection parameter polling, runs while a central is connected */
+        TimerJobInit(&conn_param_job, OS_MS_2_TICKS(CFG_CONN_PARAM_POLL_MS),
+                        OS_MS_2_TICKS(JOB_ALIGN_MS), OS_MS_2_TICKS(CONN_PARAM_SLACK_MS),
+                                                                        conn_param_job_cb);
+
+        rearm_wheel();
 }
 
 /* LED D2 status flag */
@@ -175,33 +648,416 @@ __RETAINED_RW volatile bool pin_status_flag = 0;
 
 /* Characteristic value */
 __RETAINED_RW int16_t CurrentTemperatureValue = 0;
-__RETAINED_RW uint16_t acc_int_val = 0;
+__RETAINED_RW uint16_t CurrentAccelerometerValue = 0;
+__RETAINED_RW uint8_t CurrentActivityLabel = 0xFF;
 
-/* Handle of custom BLE service */
-__RETAINED_RW ble_service_t *ss = NULL;
+/* Orientation derived from the latest accelerometer sample */
+__RETAINED_RW Tilt_t CurrentTilt;
+
+
+/* Send once a payload is full, or when the oldest sample has waited long enough */
+static bool batch_due(sensors_char_t ch, const SampleBatch_t *batch, SensorTime_t now)
+{
+        if (batch->count == 0) {
+                return false;
+        }
+
+        if (batch->count >= SampleBatchCapacity(batch, sensors_get_payload_len(ss, ch))) {
+                return true;
+        }
+
+        return SENSOR_TIME_AFTER_EQ(now, batch->samples[batch->head].timestamp +
+                                                OS_MS_2_TICKS(CFG_BATCH_MAX_LATENCY_MS));
+}
+
+/*
+ * Handler for read requests. Characteristics kept in the attribute database are answered by
+ * the BLE manager, these only run for the ones registered with forwarded reads.
+ */
+static void temp_get_int_val_cb(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch)
+{
+#if CFG_TEMP_LAZY_SAMPLING
+        bool start_measurement;
+
+        switch (LazySamplerRead(&temp_sampler, conn_idx, OS_GET_TICK_COUNT(), &start_measurement)) {
+        case LAZY_READ_DEFERRED:
+                /* Answered from the TEMP_SENSOR_NOTIF or TEMP_ERROR_NOTIF handler */
+                if (start_measurement) {
+                        DoMeasurementTemperature();
+                }
+                return;
+        case LAZY_READ_REJECTED:
+                sensors_get_value_cfm(svc, conn_idx, ch, ATT_ERROR_INSUFFICIENT_RESOURCES, 0, NULL);
+                return;
+        default:
+                break;
+        }
+#endif
+
+        /* Send the requested data to the peer device.  */
+        sensors_get_batch_cfm(svc, conn_idx, ch, &temp_batch);
+}
+
+#if CFG_RAW_ACCELERATION
+static void acc_get_int_val_cb(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch)
+{
+        /* Send the requested data to the peer device.  */
+        sensors_get_batch_cfm(svc, conn_idx, ch, &acc_batch);
+}
+#endif
 
-/* Handler for read requests */
-static void temp_get_int_val_cb(ble_service_t *svc, uint16_t conn_idx)
+static void tilt_get_val_cb(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch)
 {
-        uint16_t var_value = CurrentTemperatureValue;
+        uint8_t var_value[SENSORS_TILT_VALUE_LEN];
+
+        sensors_pack_tilt(var_value, &CurrentTilt);
 
         /* Send the requested data to the peer device.  */
-        temp_get_int_value_cfm(svc, conn_idx, ATT_ERROR_OK, &var_value);
+        sensors_get_value_cfm(svc, conn_idx, ch, ATT_ERROR_OK, sizeof(var_value), var_value);
 }
 
-static void acc_get_int_val_cb(ble_service_t *svc, uint16_t conn_idx)
+static void activity_get_val_cb(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch)
 {
-        uint16_t var_value = acc_int_val;
+        uint8_t var_value = CurrentActivityLabel;
 
         /* Send the requested data to the peer device.  */
-        acc_get_int_value_cfm(svc, conn_idx, ATT_ERROR_OK, &var_value);
+        sensors_get_value_cfm(svc, conn_idx, ch, ATT_ERROR_OK, sizeof(var_value), &var_value);
+}
+
+
+/* Runs on the sensor executor task, hand the timer reprogramming over to this task */
+static void acc_mode_changed_cb(AccelerometerMode_t mode)
+{
+        OS_TASK_NOTIFY(ble_peripheral_task_handle, ACC_MODE_NOTIF, OS_NOTIFY_SET_BITS);
+}
+
+static void handle_acc_mode_changed(void)
+{
+        uint32_t period = (i2c_acc_get_mode() == ACC_MODE_IDLE) ? ACC_IDLE_MEAS_PERIOD_MS :
+                                                                  acc_active_period_ms;
+
+        TimerWheelSetPeriod(&wheel, &acc_meas_job, OS_MS_2_TICKS(period), OS_GET_TICK_COUNT());
+        rearm_wheel();
+}
+
+static void policy_from_config(PublishPolicyConfig_t *policy, const sensors_config_t *config)
+{
+        policy->deadband = config->deadband;
+        policy->relative_permille = config->relative_permille;
+        policy->min_interval = OS_MS_2_TICKS(config->min_interval_ms);
+        policy->max_interval = OS_MS_2_TICKS(config->max_interval_ms);
+}
+
+/*
+ * Handler for configuration writes. Timers and sensor registers are reprogrammed right
+ * away, a sensor only accepts the fields it has.
+ */
+static att_error_t set_config_cb(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch,
+                                                                const sensors_config_t *config)
+{
+        PublishPolicyConfig_t policy;
+
+        /* A label has no magnitude, only the interval limits of its policy apply */
+        if (ch == SENSORS_CHAR_ACTIVITY && (config->deadband || config->relative_permille)) {
+                return ATT_ERROR_APPLICATION_ERROR;
+        }
+
+        switch (ch) {
+        case SENSORS_CHAR_TEMPERATURE:
+                if (config->odr || config->fifo_watermark) {
+                        return ATT_ERROR_APPLICATION_ERROR;
+                }
+#if TEMP_MEAS_TIMER
+                if (!config->period_ms) {
+                        return ATT_ERROR_APPLICATION_ERROR;
+                }
+                TimerWheelSetPeriod(&wheel, &temp_meas_job, OS_MS_2_TICKS(config->period_ms),
+                                                                        OS_GET_TICK_COUNT());
+                rearm_wheel();
+#else
+                if (config->period_ms) {
+                        return ATT_ERROR_APPLICATION_ERROR;
+                }
+#endif
+                break;
+        case ACC_CONFIG_CHAR:
+        {
+                AccelerometerConfig_t acc_config = { config->odr, config->fifo_watermark,
+                                                     config->period_ms };
+
+                if (!config->period_ms || !i2c_acc_configure(&acc_config)) {
+                        return ATT_ERROR_APPLICATION_ERROR;
+                }
+                acc_active_period_ms = config->period_ms;
+                handle_acc_mode_changed();
+                break;
+        }
+        default:
+                /* Derived or demo characteristics, only their publish policy is tunable */
+                if (config->period_ms || config->odr || config->fifo_watermark) {
+                        return ATT_ERROR_APPLICATION_ERROR;
+                }
+                break;
+        }
+
+        policy_from_config(&policy, config);
+        PublishPolicyConfigure(&policies[ch], &policy);
+
+        return ATT_ERROR_OK;
+}
+
+static bool set_acc_default_config(void)
+{
+        const sensors_config_t *config = &default_config[ACC_CONFIG_CHAR];
+        AccelerometerConfig_t acc_config = { config->odr, config->fifo_watermark,
+                                             config->period_ms };
+
+        return i2c_acc_configure(&acc_config);
+}
+
+/* Runs on the sensor executor task, fusion itself only ever runs on this task */
+static void temp_sample_cb(void)
+{
+        OS_TASK_NOTIFY(ble_peripheral_task_handle, TEMP_SENSOR_NOTIF, OS_NOTIFY_SET_BITS);
+}
+
+#if CFG_TEMP_LAZY_SAMPLING
+static void temp_fail_cb(void)
+{
+        OS_TASK_NOTIFY(ble_peripheral_task_handle, TEMP_ERROR_NOTIF, OS_NOTIFY_SET_BITS);
+}
+#endif
+
+static void acc_sample_cb(void)
+{
+        OS_TASK_NOTIFY(ble_peripheral_task_handle, ACC_SENSOR_NOTIF, OS_NOTIFY_SET_BITS);
+}
+
+/* Fusion runs on this task, the newest time-aligned frame is read with the snapshot */
+static void sensor_frame_cb(const SensorFrame_t *frame)
+{
+        SensorSnapshotSetFrame(snapshot, frame);
+        sensors_set_snapshot(ss, snapshot);
+}
+
+static void handle_ble_event(ble_evt_hdr_t *hdr)
+{
+        if (ble_service_handle_event(hdr)) {
+                return;
+        }
+
+#if dg_configBLE_L2CAP_COC
+        if (history_handle_event(hdr)) {
+                return;
+        }
+#endif
+
+        switch (hdr->evt_code) {
+        case BLE_EVT_GAP_CONNECTED:
+                //do_alert(1);
+                handle_evt_gap_connected((ble_evt_gap_connected_t *) hdr);
+                break;
+        case BLE_EVT_GAP_ADV_COMPLETED:
+                handle_evt_gap_adv_completed((ble_evt_gap_adv_completed_t *) hdr);
+                break;
+        case BLE_EVT_GAP_DISCONNECTED:
+                //do_alert(0);
+                handle_evt_gap_disconnected((ble_evt_gap_disconnected_t *) hdr);
+                break;
+        case BLE_EVT_GAP_CONN_PARAM_UPDATED:
+                handle_evt_gap_conn_param_updated((ble_evt_gap_conn_param_updated_t *) hdr);
+                break;
+        case BLE_EVT_GATTC_MTU_CHANGED:
+                handle_evt_gattc_mtu_changed((ble_evt_gattc_mtu_changed_t *) hdr);
+                break;
+        case BLE_EVT_GAP_DATA_LENGTH_CHANGED:
+                handle_evt_gap_data_length_changed((ble_evt_gap_data_length_changed_t *) hdr);
+                break;
+        case BLE_EVT_GAP_PAIR_REQ:
+        {
+                ble_evt_gap_pair_req_t *evt = (ble_evt_gap_pair_req_t *) hdr;
+                ble_gap_pair_reply(evt->conn_idx, true, evt->bond);
+                break;
+        }
+        default:
+                ble_handle_event_default(hdr);
+                break;
+        }
 }
 
+/*
+ * Buffers are taken and given back on several tasks, the allocator is only touched with
+ * interrupts masked. A pool block is a free list pop or push, OS_MALLOC is the last resort.
+ */
+void *app_malloc(size_t size, AllocSite_t *site)
+{
+#if CFG_APP_ALLOCATOR
+        void *buf;
+
+        OS_ENTER_CRITICAL_SECTION();
+        buf = AllocatorAlloc(&app_alloc, size, site);
+        OS_LEAVE_CRITICAL_SECTION();
+
+        if (buf) {
+                return buf;
+        }
+#endif
+        return OS_MALLOC(size);
+}
+
+void app_free(void *buf)
+{
+#if CFG_APP_ALLOCATOR
+        bool pooled;
+
+        OS_ENTER_CRITICAL_SECTION();
+        pooled = AllocatorFree(&app_alloc, buf);
+        OS_LEAVE_CRITICAL_SECTION();
+
+        if (pooled) {
+                return;
+        }
+#endif
+        OS_FREE(buf);
+}
+
+#if CFG_BLE_EVT_POOL
+void *ble_event_alloc(size_t size)
+{
+        return app_malloc(size, &ble_evt_site);
+}
+
+void ble_event_free(void *buf)
+{
+        app_free(buf);
+}
+#endif
+
+/*
+ * Handle queued BLE events until the queue is empty or the batch limits are reached.
+ * Connection setup delivers bursts of events, taking them in one wakeup saves a watchdog
+ * suspend/resume and a scheduler round trip for each of them.
+ */
+static void drain_ble_events(int8_t wdog_id)
+{
+        bool pending;
+
+        EventBatchBegin(&ble_batch, OS_GET_TICK_COUNT());
+        while (EventBatchNext(&ble_batch, OS_GET_TICK_COUNT())) {
+                ble_evt_hdr_t *hdr;
+
+                hdr = ble_get_event(false);
+                if (!hdr) {
+                        break;
+                }
+
+                handle_ble_event(hdr);
+#if CFG_BLE_EVT_POOL
+                ble_event_free(hdr);
+#else
+                OS_FREE(hdr);
+#endif
+
+                EventBatchHandled(&ble_batch);
+                sys_watchdog_notify(wdog_id);
+        }
+
+        // notify again if there are more events to process in queue
+        pending = ble_has_event();
+        EventBatchEnd(&ble_batch, pending);
+        if (pending) {
+                OS_TASK_NOTIFY(OS_GET_CURRENT_TASK(), BLE_APP_NOTIFY_MASK, eSetBits);
+        }
+}
+
+/* Fuse, log and publish one accelerometer sample. Returns true if anything was published */
+static bool handle_acc_sample(const SensorSample_t *sample)
+{
+        SensorSample_t tilt_sample;
+        bool published = false;
+
+        SensorFusionPush(SENSOR_STREAM_ACCELERATION, sample);
+        TiltEstimatorUpdate(sample->value, &CurrentTilt);
+
+#if CFG_RAW_ACCELERATION
+#if dg_configBLE_L2CAP_COC
+        history_log_sample(SENSORS_CHAR_ACCELERATION, 3, sample);
+#endif
+
+        if (PublishPolicyCheck(&policies[SENSORS_CHAR_ACCELERATION], sample)) {
+                SampleBatchPush(&acc_batch, sample);
+#if CFG_SENSORS_READ_FROM_DB
+                sensors_set_batch(ss, SENSORS_CHAR_ACCELERATION, &acc_batch);
+#endif
+#if CFG_ADV_TELEMETRY
+                AdvTelemetrySetAcceleration(ADV_TELEMETRY, sample->value);
+#endif
+                SensorSnapshotSetAcceleration(snapshot, sample);
+                published = true;
+        }
+        if (batch_due(SENSORS_CHAR_ACCELERATION, &acc_batch, sample->timestamp)) {
+                sensors_notify_batch(ss, SENSORS_CHAR_ACCELERATION, &acc_batch);
+        }
+#endif
+
+        /* Tilt is judged on its angles, the magnitude follows the acceleration */
+        tilt_sample.timestamp = sample->timestamp;
+        tilt_sample.value[0] = CurrentTilt.pitch;
+        tilt_sample.value[1] = CurrentTilt.roll;
+        tilt_sample.value[2] = CurrentTilt.tilt;
+
+        if (PublishPolicyCheck(&policies[SENSORS_CHAR_TILT], &tilt_sample)) {
+                uint8_t tilt_value[SENSORS_TILT_VALUE_LEN];
+
+                sensors_pack_tilt(tilt_value, &CurrentTilt);
+#if CFG_SENSORS_READ_FROM_DB
+                sensors_set_value(ss, SENSORS_CHAR_TILT, sizeof(tilt_value), tilt_value);
+#endif
+                sensors_notify_value(ss, SENSORS_CHAR_TILT, sizeof(tilt_value), tilt_value);
+                SensorSnapshotSetTilt(snapshot, sample->timestamp, &CurrentTilt);
+                published = true;
+        }
+
+        return published;
+}
+
+/*
+ * The label only moves once per window or on going idle. It is published when it changed
+ * or its max_interval ran out, never closer together than its min_interval.
+ */
+static bool publish_activity(void)
+{
+        SensorSample_t sample = { .timestamp = OS_GET_TICK_COUNT(),
+                                  .value = { CurrentActivityLabel } };
+
+        if (!PublishPolicyCheck(&policies[SENSORS_CHAR_ACTIVITY], &sample)) {
+                return false;
+        }
+
+        notified_activity = CurrentActivityLabel;
+#if CFG_SENSORS_READ_FROM_DB
+        sensors_set_value(ss, SENSORS_CHAR_ACTIVITY, sizeof(notified_activity), &notified_activity);
+#endif
+        sensors_notify_value(ss, SENSORS_CHAR_ACTIVITY, sizeof(notified_activity), &notified_activity);
+#if CFG_ADV_TELEMETRY
+        AdvTelemetrySetActivity(ADV_TELEMETRY, notified_activity);
+#endif
+        SensorSnapshotSetActivity(snapshot, OS_GET_TICK_COUNT(), notified_activity);
+
+        return true;
+}
 
 /* Declare callback functions for specific BLE events */
 static const sensors_service_cb_t ss_callbacks = {
-        .temp_get_characteristic_value = temp_get_int_val_cb,
-        .acc_get_characteristic_value = acc_get_int_val_cb,
+        .get_value = {
+                [SENSORS_CHAR_TEMPERATURE]  = temp_get_int_val_cb,
+#if CFG_RAW_ACCELERATION
+                [SENSORS_CHAR_ACCELERATION] = acc_get_int_val_cb,
+#endif
+                [SENSORS_CHAR_ACTIVITY]     = activity_get_val_cb,
+                [SENSORS_CHAR_TILT]         = tilt_get_val_cb,
+        },
+        .set_config = set_config_cb,
 };
 
 void ble_peripheral_task(void *params)
@@ -220,6 +1076,20 @@ void ble_peripheral_task(void *params)
 
         srand(time(NULL));
 
+#if CFG_APP_ALLOCATOR
+        /* Before the BLE manager starts sending events */
+        if (!AllocatorInit(&app_alloc, app_memory.pool, sizeof(app_memory.pool),
+                                        app_pool_classes,
+                                        sizeof(app_pool_classes) / sizeof(app_pool_classes[0]),
+                                        app_memory.heap, sizeof(app_memory.heap))) {
+                OS_ASSERT(0);
+        }
+#if CFG_POISON_CHECK
+        poison_area_add(app_memory.pool_guard, CFG_POISON_GUARD_WORDS);
+        poison_area_add(app_memory.heap_guard, CFG_POISON_GUARD_WORDS);
+#endif
+#endif
+
         /* Start BLE device as peripheral */
         ble_peripheral_start();
      
@@ -228,19 +1098,66 @@ void ble_peripheral_task(void *params)
 
         /* Set device name, advertising response data and IO capabilities */
         ble_gap_device_name_set("Dialog Custom", ATT_PERM_READ);
-        ble_gap_adv_data_set(sizeof(adv_data), adv_data, 0, NULL);
+#if CFG_ADV_TELEMETRY
+        AdvTelemetryInit(ADV_TELEMETRY, CFG_ADV_COMPANY_ID);
+#endif
+        update_adv_data();
 
         /* Initialize the custom BLE service */
+        ble_gap_mtu_size_set(CFG_ATT_MTU);
         ss = sensors_init(&ss_callbacks);
+        SampleBatchInit(&temp_batch, 1);
+#if CFG_RAW_ACCELERATION
+        SampleBatchInit(&acc_batch, 3);
+#endif
+        for (int ch = 0; ch < SENSORS_CHAR_COUNT; ch++) {
+                uint8_t channels = (ch == SENSORS_CHAR_TILT ||
+                                    (CFG_RAW_ACCELERATION && ch == ACC_CONFIG_CHAR)) ? 3 : 1;
+                PublishPolicyConfig_t policy;
+
+                policy_from_config(&policy, &default_config[ch]);
+                PublishPolicyInit(&policies[ch], &policy, channels);
+                sensors_set_config(ss, ch, &default_config[ch]);
+        }
+        acc_active_period_ms = default_config[ACC_CONFIG_CHAR].period_ms;
+        notified_activity = ACTIVITY_UNKNOWN;
+        EventBatchInit(&ble_batch, CFG_BLE_EVT_BATCH_MAX, OS_MS_2_TICKS(CFG_BLE_EVT_BATCH_BUDGET_MS));
+        SensorSnapshotInit(snapshot);
+        sensors_set_snapshot(ss, snapshot);
+#if CFG_TEMP_LAZY_SAMPLING
+        LazySamplerInit(&temp_sampler, OS_MS_2_TICKS(CFG_TEMP_STALE_MS));
+#endif
+#if dg_configBLE_L2CAP_COC
+        history_init();
+#endif
         
         /* Setup various timers */
+        ConnParamInit(&conn_param_config);
         setup_timers();
 
-        /* Initialize temperature sensor and create task*/
+        /* Initialize the sensor drivers, they all run on the sensor executor task */
+        SensorExecutorInit();
+        TiltEstimatorInit(CFG_TILT_FILTER_SHIFT);
+        SensorFusionInit(OS_MS_2_TICKS(FUSION_FRAME_PERIOD_MS), OS_MS_2_TICKS(FUSION_MAX_LAG_MS),
+                                                                                sensor_frame_cb);
+        TemperatureDriverRegisterSampleCb(temp_sample_cb);
+#if CFG_TEMP_LAZY_SAMPLING
+        TemperatureDriverRegisterFailCb(temp_fail_cb);
+#endif
         InitTemperatureSensorDriver();
+        i2c_acc_register_mode_cb(acc_mode_changed_cb);
+        i2c_acc_register_sample_cb(acc_sample_cb);
         i2c_acc_init();
 
-        ble_gap_adv_start(GAP_CONN_MODE_UNDIRECTED);
+        /* The driver starts without the FIFO, bring it to the configuration reported above */
+        if (!set_acc_default_config()) {
+                OS_ASSERT(0);
+        }
+#if CFG_STACK_MONITOR
+        setup_stack_monitor();
+#endif
+
+        ble_gap_adv_start(ADV_CONN_MODE);
 
         for (;;) {
                 OS_BASE_TYPE ret;
@@ -264,56 +1181,97 @@ void ble_peripheral_task(void *params)
 
                 /* notified from BLE manager, can get event */
                 if (notif & BLE_APP_NOTIFY_MASK) {
-                        ble_evt_hdr_t *hdr;
+                        drain_ble_events(wdog_id);
+                }
 
-                        hdr = ble_get_event(false);
-                        if (!hdr) {
-                                goto no_event;
-                        }
+                if (notif & TIMER_WHEEL_NOTIF) {
+                        TimerWheelAdvance(&wheel, OS_GET_TICK_COUNT());
+                        rearm_wheel();
+                }
+                if (notif & ACC_MODE_NOTIF) {
+                        handle_acc_mode_changed();
+                }
+                /*
+                 * Going idle drops the partial window and sets the label to idle, and while
+                 * idle no drain comes to send the heartbeat or a change held by min_interval
+                 */
+                if ((notif & (TIMER_WHEEL_NOTIF | ACC_MODE_NOTIF)) && publish_activity()) {
+                        sensors_set_snapshot(ss, snapshot);
+#if CFG_ADV_TELEMETRY
+                        update_adv_data();
+#endif
+                }
+                if (notif & TEMP_SENSOR_NOTIF) {
+                        SensorSample_t sample;
+                        bool publish;
 
-                        if (ble_service_handle_event(hdr)) {
-                                goto handled;
-                        }
+                        TemperatureDriverGetSample(&sample);
+                        SensorFusionPush(SENSOR_STREAM_TEMPERATURE, &sample);
+#if dg_configBLE_L2CAP_COC
+                        history_log_sample(SENSORS_CHAR_TEMPERATURE, 1, &sample);
+#endif
 
-                        switch (hdr->evt_code) {
-                        case BLE_EVT_GAP_CONNECTED:
-                                //do_alert(1);
-                                handle_evt_gap_connected((ble_evt_gap_connected_t *) hdr);
-                                break;
-                        case BLE_EVT_GAP_ADV_COMPLETED:
-                                handle_evt_gap_adv_completed((ble_evt_gap_adv_completed_t *) hdr);
-                                break;
-                        case BLE_EVT_GAP_DISCONNECTED:
-                                //do_alert(0);
-                                handle_evt_gap_disconnected((ble_evt_gap_disconnected_t *) hdr);
-                                break;
-                        case BLE_EVT_GAP_PAIR_REQ:
-                        {
-                                ble_evt_gap_pair_req_t *evt = (ble_evt_gap_pair_req_t *) hdr;
-                                ble_gap_pair_reply(evt->conn_idx, true, evt->bond);
-                                break;
+                        publish = PublishPolicyCheck(&policies[SENSORS_CHAR_TEMPERATURE], &sample);
+#if CFG_TEMP_LAZY_SAMPLING
+                        uint16_t waiting[LAZY_MAX_WAITERS];
+                        uint8_t num_waiting;
+
+                        /* Reads parked for this sample get it even if it is not worth publishing */
+                        num_waiting = LazySamplerSampled(&temp_sampler, sample.timestamp, waiting);
+                        publish = publish || num_waiting;
+#endif
+                        if (publish) {
+                                SampleBatchPush(&temp_batch, &sample);
+#if CFG_SENSORS_READ_FROM_DB
+                                sensors_set_batch(ss, SENSORS_CHAR_TEMPERATURE, &temp_batch);
+#endif
+#if CFG_ADV_TELEMETRY
+                                AdvTelemetrySetTemperature(ADV_TELEMETRY, sample.value[0]);
+                                update_adv_data();
+#endif
+                                SensorSnapshotSetTemperature(snapshot, &sample);
+                                sensors_set_snapshot(ss, snapshot);
                         }
-                        default:
-                                ble_handle_event_default(hdr);
-                                break;
+#if CFG_TEMP_LAZY_SAMPLING
+                        while (num_waiting--) {
+                                sensors_get_batch_cfm(ss, waiting[num_waiting],
+                                                        SENSORS_CHAR_TEMPERATURE, &temp_batch);
                         }
-
-handled:
-                        OS_FREE(hdr);
-
-no_event:
-                        // notify again if there are more events to process in queue
-                        if (ble_has_event()) {
-                                OS_TASK_NOTIFY(OS_GET_CURRENT_TASK(), BLE_APP_NOTIFY_MASK, eSetBits);
+#endif
+                        if (batch_due(SENSORS_CHAR_TEMPERATURE, &temp_batch, sample.timestamp)) {
+                                sensors_notify_batch(ss, SENSORS_CHAR_TEMPERATURE, &temp_batch);
                         }
                 }
-                
-               
-                if (notif & TEMP_MEAS_TIMER_NOTIF) {
-                        DoMeasurementTemperature();
+#if CFG_TEMP_LAZY_SAMPLING
+                if (notif & TEMP_ERROR_NOTIF) {
+                        uint16_t waiting[LAZY_MAX_WAITERS];
+                        uint8_t num_waiting;
+
+                        /* No sample is coming, answer the parked reads before their ATT timeout */
+                        num_waiting = LazySamplerFailed(&temp_sampler, waiting);
+                        while (num_waiting--) {
+                                sensors_get_value_cfm(ss, waiting[num_waiting],
+                                                SENSORS_CHAR_TEMPERATURE, ATT_ERROR_UNLIKELY, 0, NULL);
+                        }
                 }
-                if (notif & ACC_MEAS_TIMER_NOTIF) {
-                        i2c_acc_do_measurement();
+#endif
+                if (notif & ACC_SENSOR_NOTIF) {
+                        uint8_t count;
+                        bool published = false;
+
+                        /* One wake-up per FIFO drain, the driver hands over every sample read */
+                        count = i2c_acc_take_samples(acc_samples, ACC_FIFO_MAX_WATERMARK);
+                        for (uint8_t i = 0; i < count; i++) {
+                                published |= handle_acc_sample(&acc_samples[i]);
+                        }
+
+                        published |= publish_activity();
+                        if (published) {
+                                sensors_set_snapshot(ss, snapshot);
+#if CFG_ADV_TELEMETRY
+                                update_adv_data();
+#endif
+                        }
                 }
 
         }
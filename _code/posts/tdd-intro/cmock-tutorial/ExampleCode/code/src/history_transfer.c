@@ -0,0 +1,286 @@
+/**
+ ****************************************************************************************
+ *
+ * @file history_transfer.c
+ *
+ * @brief Bulk download of the sample history over an L2CAP connection-oriented channel
+ *
+ ****************************************************************************************
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "osal.h"
+#include "ble_bufops.h"
+#include "ble_common.h"
+#include "ble_gap.h"
+#include "ble_l2cap.h"
+#include "ble_peripheral_config.h"
+#include "SampleLog.h"
+#include "history_transfer.h"
+
+/* One download at a time, further channels are refused while it runs */
+typedef struct {
+        uint16_t conn_idx;              // BLE_CONN_IDX_INVALID while no channel is open
+        uint16_t scid;
+        uint16_t mtu;
+        uint16_t remote_credits;
+        bool     streaming;
+        uint32_t offset;                // next log byte to send
+        uint32_t end;                   // newest log byte when the request came in
+        uint32_t unreported;            // bytes not yet taken by history_take_activity()
+        OS_TICK_TIME started;
+} history_channel_t;
+
+PRIVILEGED_DATA static uint8_t log_storage[CFG_HISTORY_LOG_SIZE];
+PRIVILEGED_DATA static SampleLog_t sample_log;
+PRIVILEGED_DATA static history_channel_t channel;
+PRIVILEGED_DATA static history_stats_t stats;
+
+static void close_channel(void)
+{
+        channel.conn_idx = BLE_CONN_IDX_INVALID;
+        channel.streaming = false;
+}
+
+/*
+ * Hand an SDU to the stack, which queues its own copy. An SDU that fits into one K-frame
+ * takes one credit; the stack reports the exact figure with
+ * BLE_EVT_L2CAP_REMOTE_CREDITS_CHANGED.
+ */
+static bool send_sdu(uint16_t len, const uint8_t *data)
+{
+        if (ble_l2cap_send(channel.conn_idx, channel.scid, len, data) != BLE_STATUS_OK) {
+                return false;
+        }
+
+        channel.remote_credits--;
+        return true;
+}
+
+static void finish_transfer(void)
+{
+        uint8_t sdu[1 + sizeof(uint32_t)];
+
+        sdu[0] = HISTORY_OP_END;
+        put_u32(&sdu[1], channel.offset);
+
+        if (!send_sdu(sizeof(sdu), sdu)) {
+                // try again once the stack reports progress
+                return;
+        }
+        channel.streaming = false;
+
+        stats.duration_ms = OS_TICKS_2_MS(OS_GET_TICK_COUNT() - channel.started);
+        stats.bytes_per_s = stats.duration_ms ? (uint32_t) ((uint64_t) stats.bytes * 1000 /
+                                                                        stats.duration_ms) : 0;
+
+#if defined CONFIG_RETARGET
+        printf("history: %lu bytes in %lu ms, %lu B/s\r\n", stats.bytes, stats.duration_ms,
+                                                                        stats.bytes_per_s);
+#endif
+}
+
+/*
+ * Data SDUs carry no offset, the central counts the bytes. If the ring overwrote some it
+ * has not got yet, close the channel: the central asks again with the offset it got to,
+ * and the START answer tells it where the data really resumes.
+ */
+static void abort_transfer(void)
+{
+        stats.aborted++;
+        ble_l2cap_disconnect(channel.conn_idx, channel.scid);
+        close_channel();
+}
+
+/*
+ * Hand the log to the stack for as long as the central grants credits. The data goes
+ * straight from the log storage into ble_l2cap_send(), so the log may move on as soon as
+ * the call returns.
+ */
+static void pump(void)
+{
+        while (channel.streaming && channel.remote_credits) {
+                const uint8_t *data;
+                uint32_t pos = channel.offset;
+                uint32_t len;
+
+                if (channel.offset >= channel.end) {
+                        finish_transfer();
+                        return;
+                }
+
+                // the log works in whole records, the previous SDU may have split one
+                len = SampleLogPeek(&sample_log, &pos, &data);
+                if (pos > channel.offset) {
+                        abort_transfer();
+                        return;
+                }
+                data += channel.offset - pos;
+                len -= channel.offset - pos;
+
+                if (len > channel.end - channel.offset) {
+                        len = channel.end - channel.offset;
+                }
+
+                if (len > channel.mtu) {
+                        len = channel.mtu;
+                }
+
+                if (!send_sdu(len, data)) {
+                        // try again once the stack reports progress
+                        return;
+                }
+
+                channel.offset += len;
+                channel.unreported += len;
+                stats.bytes += len;
+        }
+}
+
+static void start_transfer(uint32_t offset)
+{
+        uint8_t sdu[1 + 2 * sizeof(uint32_t)];
+        const uint8_t *data;
+
+        // the end is fixed now, samples logged during the download go into the next one
+        channel.end = sample_log.head;
+        channel.offset = offset;
+        SampleLogPeek(&sample_log, &channel.offset, &data);
+
+        sdu[0] = HISTORY_OP_START;
+        put_u32(&sdu[1], channel.offset);
+        put_u32(&sdu[5], channel.end);
+
+        if (!channel.remote_credits || !send_sdu(sizeof(sdu), sdu)) {
+                // the central repeats the request when no answer comes
+                return;
+        }
+
+        channel.streaming = true;
+        channel.started = OS_GET_TICK_COUNT();
+        stats.transfers++;
+        stats.bytes = 0;
+}
+
+static void handle_connected(const ble_evt_l2cap_connected_t *evt)
+{
+        if (channel.conn_idx != BLE_CONN_IDX_INVALID) {
+                ble_l2cap_disconnect(evt->conn_idx, evt->scid);
+                return;
+        }
+
+        channel.conn_idx = evt->conn_idx;
+        channel.scid = evt->scid;
+        channel.mtu = evt->mtu;
+        channel.remote_credits = evt->remote_credits;
+        channel.unreported = 0;
+}
+
+static void handle_data_ind(const ble_evt_l2cap_data_ind_t *evt)
+{
+        /* Give the credits back right away, requests are handled before the next one */
+        ble_l2cap_add_credits(evt->conn_idx, evt->scid, evt->local_credits_consumed);
+
+        if (evt->length != 1 + sizeof(uint32_t) || evt->data[0] != HISTORY_OP_REQUEST) {
+                return;
+        }
+
+        start_transfer(get_u32(&evt->data[1]));
+        pump();
+}
+
+static bool is_channel(uint16_t conn_idx, uint16_t scid)
+{
+        return channel.conn_idx == conn_idx && channel.scid == scid;
+}
+
+bool history_handle_event(const ble_evt_hdr_t *hdr)
+{
+        switch (hdr->evt_code) {
+        case BLE_EVT_L2CAP_CONNECTED:
+                handle_connected((const ble_evt_l2cap_connected_t *) hdr);
+                return true;
+        case BLE_EVT_L2CAP_DISCONNECTED:
+        {
+                const ble_evt_l2cap_disconnected_t *evt = (const ble_evt_l2cap_disconnected_t *) hdr;
+
+                if (is_channel(evt->conn_idx, evt->scid)) {
+                        close_channel();
+                }
+                return true;
+        }
+        case BLE_EVT_L2CAP_CONNECTION_FAILED:
+                return true;
+        case BLE_EVT_L2CAP_REMOTE_CREDITS_CHANGED:
+        {
+                const ble_evt_l2cap_remote_credits_changed_t *evt =
+                                        (const ble_evt_l2cap_remote_credits_changed_t *) hdr;
+
+                if (is_channel(evt->conn_idx, evt->scid)) {
+                        channel.remote_credits = evt->remote_credits;
+                        pump();
+                }
+                return true;
+        }
+        case BLE_EVT_L2CAP_DATA_IND:
+        {
+                const ble_evt_l2cap_data_ind_t *evt = (const ble_evt_l2cap_data_ind_t *) hdr;
+
+                if (is_channel(evt->conn_idx, evt->scid)) {
+                        handle_data_ind(evt);
+                }
+                return true;
+        }
+        case BLE_EVT_L2CAP_SENT:
+        {
+                const ble_evt_l2cap_sent_t *evt = (const ble_evt_l2cap_sent_t *) hdr;
+
+                if (is_channel(evt->conn_idx, evt->scid)) {
+                        pump();
+                }
+                return true;
+        }
+        default:
+                return false;
+        }
+}
+
+void history_listen(uint16_t conn_idx)
+{
+        uint16_t scid;
+
+        ble_l2cap_listen(conn_idx, CFG_HISTORY_PSM, GAP_SEC_LEVEL_1, CFG_HISTORY_INITIAL_CREDITS,
+                                                                                        &scid);
+}
+
+void history_log_sample(uint8_t source, uint8_t channels, const SensorSample_t *sample)
+{
+        SampleLogAppend(&sample_log, source, channels, sample);
+}
+
+bool history_take_activity(uint16_t conn_idx, uint32_t *bytes)
+{
+        *bytes = 0;
+
+        if (channel.conn_idx != conn_idx) {
+                return false;
+        }
+
+        *bytes = channel.unreported;
+        channel.unreported = 0;
+
+        return channel.streaming;
+}
+
+void history_get_stats(history_stats_t *out)
+{
+        *out = stats;
+}
+
+void history_init(void)
+{
+        memset(&stats, 0, sizeof(stats));
+        SampleLogInit(&sample_log, log_storage, sizeof(log_storage));
+        close_channel();
+}
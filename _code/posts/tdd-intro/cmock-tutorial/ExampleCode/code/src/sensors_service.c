@@ -5,112 +5,739 @@
 #include "ble_att.h"
 #include "ble_bufops.h"
 #include "ble_common.h"
+#include "ble_gap.h"
 #include "ble_gatt.h"
 #include "ble_gatts.h"
 #include "ble_storage.h"
 #include "ble_uuid.h"
+#include "ble_peripheral_config.h"
+#include "common.h"
 #include "sensors_service.h"
 
-static const char temp_user_descriptor_val[]  = "Read temperature values";
-static const char acc_user_descriptor_val[]  = "Read accelerometer values";
+/*
+ * In read-from-DB mode the application keeps the attribute values up to date and the BLE
+ * manager answers reads itself, otherwise every read is forwarded to the application.
+ */
+#define VALUE_READ_FLAGS(forward_reads) \
+        ((!CFG_SENSORS_READ_FROM_DB || (forward_reads)) ? GATTS_FLAG_CHAR_READ_REQ : 0)
+
+/*
+ * Every characteristic is registered with the same attribute layout, so the characteristic
+ * and the attribute kind follow directly from the handle offset within the service.
+ */
+enum {
+        ATTR_DECLARATION,
+        ATTR_VALUE,
+        ATTR_CCC,
+        ATTR_CUD,
+        ATTRS_PER_CHAR,
+};
+
+/* Handle offset from the service declaration */
+#define ATTR_OFFSET(ch, attr)   ( 1 + (ch) * ATTRS_PER_CHAR + (attr) )
+
+/* Attributes taken by the characteristics of the table */
+#define SENSORS_TABLE_ATTR      (SENSORS_CHAR_COUNT * ATTRS_PER_CHAR)
+
+/*
+ * The notification rate characteristic follows the table. It has no CCC, and its value
+ * is per central, so reads always go to the service.
+ */
+enum {
+        RATE_ATTR_DECLARATION,
+        RATE_ATTR_VALUE,
+        RATE_ATTR_CUD,
+        RATE_NUM_ATTR,
+};
+
+#define RATE_OFFSET(attr)       ( 1 + SENSORS_TABLE_ATTR + (attr) )
+
+/*
+ * The configuration characteristic comes last. Its value is the same for every central and
+ * kept in the attribute database, so reads, long ones included, never reach the service.
+ */
+enum {
+        CONFIG_ATTR_DECLARATION,
+        CONFIG_ATTR_VALUE,
+        CONFIG_ATTR_CUD,
+        CONFIG_NUM_ATTR,
+};
+
+#define CONFIG_OFFSET(attr)     ( 1 + SENSORS_TABLE_ATTR + RATE_NUM_ATTR + (attr) )
+
+/*
+ * The snapshot characteristic follows, read-only and always served from the attribute
+ * database: at 35 bytes it usually takes a long read, which the stack answers on its own.
+ */
+enum {
+        SNAPSHOT_ATTR_DECLARATION,
+        SNAPSHOT_ATTR_VALUE,
+        SNAPSHOT_ATTR_CUD,
+        SNAPSHOT_NUM_ATTR,
+};
+
+#define SNAPSHOT_OFFSET(attr)   ( 1 + SENSORS_TABLE_ATTR + RATE_NUM_ATTR + CONFIG_NUM_ATTR + (attr) )
+
+/*
+ * With CFG_STACK_MONITOR the stack usage debug characteristic comes last, read-only and
+ * served from the attribute database like the snapshot.
+ */
+#if CFG_STACK_MONITOR
+enum {
+        STACK_ATTR_DECLARATION,
+        STACK_ATTR_VALUE,
+        STACK_ATTR_CUD,
+        STACK_NUM_ATTR,
+};
+
+#define STACK_OFFSET(attr)      ( 1 + SENSORS_TABLE_ATTR + RATE_NUM_ATTR + CONFIG_NUM_ATTR + \
+                                                                SNAPSHOT_NUM_ATTR + (attr) )
+#else
+#define STACK_NUM_ATTR          (0)
+#endif
+
+/* Attribute count of the service, what ble_gatts_get_num_attr() would return */
+#define SENSORS_NUM_ATTR        (SENSORS_TABLE_ATTR + RATE_NUM_ATTR + CONFIG_NUM_ATTR + \
+                                                        SNAPSHOT_NUM_ATTR + STACK_NUM_ATTR)
+
+/*
+ * 128-bit UUIDs are stored little endian, the X-macro lists their bytes in string order
+ */
+#define UUID128_LE(b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, b14, b15) \
+        { .type = ATT_UUID_128, .uuid128 = { b15, b14, b13, b12, b11, b10, b9, b8, \
+                                             b7, b6, b5, b4, b3, b2, b1, b0 } }
+#define UUID128(...)            UUID128_LE(__VA_ARGS__)
+
+typedef struct {
+        att_uuid_t  uuid;
+        const char *description;        // Characteristic User Description
+        uint16_t    description_len;
+        uint16_t    max_len;
+        gatts_flag_t read_flags;
+} sensors_char_desc_t;
+
+#define SENSORS_CHAR_DESC(name, description, max_len, forward_reads, ...) \
+        [SENSORS_CHAR_##name] = { UUID128(__VA_ARGS__), description, sizeof(description) - 1, \
+                                  max_len, VALUE_READ_FLAGS(forward_reads) },
+
+static const sensors_char_desc_t char_table[SENSORS_CHAR_COUNT] = {
+        SENSORS_CHARACTERISTICS(SENSORS_CHAR_DESC)
+};
+
+/* 00000000-1111-2222-2222-333333333333 */
+static const att_uuid_t service_uuid = UUID128(0x00, 0x00, 0x00, 0x00, 0x11, 0x11, 0x22, 0x22,
+                                               0x22, 0x22, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33);
+
+/* 88888888-0000-0000-0000-888888888888 */
+static const att_uuid_t rate_uuid = UUID128(0x88, 0x88, 0x88, 0x88, 0x00, 0x00, 0x00, 0x00,
+                                            0x00, 0x00, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88);
+static const char rate_description[] = "Notify every n-th update";
+
+/* 99999999-0000-0000-0000-999999999999 */
+static const att_uuid_t config_uuid = UUID128(0x99, 0x99, 0x99, 0x99, 0x00, 0x00, 0x00, 0x00,
+                                              0x00, 0x00, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99);
+static const char config_description[] = "Sampling and publish configuration";
+
+/* AAAAAAAA-0000-0000-0000-AAAAAAAAAAAA */
+static const att_uuid_t snapshot_uuid = UUID128(0xAA, 0xAA, 0xAA, 0xAA, 0x00, 0x00, 0x00, 0x00,
+                                                0x00, 0x00, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA);
+static const char snapshot_description[] = "Read all sensors at once";
+
+#if CFG_STACK_MONITOR
+/* BBBBBBBB-0000-0000-0000-BBBBBBBBBBBB */
+static const att_uuid_t stack_uuid = UUID128(0xBB, 0xBB, 0xBB, 0xBB, 0x00, 0x00, 0x00, 0x00,
+                                             0x00, 0x00, 0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xBB);
+static const char stack_description[] = "Task stack size and peak use";
+#endif
+
+static const att_uuid_t ccc_uuid = { .type = ATT_UUID_16, .uuid16 = UUID_GATT_CLIENT_CHAR_CONFIGURATION };
+static const att_uuid_t cud_uuid = { .type = ATT_UUID_16, .uuid16 = UUID_GATT_CHAR_USER_DESCRIPTION };
 
 /* Service related variables */
 typedef struct {
         ble_service_t svc;
 
         // User-defined callback functions
-//        const temperature_service_cb_t *cb;
         const sensors_service_cb_t *cb;
 
-        // Attribute handles of BLE service
-        uint16_t temp_int_value_h;
-        uint16_t acc_int_value_h;
+        // Payload efficiency of the batched characteristics
+        SampleBatchStats_t stats[SENSORS_CHAR_COUNT];
+
+        // Configuration in effect, mirrored to the configuration characteristic
+        sensors_config_t config[SENSORS_CHAR_COUNT];
 
 } sensors_service_t;
 
+/* Only one instance exists, so its size is known at link time */
+PRIVILEGED_DATA static sensors_service_t sensors_service;
 
-/* This function is called upon read requests to characteristic attribue value */
-static void read_temp_int_value(sensors_service_t *ss, const ble_evt_gatts_read_req_t *evt)
+/*
+ * Batch payloads are packed into buffers of the application allocator, sized for the MTU
+ * at hand and given back once the stack took its copy. Each path is its own allocation
+ * site so that its peak shows separately.
+ */
+INITIALISED_PRIVILEGED_DATA static AllocSite_t read_site = ALLOC_SITE_INIT("batch reads");
+INITIALISED_PRIVILEGED_DATA static AllocSite_t notify_site = ALLOC_SITE_INIT("batch notifications");
+INITIALISED_PRIVILEGED_DATA static AllocSite_t db_site = ALLOC_SITE_INIT("batch db values");
+
+static uint16_t attr_handle(const sensors_service_t *ss, sensors_char_t ch, uint8_t attr)
 {
-        /*
-         * Check whether the application has defined a callback function
-         * for handling the event.
-         */
-        if (!ss->cb || !ss->cb->temp_get_characteristic_value) {
-                ble_gatts_read_cfm(evt->conn_idx, evt->handle, ATT_ERROR_READ_NOT_PERMITTED, 0, NULL);
-                return;
+        return ss->svc.start_h + ATTR_OFFSET(ch, attr);
+}
+
+static uint16_t rate_handle(const sensors_service_t *ss)
+{
+        return ss->svc.start_h + RATE_OFFSET(RATE_ATTR_VALUE);
+}
+
+static uint16_t config_handle(const sensors_service_t *ss)
+{
+        return ss->svc.start_h + CONFIG_OFFSET(CONFIG_ATTR_VALUE);
+}
+
+/* Constant time handle lookup, returns false for handles outside of the table */
+static bool lookup_handle(const sensors_service_t *ss, uint16_t handle, sensors_char_t *ch,
+                                                                                uint8_t *attr)
+{
+        uint16_t offset;
+
+        if (handle <= ss->svc.start_h || handle > ss->svc.start_h + SENSORS_TABLE_ATTR) {
+                return false;
         }
 
-        /* The application should provide the requested data to the peer device.  */
-        ss->cb->temp_get_characteristic_value(&ss->svc, evt->conn_idx);
+        offset = handle - ss->svc.start_h - 1;
+        *ch = (sensors_char_t) (offset / ATTRS_PER_CHAR);
+        *attr = offset % ATTRS_PER_CHAR;
 
-        // callback executed properly
+        return true;
+}
+
+/* Largest attribute value that fits into one notification at the given MTU */
+static uint16_t payload_len(uint16_t mtu)
+{
+        uint16_t len = mtu - SAMPLE_BATCH_ATT_OVERHEAD;
+
+        return (len > SENSORS_MAX_PAYLOAD_LEN) ? SENSORS_MAX_PAYLOAD_LEN : len;
+}
+
+/*
+ * Smallest link sizes among the subscribers of the characteristic, so that one payload
+ * suits all of them. Returns false if nobody subscribed.
+ */
+static bool subscriber_link(sensors_char_t ch, uint16_t *mtu, uint16_t *ll_octets)
+{
+        bool found = false;
+        uint8_t slot;
+
+        *mtu = SENSORS_DEFAULT_ATT_MTU;
+        *ll_octets = SENSORS_DEFAULT_LL_OCTETS;
+
+        for (slot = 0; slot < CONN_MAX; slot++) {
+                const ConnRecord_t *rec = ConnTableAt(slot);
+
+                if (!rec || !ConnIsSubscribed(rec, ch)) {
+                        continue;
+                }
+
+                if (!found || rec->mtu < *mtu) {
+                        *mtu = rec->mtu;
+                }
+                if (!found || rec->ll_octets < *ll_octets) {
+                        *ll_octets = rec->ll_octets;
+                }
+                found = true;
+        }
+
+        return found;
+}
+
+/* Pack the newest samples that fit, without taking them out of the batch */
+static size_t pack_newest(const SampleBatch_t *batch, uint8_t *pdu, size_t max_len)
+{
+        uint8_t capacity = SampleBatchCapacity(batch, max_len);
+        uint8_t first = (batch->count > capacity) ? batch->count - capacity : 0;
+        uint8_t packed;
+
+        return SampleBatchPack(batch, first, pdu, max_len, &packed);
+}
+
+void sensors_pack_tilt(uint8_t *pdu, const Tilt_t *value)
+{
+        put_u16(&pdu[0], (uint16_t) value->pitch);
+        put_u16(&pdu[2], (uint16_t) value->roll);
+        put_u16(&pdu[4], (uint16_t) value->tilt);
+        put_u16(&pdu[6], value->magnitude);
 }
 
 
 /* This function is called upon read requests to characteristic attribue value */
-static void read_acc_int_value(sensors_service_t *ss, const ble_evt_gatts_read_req_t *evt)
+static void read_value(sensors_service_t *ss, sensors_char_t ch, const ble_evt_gatts_read_req_t *evt)
 {
         /*
          * Check whether the application has defined a callback function
          * for handling the event.
          */
-        if (!ss->cb || !ss->cb->acc_get_characteristic_value) {
+        if (!ss->cb || !ss->cb->get_value[ch]) {
                 ble_gatts_read_cfm(evt->conn_idx, evt->handle, ATT_ERROR_READ_NOT_PERMITTED, 0, NULL);
                 return;
         }
 
         /* The application should provide the requested data to the peer device.  */
-        ss->cb->acc_get_characteristic_value(&ss->svc, evt->conn_idx);
+        ss->cb->get_value[ch](&ss->svc, evt->conn_idx, ch);
 
         // callback executed properly
 }
 
+/* Subscriptions live in the connection table, BLE storage keeps them for bonded centrals */
+static void read_ccc(sensors_char_t ch, const ble_evt_gatts_read_req_t *evt)
+{
+        const ConnRecord_t *rec = ConnTableFind(evt->conn_idx);
+        uint16_t ccc = GATT_CCC_NONE;
+
+        if (rec) {
+                ccc = ConnGetCcc(rec, ch);
+        } else {
+                ble_storage_get_u16(evt->conn_idx, evt->handle, &ccc);
+        }
+
+        // we're little-endian, ok to use value as-is
+        ble_gatts_read_cfm(evt->conn_idx, evt->handle, ATT_ERROR_OK, sizeof(ccc), &ccc);
+}
+
 
 /*---------------------------------------------------------------------------------------------------------------------------------------------------------------*/
 
 /*
  * This function should be called by the application as a response to read requests
  */
-void temp_get_int_value_cfm(ble_service_t *svc, uint16_t conn_idx, att_error_t status, const uint16_t *value)
+void sensors_get_value_cfm(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch,
+                                        att_error_t status, uint16_t length, const void *value)
 {
         sensors_service_t *ss = (sensors_service_t *) svc;
-        uint16_t pdu[1];
-
-        pdu[0] = *value;
 
         /* This function should be used as a response for every read request */
-        ble_gatts_read_cfm(conn_idx, ss->temp_int_value_h, ATT_ERROR_OK, sizeof(pdu), pdu);
+        ble_gatts_read_cfm(conn_idx, attr_handle(ss, ch, ATTR_VALUE), status, length, value);
+}
+
+/* A read returns the newest samples that fit the reader's MTU, without taking them out */
+void sensors_get_batch_cfm(ble_service_t *svc, uint16_t conn_idx, sensors_char_t ch,
+                                                                const SampleBatch_t *batch)
+{
+        const ConnRecord_t *rec = ConnTableFind(conn_idx);
+        uint16_t mtu = rec ? rec->mtu : SENSORS_DEFAULT_ATT_MTU;
+        uint16_t max_len = payload_len(mtu);
+        uint8_t *pdu = app_malloc(max_len, &read_site);
+
+        if (!pdu) {
+                sensors_get_value_cfm(svc, conn_idx, ch, ATT_ERROR_INSUFFICIENT_RESOURCES, 0,
+                                                                                        NULL);
+                return;
+        }
+
+        sensors_get_value_cfm(svc, conn_idx, ch, ATT_ERROR_OK,
+                                                pack_newest(batch, pdu, max_len), pdu);
+        app_free(pdu);
+}
+
+static att_error_t write_ccc(sensors_char_t ch, const ble_evt_gatts_write_req_t *evt)
+{
+        ConnRecord_t *rec = ConnTableFind(evt->conn_idx);
+        uint16_t ccc;
+
+        if (evt->offset) {
+                return ATT_ERROR_ATTRIBUTE_NOT_LONG;
+        }
+
+        if (evt->length != sizeof(ccc)) {
+                return ATT_ERROR_APPLICATION_ERROR;
+        }
+
+        ccc = get_u16(evt->value);
+
+        if (rec) {
+                ConnSetCcc(rec, ch, ccc);
+        }
+
+        ble_storage_put_u32(evt->conn_idx, evt->handle, ccc, true);
+
+        return ATT_ERROR_OK;
+}
+
+/* The central asks for every n-th update of one characteristic: { characteristic, n } */
+static att_error_t write_rate(const ble_evt_gatts_write_req_t *evt)
+{
+        ConnRecord_t *rec = ConnTableFind(evt->conn_idx);
+
+        if (evt->offset) {
+                return ATT_ERROR_ATTRIBUTE_NOT_LONG;
+        }
+
+        if (evt->length != 2 || evt->value[0] >= SENSORS_CHAR_COUNT) {
+                return ATT_ERROR_APPLICATION_ERROR;
+        }
+
+        if (!rec) {
+                return ATT_ERROR_INSUFFICIENT_RESOURCES;
+        }
+
+        ConnSetDecimation(rec, evt->value[0], evt->value[1]);
+
+        return ATT_ERROR_OK;
+}
+
+/* Reading the rate returns the central's decimation of every characteristic */
+static void read_rate(const ble_evt_gatts_read_req_t *evt)
+{
+        const ConnRecord_t *rec = ConnTableFind(evt->conn_idx);
+        uint8_t rates[SENSORS_CHAR_COUNT] = { 0 };
+
+        if (rec) {
+                memcpy(rates, rec->decimation, sizeof(rates));
+        }
+
+        ble_gatts_read_cfm(evt->conn_idx, evt->handle, ATT_ERROR_OK, sizeof(rates), rates);
+}
+
+static void pack_config(uint8_t *p, const sensors_config_t *config)
+{
+        put_u32(&p[0], config->period_ms);
+        p[4] = config->odr;
+        p[5] = config->fifo_watermark;
+        put_u16(&p[6], config->deadband);
+        put_u16(&p[8], config->relative_permille);
+        put_u32(&p[10], config->min_interval_ms);
+        put_u32(&p[14], config->max_interval_ms);
+}
+
+static void unpack_config(sensors_config_t *config, const uint8_t *p)
+{
+        config->period_ms = get_u32(&p[0]);
+        config->odr = p[4];
+        config->fifo_watermark = p[5];
+        config->deadband = get_u16(&p[6]);
+        config->relative_permille = get_u16(&p[8]);
+        config->min_interval_ms = get_u32(&p[10]);
+        config->max_interval_ms = get_u32(&p[14]);
+}
+
+/* The central reconfigures one characteristic: { characteristic, config } */
+static att_error_t write_config(sensors_service_t *ss, const ble_evt_gatts_write_req_t *evt)
+{
+        sensors_config_t config;
+        att_error_t status;
+
+        if (evt->offset) {
+                return ATT_ERROR_ATTRIBUTE_NOT_LONG;
+        }
+
+        if (evt->length != 1 + SENSORS_CONFIG_LEN || evt->value[0] >= SENSORS_CHAR_COUNT) {
+                return ATT_ERROR_APPLICATION_ERROR;
+        }
+
+        if (!ss->cb || !ss->cb->set_config) {
+                return ATT_ERROR_WRITE_NOT_PERMITTED;
+        }
+
+        unpack_config(&config, &evt->value[1]);
+        if (config.min_interval_ms > config.max_interval_ms && config.max_interval_ms) {
+                return ATT_ERROR_APPLICATION_ERROR;
+        }
+
+        status = ss->cb->set_config(&ss->svc, evt->conn_idx, evt->value[0], &config);
+        if (status == ATT_ERROR_OK) {
+                sensors_set_config(&ss->svc, evt->value[0], &config);
+        }
+
+        return status;
 }
 
-void acc_get_int_value_cfm(ble_service_t *svc, uint16_t conn_idx, att_error_t status, const uint16_t *value)
+void sensors_set_config(ble_service_t *svc, sensors_char_t ch, const sensors_config_t *config)
 {
         sensors_service_t *ss = (sensors_service_t *) svc;
-        uint16_t pdu[1];
+        uint8_t value[SENSORS_CHAR_COUNT * SENSORS_CONFIG_LEN];
+        int i;
 
-        pdu[0] = *value;
+        ss->config[ch] = *config;
 
-        /* This function should be used as a response for every read request */
-        ble_gatts_read_cfm(conn_idx, ss->acc_int_value_h, ATT_ERROR_OK, sizeof(pdu), pdu);
+        for (i = 0; i < SENSORS_CHAR_COUNT; i++) {
+                pack_config(&value[i * SENSORS_CONFIG_LEN], &ss->config[i]);
+        }
+
+        ble_gatts_set_value(config_handle(ss), sizeof(value), value);
+}
+
+/* Handler for write requests, that is BLE_EVT_GATTS_WRITE_REQ */
+static void handle_write_req(ble_service_t *svc, const ble_evt_gatts_write_req_t *evt)
+{
+        sensors_service_t *ss = (sensors_service_t *) svc;
+        att_error_t status = ATT_ERROR_WRITE_NOT_PERMITTED;
+        sensors_char_t ch;
+        uint8_t attr;
+
+        if (evt->handle == rate_handle(ss)) {
+                status = write_rate(evt);
+        } else if (evt->handle == config_handle(ss)) {
+                status = write_config(ss, evt);
+        } else if (lookup_handle(ss, evt->handle, &ch, &attr) && attr == ATTR_CCC) {
+                status = write_ccc(ch, evt);
+        }
+
+        ble_gatts_write_cfm(evt->conn_idx, evt->handle, status);
+}
+
+/*
+ * Push a new value to every connected central that enabled notifications or indications
+ * on the characteristic, at the rate it asked for and as long as it has TX credits.
+ * Centrals that did not subscribe still read it on demand.
+ */
+uint8_t sensors_notify_value(ble_service_t *svc, sensors_char_t ch, uint16_t length,
+                                                                        const void *value)
+{
+        sensors_service_t *ss = (sensors_service_t *) svc;
+        uint16_t value_h = attr_handle(ss, ch, ATTR_VALUE);
+        uint8_t sent = 0;
+        uint8_t slot;
+
+        for (slot = 0; slot < CONN_MAX; slot++) {
+                ConnRecord_t *rec = ConnTableAt(slot);
+                gatt_event_t type;
+
+                if (!rec || !ConnTakeUpdate(rec, ch)) {
+                        continue;
+                }
+
+                type = (rec->notify_mask & (1 << ch)) ? GATT_EVENT_NOTIFICATION : GATT_EVENT_INDICATION;
+
+                if (ble_gatts_send_event(rec->conn_idx, value_h, type, length, value) != BLE_STATUS_OK) {
+                        ConnReturnCredit(rec);
+                        continue;
+                }
+
+                rec->bytes += length;
+                sent++;
+        }
+
+        return sent;
+}
+
+/*
+ * Count the centrals the next update of ch is due for. Returns false when one of them has
+ * no TX credit left, a payload sent now would never reach it.
+ */
+static bool due_subscribers(sensors_char_t ch, uint8_t *due)
+{
+        uint8_t slot;
+
+        *due = 0;
+
+        for (slot = 0; slot < CONN_MAX; slot++) {
+                ConnRecord_t *rec = ConnTableAt(slot);
+
+                if (!rec || !ConnIsDue(rec, ch)) {
+                        continue;
+                }
+                if (!rec->tx_credits) {
+                        rec->no_credit++;
+                        return false;
+                }
+                (*due)++;
+        }
+
+        return true;
+}
+
+/*
+ * Drain the batch in MTU-sized payloads. Samples stay buffered while nobody subscribed,
+ * so a late subscriber or a read still gets the recent history. A payload is consumed
+ * only once every central it was due for queued it: one out of TX credits holds the
+ * samples back until its credits return, and if queueing failed for one the others get
+ * the payload again on the next attempt.
+ */
+void sensors_notify_batch(ble_service_t *svc, sensors_char_t ch, SampleBatch_t *batch)
+{
+        sensors_service_t *ss = (sensors_service_t *) svc;
+        uint16_t mtu;
+        uint16_t ll_octets;
+        uint8_t *pdu;
+
+        if (!batch->count || !subscriber_link(ch, &mtu, &ll_octets)) {
+                return;
+        }
+
+        // out of buffers the samples stay in the batch for the next attempt
+        pdu = app_malloc(payload_len(mtu), &notify_site);
+        if (!pdu) {
+                return;
+        }
+
+        while (batch->count) {
+                uint8_t packed;
+                uint8_t due;
+                uint8_t sent;
+                size_t len;
+
+                if (!due_subscribers(ch, &due)) {
+                        break;
+                }
+
+                len = SampleBatchPack(batch, 0, pdu, payload_len(mtu), &packed);
+                if (!packed) {
+                        break;
+                }
+
+                // decimated centrals still count this update even when nobody is due
+                sent = sensors_notify_value(svc, ch, len, pdu);
+                if (!sent || sent != due) {
+                        break;
+                }
+
+                SampleBatchAccount(&ss->stats[ch], batch, len, packed, ll_octets);
+                SampleBatchConsume(batch, packed);
+        }
+
+        app_free(pdu);
+}
+
+/*
+ * Attribute database updates for read-from-DB mode. Long batches are fetched by the
+ * central with Read Blob requests, which the BLE manager also serves on its own.
+ */
+void sensors_set_value(ble_service_t *svc, sensors_char_t ch, uint16_t length, const void *value)
+{
+        sensors_service_t *ss = (sensors_service_t *) svc;
+
+        ble_gatts_set_value(attr_handle(ss, ch, ATTR_VALUE), length, value);
+}
+
+void sensors_set_batch(ble_service_t *svc, sensors_char_t ch, const SampleBatch_t *batch)
+{
+        uint8_t *pdu = app_malloc(SENSORS_MAX_PAYLOAD_LEN, &db_site);
+
+        // out of buffers the database keeps the previous value until the next sample
+        if (!pdu) {
+                return;
+        }
+
+        sensors_set_value(svc, ch, pack_newest(batch, pdu, SENSORS_MAX_PAYLOAD_LEN), pdu);
+        app_free(pdu);
+}
+
+void sensors_set_mtu(ble_service_t *svc, uint16_t conn_idx, uint16_t mtu)
+{
+        ConnRecord_t *rec = ConnTableFind(conn_idx);
+
+        if (rec) {
+                rec->mtu = mtu;
+        }
+}
+
+void sensors_set_data_length(ble_service_t *svc, uint16_t conn_idx, uint16_t tx_octets)
+{
+        ConnRecord_t *rec = ConnTableFind(conn_idx);
+
+        if (rec) {
+                rec->ll_octets = tx_octets;
+        }
+}
+
+uint16_t sensors_get_payload_len(ble_service_t *svc, sensors_char_t ch)
+{
+        uint16_t mtu;
+        uint16_t ll_octets;
+
+        subscriber_link(ch, &mtu, &ll_octets);
+
+        return payload_len(mtu);
+}
+
+void sensors_get_batch_stats(ble_service_t *svc, sensors_char_t ch, SampleBatchStats_t *stats)
+{
+        sensors_service_t *ss = (sensors_service_t *) svc;
+
+        *stats = ss->stats[ch];
 }
 
 /* Handler for read requests, that is BLE_EVT_GATTS_READ_REQ */
 static void handle_read_req(ble_service_t *svc, const ble_evt_gatts_read_req_t *evt)
 {
         sensors_service_t *ss = (sensors_service_t *) svc;
+        sensors_char_t ch;
+        uint8_t attr;
+
         /*
-         * Identify for which attribute handle the read request has been sent to
-         * and call the appropriate function.
+         * Everything answered here fits one read response, batches are packed to the
+         * reader's MTU. A batch also moves on between two reads, so a read blob would not
+         * continue the value the first read returned.
          */
+        if (evt->offset) {
+                ble_gatts_read_cfm(evt->conn_idx, evt->handle, ATT_ERROR_ATTRIBUTE_NOT_LONG, 0, NULL);
+                return;
+        }
 
-        if (evt->handle == ss->temp_int_value_h) {
-                read_temp_int_value(ss, evt);
+        /*
+         * Identify for which attribute the read request has been sent to
+         * and call the appropriate function.
+         */
+        if (evt->handle == rate_handle(ss)) {
+                read_rate(evt);
+                return;
         }
-        else if (evt->handle == ss->acc_int_value_h) {
-                read_acc_int_value(ss, evt); 
+
+        if (!lookup_handle(ss, evt->handle, &ch, &attr)) {
+                ble_gatts_read_cfm(evt->conn_idx, evt->handle, ATT_ERROR_READ_NOT_PERMITTED, 0, NULL);
+                return;
         }
-        else {
+
+        switch (attr) {
+        case ATTR_VALUE:
+                read_value(ss, ch, evt);
+                break;
+        case ATTR_CCC:
+                read_ccc(ch, evt);
+                break;
+        default:
                 ble_gatts_read_cfm(evt->conn_idx, evt->handle, ATT_ERROR_READ_NOT_PERMITTED, 0, NULL);
+                break;
+        }
+}
+
+
+/* Every central gets a record, bonded ones start with the subscriptions they had before */
+static void handle_connected_evt(ble_service_t *svc, const ble_evt_gap_connected_t *evt)
+{
+        sensors_service_t *ss = (sensors_service_t *) svc;
+        ConnRecord_t *rec;
+        int ch;
+
+        rec = ConnTableAdd(evt->conn_idx, SENSORS_DEFAULT_ATT_MTU, SENSORS_DEFAULT_LL_OCTETS);
+        if (!rec) {
+                // more centrals than records, this one can only read
+                return;
+        }
+
+        for (ch = 0; ch < SENSORS_CHAR_COUNT; ch++) {
+                uint16_t ccc = GATT_CCC_NONE;
+
+                ble_storage_get_u16(evt->conn_idx, attr_handle(ss, ch, ATTR_CCC), &ccc);
+                ConnSetCcc(rec, ch, ccc);
+        }
+}
+
+static void handle_disconnected_evt(ble_service_t *svc, const ble_evt_gap_disconnected_t *evt)
+{
+        ConnTableRemove(evt->conn_idx);
+}
+
+/* A notification or indication left the TX queue, the central can take another one */
+static void handle_event_sent(ble_service_t *svc, const ble_evt_gatts_event_sent_t *evt)
+{
+        sensors_service_t *ss = (sensors_service_t *) svc;
+        ConnRecord_t *rec = ConnTableFind(evt->conn_idx);
+        sensors_char_t ch;
+        uint8_t attr;
+
+        if (rec && lookup_handle(ss, evt->handle, &ch, &attr)) {
+                ConnReturnCredit(rec);
         }
 }
 
@@ -118,86 +745,172 @@ static void handle_read_req(ble_service_t *svc, const ble_evt_gatts_read_req_t *
 static void cleanup(ble_service_t *svc)
 {
         sensors_service_t *ss = (sensors_service_t *) svc;
-        OS_FREE(ss);
+        memset(ss, 0, sizeof(*ss));
+        ConnTableInit();
 }
 
+/* Add one characteristic of the table: value, CCC and CUD, in the order of ATTR_* */
+static void add_characteristic(sensors_char_t ch)
+{
+        const sensors_char_desc_t *desc = &char_table[ch];
+        uint16_t value_h;
+        uint16_t ccc_h;
+        uint16_t cud_h;
 
-/* Initialization function for My Custom Service (sensors).*/
-ble_service_t *sensors_init(const sensors_service_cb_t *cb)
+        ble_gatts_add_characteristic(&desc->uuid, GATT_PROP_READ | GATT_PROP_NOTIFY | GATT_PROP_INDICATE,
+                            ATT_PERM_READ, desc->max_len, desc->read_flags, NULL, &value_h);
+
+        /* Client Characteristic Configuration descriptor, enables notifications/indications */
+        ble_gatts_add_descriptor(&ccc_uuid, ATT_PERM_RW, sizeof(uint16_t), 0, &ccc_h);
+
+        /* Define descriptor of type Characteristic User Description (CUD) */
+        ble_gatts_add_descriptor(&cud_uuid, ATT_PERM_READ, desc->description_len, 0, &cud_h);
+
+        /* Dispatch relies on every characteristic having exactly this layout */
+        OS_ASSERT(value_h == ATTR_OFFSET(ch, ATTR_VALUE));
+        OS_ASSERT(ccc_h == ATTR_OFFSET(ch, ATTR_CCC));
+        OS_ASSERT(cud_h == ATTR_OFFSET(ch, ATTR_CUD));
+}
+
+/* Per-central notification rate: declaration, value and CUD, in the order of RATE_ATTR_* */
+static void add_rate_characteristic(void)
 {
-        sensors_service_t *ss;
+        uint16_t value_h;
+        uint16_t cud_h;
 
-        uint16_t num_attr;
-        att_uuid_t uuid;
+        ble_gatts_add_characteristic(&rate_uuid, GATT_PROP_READ | GATT_PROP_WRITE, ATT_PERM_RW,
+                                SENSORS_CHAR_COUNT, GATTS_FLAG_CHAR_READ_REQ, NULL, &value_h);
 
-        uint16_t temp_char_user_descriptor_h;
-        uint16_t acc_char_user_descriptor_h;
+        ble_gatts_add_descriptor(&cud_uuid, ATT_PERM_READ, sizeof(rate_description) - 1, 0, &cud_h);
 
-        /* Allocate memory for the sevice hanle */
-        ss = (sensors_service_t *)OS_MALLOC(sizeof(*ss));
-        memset(ss, 0, sizeof(*ss));
+        OS_ASSERT(value_h == RATE_OFFSET(RATE_ATTR_VALUE));
+        OS_ASSERT(cud_h == RATE_OFFSET(RATE_ATTR_CUD));
+}
 
+/* Sampling and publish configuration: declaration, value and CUD, in the order of CONFIG_ATTR_* */
+static void add_config_characteristic(void)
+{
+        uint16_t value_h;
+        uint16_t cud_h;
 
-        /* Declare handlers for specific BLE events */
-        ss->svc.read_req  = handle_read_req;
-        ss->svc.cleanup   = cleanup;
-        ss->cb = cb;
+        ble_gatts_add_characteristic(&config_uuid, GATT_PROP_READ | GATT_PROP_WRITE, ATT_PERM_RW,
+                                SENSORS_CHAR_COUNT * SENSORS_CONFIG_LEN, 0, NULL, &value_h);
 
+        ble_gatts_add_descriptor(&cud_uuid, ATT_PERM_READ, sizeof(config_description) - 1, 0, &cud_h);
 
-        /*
-         * 0 --> Number of Included Services
-         * 2 --> Number of Characteristic Declarations
-         * 2 --> Number of Descriptors
-         */
-        num_attr = ble_gatts_get_num_attr(0, 2, 2);
+        OS_ASSERT(value_h == CONFIG_OFFSET(CONFIG_ATTR_VALUE));
+        OS_ASSERT(cud_h == CONFIG_OFFSET(CONFIG_ATTR_CUD));
+}
 
+/* Snapshot of all sensors: declaration, value and CUD, in the order of SNAPSHOT_ATTR_* */
+static void add_snapshot_characteristic(void)
+{
+        uint16_t value_h;
+        uint16_t cud_h;
 
-        /* Service declaration */
-        ble_uuid_from_string("00000000-1111-2222-2222-333333333333", &uuid);
-        ble_gatts_add_service(&uuid, GATT_SERVICE_PRIMARY, num_attr);
+        ble_gatts_add_characteristic(&snapshot_uuid, GATT_PROP_READ, ATT_PERM_READ,
+                                                SENSOR_SNAPSHOT_LEN, 0, NULL, &value_h);
+
+        ble_gatts_add_descriptor(&cud_uuid, ATT_PERM_READ, sizeof(snapshot_description) - 1, 0, &cud_h);
+
+        OS_ASSERT(value_h == SNAPSHOT_OFFSET(SNAPSHOT_ATTR_VALUE));
+        OS_ASSERT(cud_h == SNAPSHOT_OFFSET(SNAPSHOT_ATTR_CUD));
+}
+
+void sensors_set_snapshot(ble_service_t *svc, const uint8_t *snapshot)
+{
+        ble_gatts_set_value(svc->start_h + SNAPSHOT_OFFSET(SNAPSHOT_ATTR_VALUE), SENSOR_SNAPSHOT_LEN,
+                                                                                snapshot);
+}
+
+#if CFG_STACK_MONITOR
+/* Stack usage: declaration, value and CUD, in the order of STACK_ATTR_* */
+static void add_stack_characteristic(void)
+{
+        uint16_t value_h;
+        uint16_t cud_h;
+
+        ble_gatts_add_characteristic(&stack_uuid, GATT_PROP_READ, ATT_PERM_READ,
+                                                STACK_MONITOR_PDU_LEN, 0, NULL, &value_h);
 
+        ble_gatts_add_descriptor(&cud_uuid, ATT_PERM_READ, sizeof(stack_description) - 1, 0, &cud_h);
 
-        /* Characteristic declaration for Temperature sensor*/
-        ble_uuid_from_string("11111111-0000-0000-0000-111111111111", &uuid);
-        ble_gatts_add_characteristic(&uuid, GATT_PROP_READ,  ATT_PERM_READ, 
-                            1, GATTS_FLAG_CHAR_READ_REQ, NULL, &ss->temp_int_value_h);
+        OS_ASSERT(value_h == STACK_OFFSET(STACK_ATTR_VALUE));
+        OS_ASSERT(cud_h == STACK_OFFSET(STACK_ATTR_CUD));
+}
+
+void sensors_set_stack_usage(ble_service_t *svc, const uint8_t *pdu)
+{
+        ble_gatts_set_value(svc->start_h + STACK_OFFSET(STACK_ATTR_VALUE), STACK_MONITOR_PDU_LEN, pdu);
+}
+#endif
+
+/* Initialization function for My Custom Service (sensors).*/
+ble_service_t *sensors_init(const sensors_service_cb_t *cb)
+{
+        sensors_service_t *ss = &sensors_service;
+        int ch;
+
+        /* Subscriptions are kept as one bit per characteristic */
+        OS_ASSERT(SENSORS_CHAR_COUNT <= CONN_MAX_CHARS);
 
+        memset(ss, 0, sizeof(*ss));
+        ConnTableInit();
 
-       /* Define descriptor of type Characteristic User Description (CUD) */
-        ble_uuid_create16(UUID_GATT_CHAR_USER_DESCRIPTION, &uuid);
-        ble_gatts_add_descriptor(&uuid, ATT_PERM_READ, sizeof(temp_user_descriptor_val),
-                                                              0, &temp_char_user_descriptor_h);
 
-        /* Characteristic declaration for accelerometer */
-        ble_uuid_from_string("22222222-0000-0000-0000-222222222222", &uuid);
-        ble_gatts_add_characteristic(&uuid, GATT_PROP_READ,  ATT_PERM_READ, 
-                            1, GATTS_FLAG_CHAR_READ_REQ, NULL, &ss->acc_int_value_h);
+        /* Declare handlers for specific BLE events */
+        ss->svc.connected_evt    = handle_connected_evt;
+        ss->svc.disconnected_evt = handle_disconnected_evt;
+        ss->svc.read_req         = handle_read_req;
+        ss->svc.write_req        = handle_write_req;
+        ss->svc.event_sent       = handle_event_sent;
+        ss->svc.cleanup          = cleanup;
+        ss->cb = cb;
 
 
-       /* Define descriptor of type Characteristic User Description (CUD) */
-        ble_uuid_create16(UUID_GATT_CHAR_USER_DESCRIPTION, &uuid);
-        ble_gatts_add_descriptor(&uuid, ATT_PERM_READ, sizeof(acc_user_descriptor_val),
-                                                              0, &acc_char_user_descriptor_h);
+        /* Service declaration */
+        ble_gatts_add_service(&service_uuid, GATT_SERVICE_PRIMARY, SENSORS_NUM_ATTR);
+
+        for (ch = 0; ch < SENSORS_CHAR_COUNT; ch++) {
+                add_characteristic(ch);
+        }
+        add_rate_characteristic();
+        add_config_characteristic();
+        add_snapshot_characteristic();
+#if CFG_STACK_MONITOR
+        add_stack_characteristic();
+#endif
 
         /*
-         * Register all the attribute handles so that they can be updated
-         * by the BLE manager automatically.
+         * Only the start handle needs updating, all others are derived from it.
          */
-        ble_gatts_register_service(&ss->svc.start_h, &ss->temp_int_value_h, &ss->acc_int_value_h,
-                          &temp_char_user_descriptor_h, &acc_char_user_descriptor_h ,0);
+        ble_gatts_register_service(&ss->svc.start_h, 0);
 
 
         /* Calculate the last attribute handle of the BLE service */
-        ss->svc.end_h = ss->svc.start_h + num_attr;
+        ss->svc.end_h = ss->svc.start_h + SENSORS_NUM_ATTR;
 
         /* Set default attribute values */
-        const uint8_t initial_value = 0;
-        ble_gatts_set_value(ss->temp_int_value_h, 1,  &initial_value);
-        ble_gatts_set_value(ss->acc_int_value_h, 1, &initial_value);
-        ble_gatts_set_value(temp_char_user_descriptor_h,  sizeof(temp_user_descriptor_val),
-                                                               temp_user_descriptor_val);
-        ble_gatts_set_value(acc_char_user_descriptor_h,  sizeof(acc_user_descriptor_val),
-                                                               acc_user_descriptor_val);
+        for (ch = 0; ch < SENSORS_CHAR_COUNT; ch++) {
+                const uint8_t initial_value = 0;
+
+                ble_gatts_set_value(attr_handle(ss, ch, ATTR_VALUE), 1, &initial_value);
+                ble_gatts_set_value(attr_handle(ss, ch, ATTR_CUD), char_table[ch].description_len,
+                                                                        char_table[ch].description);
+        }
+        ble_gatts_set_value(ss->svc.start_h + RATE_OFFSET(RATE_ATTR_CUD), sizeof(rate_description) - 1,
+                                                                                rate_description);
+        ble_gatts_set_value(ss->svc.start_h + CONFIG_OFFSET(CONFIG_ATTR_CUD),
+                                        sizeof(config_description) - 1, config_description);
+        for (ch = 0; ch < SENSORS_CHAR_COUNT; ch++) {
+                sensors_set_config(&ss->svc, ch, &ss->config[ch]);
+        }
+        ble_gatts_set_value(ss->svc.start_h + SNAPSHOT_OFFSET(SNAPSHOT_ATTR_CUD),
+                                        sizeof(snapshot_description) - 1, snapshot_description);
+#if CFG_STACK_MONITOR
+        ble_gatts_set_value(ss->svc.start_h + STACK_OFFSET(STACK_ATTR_CUD),
+                                        sizeof(stack_description) - 1, stack_description);
+#endif
 
         /* Register the BLE service in BLE framework */
         ble_service_add(&ss->svc);
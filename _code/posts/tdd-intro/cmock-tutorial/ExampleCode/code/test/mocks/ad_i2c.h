@@ -7,9 +7,13 @@
 #include <stdint.h>
 
 typedef uint16_t i2c_device;
+typedef uint16_t HW_I2C_ABORT_SOURCE;
+typedef void (*ad_i2c_user_cb)(void *user_data, HW_I2C_ABORT_SOURCE error);
 
 i2c_device ad_i2c_open(i2c_device dev);
 void ad_i2c_transact(i2c_device dev, const uint8_t *reg, size_t reg_size, uint8_t *res, size_t res_size );
+void ad_i2c_async_transact(i2c_device dev, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen,
+                           ad_i2c_user_cb cb, void *user_data);
 void ad_i2c_close(i2c_device dev);
 
 
@@ -23,7 +23,11 @@ void xTaskCreate(const char* name, TaskFunction_t task_func,
         TaskHandle_t task_handle);
 
 void xTaskNotify( TaskHandle_t handle, uint32_t value, eNotifyAction eAction);
+BaseType_t xTaskNotifyFromISR( TaskHandle_t handle, uint32_t value, eNotifyAction eAction);
 BaseType_t xTaskNotifyWait( uint32_t, uint32_t, uint32_t *, TickType_t );
+TickType_t xTaskGetTickCount( void );
+void vPortEnterCritical( void );
+void vPortExitCritical( void );
 
 #define portMAX_DELAY                   ( TickType_t )0xffff
 #define configASSERT( x )
@@ -34,6 +38,13 @@ BaseType_t xTaskNotifyWait( uint32_t, uint32_t, uint32_t *, TickType_t );
 #define OS_TASK_PRIORITY_NORMAL 2
 #define OS_TASK_NOTIFY_FOREVER  portMAX_DELAY
 #define OS_NOTIFY_SET_BITS      eSetBits
+#define OS_TICK_TIME            TickType_t
+
+#define OS_GET_TICK_COUNT()     xTaskGetTickCount()
+#define OS_MS_2_TICKS(ms)       ( (TickType_t)(ms) )
+
+#define OS_ENTER_CRITICAL_SECTION()     vPortEnterCritical()
+#define OS_LEAVE_CRITICAL_SECTION()     vPortExitCritical()
 
 
 #define OS_TASK_NOTIFY_WAIT(entry_bits, exit_bits, value, ticks_to_wait) \
@@ -45,6 +56,8 @@ BaseType_t xTaskNotifyWait( uint32_t, uint32_t, uint32_t *, TickType_t );
             (priority), (task))
 
 #define OS_TASK_NOTIFY(task, value, action) xTaskNotify((task), (value), (action))
+#define OS_TASK_NOTIFY_FROM_ISR(task, value, action) \
+                                xTaskNotifyFromISR((task), (value), (action))
 
 
 #endif  /* _OSAL_H*/
@@ -3,6 +3,9 @@
 #include "mock_ad_i2c.h"
 #include "mock_osal.h"
 #include "mock_platform_devices.h"
+#include "mock_ActivityClassifier.h"
+#include "mock_SensorExecutor.h"
+#include "SampleBatch.h"
 #include "AccelerometerDriver.h"
 
 // Just to satisfy the linker, never used in testing
@@ -51,3 +54,115 @@ void test_ConcatenateBytes(void)
 
     TEST_ASSERT_EQUAL_HEX16( 0xDEAD, Result);
 }
+
+void test_MotionSwitchesToActiveAndRearmsIdleTimer(void)
+{
+    OS_TICK_TIME last_motion = 0;
+
+    TEST_ASSERT_EQUAL(ACC_MODE_ACTIVE, NextPowerMode(ACC_MODE_IDLE, true, 500, &last_motion));
+    TEST_ASSERT_EQUAL_UINT16(500, last_motion);
+}
+
+void test_StaysActiveUntilIdleTimeoutExpires(void)
+{
+    OS_TICK_TIME last_motion = 100;
+
+    TEST_ASSERT_EQUAL(ACC_MODE_ACTIVE,
+            NextPowerMode(ACC_MODE_ACTIVE, false, 100 + ACC_IDLE_TIMEOUT_MS - 1, &last_motion));
+    TEST_ASSERT_EQUAL(ACC_MODE_IDLE,
+            NextPowerMode(ACC_MODE_ACTIVE, false, 100 + ACC_IDLE_TIMEOUT_MS, &last_motion));
+}
+
+void test_IdleTimeoutSurvivesTickWrapAround(void)
+{
+    OS_TICK_TIME last_motion = (OS_TICK_TIME)-10;
+
+    TEST_ASSERT_EQUAL(ACC_MODE_ACTIVE, NextPowerMode(ACC_MODE_ACTIVE, false, 10, &last_motion));
+}
+
+void test_WriteRegisterSendsAddressAndValueInOneFrame(void)
+{
+    uint16_t dev = 0;
+    const uint8_t frame[] = {0x20, 0xC0};
+    uint8_t dummy;
+
+    ad_i2c_transact_Expect(dev, frame, sizeof(frame), &dummy, sizeof(dummy));
+    ad_i2c_transact_IgnoreArg_res();
+
+    WriteI2CRegister(dev, 0x20, 0xC0);
+}
+
+void test_ActiveOdrReplacesUpperNibbleOnly(void)
+{
+    TEST_ASSERT_EQUAL_HEX8(0x50 | (ACC_ACTIVE_CTRL1 & 0x0F), ActiveCtrl1(0x5));
+}
+
+void test_FifoSamplesAreSpreadUpToTheDrainTime(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(1025, FifoSampleTime(1000, 1100, 0, 4));
+    TEST_ASSERT_EQUAL_UINT32(1100, FifoSampleTime(1000, 1100, 3, 4));
+}
+
+void test_FifoSampleTimeSurvivesTickWrapAround(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(10, FifoSampleTime((SensorTime_t)-10, 10, 1, 2));
+}
+
+void test_SamplesPerPeriodRoundsUp(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(100, SamplesPerPeriod(ACC_ACTIVE_CTRL1 >> 4, 1000));
+    TEST_ASSERT_EQUAL_UINT32(13, SamplesPerPeriod(0x9, 1000));
+    TEST_ASSERT_EQUAL_UINT32(1, SamplesPerPeriod(ACC_IDLE_CTRL1 >> 4, 1));
+}
+
+void test_ConfigureRejectsPeriodsTheWatermarkCannotHold(void)
+{
+    AccelerometerConfig_t too_long = { ACC_ACTIVE_CTRL1 >> 4, ACC_FIFO_MAX_WATERMARK, 1000 };
+    AccelerometerConfig_t too_many = { 0x9, ACC_FIFO_MAX_WATERMARK + 1, 1000 };
+
+    TEST_ASSERT_FALSE(i2c_acc_configure(&too_long));
+    TEST_ASSERT_FALSE(i2c_acc_configure(&too_many));
+}
+
+static AccelerometerMode_t reported_mode = ACC_MODE_ACTIVE;
+
+static void RecordMode(AccelerometerMode_t mode)
+{
+    reported_mode = mode;
+}
+
+void test_GoingIdleRestartsTheActivityWindow(void)
+{
+    SensorThread_t t = { 0 };
+    uint16_t dev = 0;
+    uint8_t no_motion = 0;
+
+    i2c_acc_register_mode_cb(RecordMode);
+    SensorThreadTakeBus_IgnoreAndReturn(true);
+    SensorThreadGiveBus_Ignore();
+    ad_i2c_open_IgnoreAndReturn(dev);
+    ad_i2c_close_Ignore();
+
+    // no wake-up event for the whole idle timeout
+    SensorThreadTakeEvents_ExpectAndReturn(&t, 0, 1 << 1);
+    SensorThreadTakeEvents_IgnoreArg_mask();
+    ad_i2c_transact_Expect(dev, NULL, 1, &no_motion, sizeof(no_motion));
+    ad_i2c_transact_IgnoreArg_reg();
+    ad_i2c_transact_IgnoreArg_res();
+    ad_i2c_transact_ReturnThruPtr_res(&no_motion);
+    xTaskGetTickCount_ExpectAndReturn(ACC_IDLE_TIMEOUT_MS);
+
+    // CTRL1 goes to the idle rate, the half filled window is dropped before anyone is told
+    ad_i2c_transact_Expect(dev, NULL, 2, NULL, 1);
+    ad_i2c_transact_IgnoreArg_reg();
+    ad_i2c_transact_IgnoreArg_res();
+    ActivityClassifierIdle_Expect();
+
+    // nothing is sampled while idle, the thread waits for the next event
+    SensorThreadTakeEvents_ExpectAndReturn(&t, 0, 0);
+    SensorThreadTakeEvents_IgnoreArg_mask();
+
+    TEST_ASSERT_EQUAL(CO_WAITING, AccelerometerThread(&t));
+    TEST_ASSERT_EQUAL(ACC_MODE_IDLE, reported_mode);
+    TEST_ASSERT_EQUAL(ACC_MODE_IDLE, i2c_acc_get_mode());
+}
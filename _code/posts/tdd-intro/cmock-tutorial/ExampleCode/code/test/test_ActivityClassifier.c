@@ -0,0 +1,99 @@
+#include "unity.h"
+#include "cmock.h"
+#include "mock_platform_devices.h"
+#include "Int8Engine.h"
+#include "ActivityClassifier.h"
+
+// Just to satisfy the linker, never used in testing
+uint8_t CurrentActivityLabel = 0;
+
+static ActivityWindow_t window;
+
+/* 1 g on Z plus a periodic component on X, in model units (64 LSB/g) */
+static void FillWindow(const int8_t *pattern, int pattern_len)
+{
+    int t;
+
+    for (t = 0; t < ACTIVITY_WINDOW_LEN; t++) {
+        window[t][0] = pattern[t % pattern_len];
+        window[t][1] = 0;
+        window[t][2] = 64;
+    }
+}
+
+void setUp(void)
+{
+    ActivityClassifierInit();
+}
+
+void tearDown()
+{
+}
+
+void test_QuantizeAxisScalesRawSamplesTo64LsbPerG(void)
+{
+    TEST_ASSERT_EQUAL_INT8(64, QuantizeAxis(16384));
+    TEST_ASSERT_EQUAL_INT8(-64, QuantizeAxis(-16384));
+    TEST_ASSERT_EQUAL_INT8(127, QuantizeAxis(32767));
+}
+
+void test_StillWindowIsIdle(void)
+{
+    const int8_t still[] = { 0 };
+
+    FillWindow(still, sizeof(still));
+
+    TEST_ASSERT_EQUAL(ACTIVITY_IDLE, ActivityClassifierRun(window));
+}
+
+void test_SlowSwingIsWalking(void)
+{
+    // ~0.5 g swing with a 24 sample period
+    const int8_t swing[] = { 0, 8, 16, 23, 28, 31, 32, 31, 28, 23, 16, 8,
+                             0, -8, -16, -23, -28, -31, -32, -31, -28, -23, -16, -8 };
+
+    FillWindow(swing, sizeof(swing));
+
+    TEST_ASSERT_EQUAL(ACTIVITY_WALKING, ActivityClassifierRun(window));
+}
+
+void test_FastAlternationIsVibrating(void)
+{
+    const int8_t buzz[] = { 12, -12 };
+
+    FillWindow(buzz, sizeof(buzz));
+
+    TEST_ASSERT_EQUAL(ACTIVITY_VIBRATING, ActivityClassifierRun(window));
+}
+
+void test_LabelIsPublishedOncePerFullWindow(void)
+{
+    int t;
+
+    TEST_ASSERT_EQUAL_HEX8(ACTIVITY_UNKNOWN, CurrentActivityLabel);
+
+    for (t = 0; t < ACTIVITY_WINDOW_LEN - 1; t++) {
+        TEST_ASSERT_FALSE(ActivityClassifierAddSample(0, 0, 16384));
+    }
+    TEST_ASSERT_TRUE(ActivityClassifierAddSample(0, 0, 16384));
+
+    TEST_ASSERT_EQUAL_HEX8(ACTIVITY_IDLE, CurrentActivityLabel);
+    TEST_ASSERT_GREATER_OR_EQUAL(sizeof(ActivityConvOut_t), ActivityClassifierArenaHighWater());
+}
+
+void test_GoingIdleDropsThePartialWindow(void)
+{
+    int t;
+
+    for (t = 0; t < ACTIVITY_WINDOW_LEN - 1; t++) {
+        TEST_ASSERT_FALSE(ActivityClassifierAddSample(0, 0, 16384));
+    }
+
+    ActivityClassifierIdle();
+    TEST_ASSERT_EQUAL_HEX8(ACTIVITY_IDLE, CurrentActivityLabel);
+
+    /* What was collected before the gap does not complete a window after it */
+    CurrentActivityLabel = ACTIVITY_UNKNOWN;
+    TEST_ASSERT_FALSE(ActivityClassifierAddSample(0, 0, 16384));
+    TEST_ASSERT_EQUAL_HEX8(ACTIVITY_UNKNOWN, CurrentActivityLabel);
+}
@@ -0,0 +1,48 @@
+#include "unity.h"
+#include "cmock.h"
+#include "AdvTelemetry.h"
+
+static uint8_t ad[ADV_TELEMETRY_LEN];
+
+void setUp(void)
+{
+    AdvTelemetryInit(ad, 0x00D2);
+}
+
+void tearDown()
+{
+}
+
+void test_InitWritesManufacturerHeader(void)
+{
+    const uint8_t expected[6] = { ADV_TELEMETRY_LEN - 1, 0xFF, 0xD2, 0x00, ADV_TELEMETRY_VERSION, 0 };
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, ad, sizeof(expected));
+}
+
+void test_ValuesAreStoredLittleEndian(void)
+{
+    const int16_t acc[3] = { 1, -1, 0x1234 };
+    const uint8_t expected[9] = { 0xFE, 0xFF, 0x01, 0x00, 0xFF, 0xFF, 0x34, 0x12, 3 };
+
+    AdvTelemetrySetTemperature(ad, -2);
+    AdvTelemetrySetAcceleration(ad, acc);
+    AdvTelemetrySetActivity(ad, 3);
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &ad[6], sizeof(expected));
+}
+
+void test_EveryUpdateBumpsSequence(void)
+{
+    const int16_t acc[3] = { 0, 0, 0 };
+    int i;
+
+    AdvTelemetrySetTemperature(ad, 0);
+    AdvTelemetrySetAcceleration(ad, acc);
+    TEST_ASSERT_EQUAL_UINT8(2, AdvTelemetrySequence(ad));
+
+    for (i = 0; i < 254; i++) {
+        AdvTelemetrySetActivity(ad, 0);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0, AdvTelemetrySequence(ad));
+}
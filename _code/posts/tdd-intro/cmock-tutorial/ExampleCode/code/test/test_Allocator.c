@@ -0,0 +1,111 @@
+#include "unity.h"
+#include "cmock.h"
+#include "EventPool.h"
+#include "Allocator.h"
+
+#define HEAP_LEN        (256)
+
+static const EventPoolClassConfig_t classes[] = { { 16, 1 } };
+
+static void *pool_memory[ALLOCATOR_POOL_BYTES(16, 1) / sizeof(void *)];
+static void *heap[HEAP_LEN / sizeof(void *)];
+static Allocator_t alloc;
+static AllocSite_t site_a = ALLOC_SITE_INIT("a");
+static AllocSite_t site_b = ALLOC_SITE_INIT("b");
+
+void setUp(void)
+{
+    site_a = (AllocSite_t) ALLOC_SITE_INIT("a");
+    site_b = (AllocSite_t) ALLOC_SITE_INIT("b");
+    TEST_ASSERT_TRUE(AllocatorInit(&alloc, pool_memory, sizeof(pool_memory), classes, 1,
+                                                                    heap, sizeof(heap)));
+}
+
+void tearDown()
+{
+}
+
+void test_SmallRequestsUseThePoolFirst(void)
+{
+    uint8_t *first = AllocatorAlloc(&alloc, 10, &site_a);
+    uint8_t *second = AllocatorAlloc(&alloc, 10, &site_a);
+
+    TEST_ASSERT_EQUAL_PTR((uint8_t *)pool_memory + ALLOCATOR_HEADER_SIZE, first);
+    TEST_ASSERT_TRUE(second >= (uint8_t *)heap && second < (uint8_t *)heap + HEAP_LEN);
+    TEST_ASSERT_EQUAL_UINT32(1, alloc.stats.from_heap);
+}
+
+void test_SitesTrackLiveBytesAndPeak(void)
+{
+    void *a = AllocatorAlloc(&alloc, 10, &site_a);
+    void *b = AllocatorAlloc(&alloc, 40, &site_b);
+
+    AllocatorAlloc(&alloc, 20, &site_a);
+    TEST_ASSERT_TRUE(AllocatorFree(&alloc, a));
+    TEST_ASSERT_TRUE(AllocatorFree(&alloc, b));
+
+    TEST_ASSERT_EQUAL_UINT32(20, site_a.live);
+    TEST_ASSERT_EQUAL_UINT32(30, site_a.peak);
+    TEST_ASSERT_EQUAL_UINT32(0, site_b.live);
+    TEST_ASSERT_EQUAL_UINT32(70, alloc.stats.peak);
+    TEST_ASSERT_EQUAL_PTR(&site_b, alloc.sites);
+    TEST_ASSERT_EQUAL_PTR(&site_a, alloc.sites->next);
+}
+
+void test_FailuresAreCountedPerSite(void)
+{
+    TEST_ASSERT_NULL(AllocatorAlloc(&alloc, HEAP_LEN, &site_b));
+
+    TEST_ASSERT_EQUAL_UINT32(1, site_b.failed);
+    TEST_ASSERT_EQUAL_UINT32(1, alloc.stats.failed);
+    TEST_ASSERT_EQUAL_UINT32(0, alloc.stats.live);
+}
+
+void test_FreedNeighboursMergeIntoLargestBlock(void)
+{
+    size_t free, largest, initial;
+    void *a, *b, *c;
+
+    AllocatorHeapInfo(&alloc, &free, &initial);
+    AllocatorAlloc(&alloc, 16, &site_a);        // takes the pool block
+    a = AllocatorAlloc(&alloc, 40, &site_a);
+    b = AllocatorAlloc(&alloc, 40, &site_a);
+    c = AllocatorAlloc(&alloc, 40, &site_a);
+
+    AllocatorFree(&alloc, a);
+    AllocatorFree(&alloc, c);
+    AllocatorHeapInfo(&alloc, &free, &largest);
+    TEST_ASSERT_TRUE(largest < initial - 40);
+
+    AllocatorFree(&alloc, b);
+    AllocatorHeapInfo(&alloc, &free, &largest);
+    TEST_ASSERT_EQUAL_UINT32(initial, largest);
+}
+
+void test_ForeignBuffersAreNotTaken(void)
+{
+    void *other[4] = { 0 };
+
+    TEST_ASSERT_FALSE(AllocatorFree(&alloc, &other[3]));
+}
+
+void test_StrayAndDoubleFreesAreRefused(void)
+{
+    uint8_t *pooled, *a, *b;
+
+    pooled = AllocatorAlloc(&alloc, 16, &site_a);
+    a = AllocatorAlloc(&alloc, 40, &site_a);
+    b = AllocatorAlloc(&alloc, 40, &site_a);
+
+    TEST_ASSERT_FALSE(AllocatorFree(&alloc, a + sizeof(void *)));
+    TEST_ASSERT_TRUE(AllocatorFree(&alloc, a));
+    TEST_ASSERT_FALSE(AllocatorFree(&alloc, a));
+    TEST_ASSERT_EQUAL_UINT32(16 + 40, site_a.live);
+
+    TEST_ASSERT_TRUE(AllocatorFree(&alloc, pooled));
+    TEST_ASSERT_FALSE(AllocatorFree(&alloc, pooled));
+    TEST_ASSERT_EQUAL_UINT32(40, site_a.live);
+    TEST_ASSERT_EQUAL_UINT16(0, alloc.pool.cls[0].stats.in_use);
+
+    TEST_ASSERT_TRUE(AllocatorFree(&alloc, b));
+}
@@ -0,0 +1,102 @@
+#include "unity.h"
+#include "cmock.h"
+#include "ConnParamManager.h"
+
+#define FAST_INTERVAL   (12)    // 15 ms
+#define SLOW_INTERVAL   (400)   // 500 ms
+#define BUSY_BYTES      (100)
+#define IDLE_MS         (5000)
+
+static const ConnParamConfig_t config = {
+    .busy_bytes = BUSY_BYTES,
+    .idle_ms = IDLE_MS,
+    .throughput_interval_max = FAST_INTERVAL,
+};
+
+void setUp(void)
+{
+    ConnParamInit(&config);
+}
+
+void tearDown()
+{
+}
+
+void test_NewSlowLinkAsksForThroughput(void)
+{
+    ConnProfile_t request;
+
+    ConnParamOpen(0, 0, SLOW_INTERVAL, 0);
+
+    TEST_ASSERT_TRUE(ConnParamPoll(0, 1000, 0, false, &request));
+    TEST_ASSERT_EQUAL(CONN_PROFILE_THROUGHPUT, request);
+    TEST_ASSERT_FALSE(ConnParamPoll(0, 2000, 0, false, &request));
+}
+
+void test_QuietLinkFallsBackToLowPower(void)
+{
+    ConnProfile_t request;
+
+    ConnParamOpen(0, 0, FAST_INTERVAL, 0);
+
+    TEST_ASSERT_FALSE(ConnParamPoll(0, 1000, BUSY_BYTES, false, &request));
+    TEST_ASSERT_FALSE(ConnParamPoll(0, 1000 + IDLE_MS - 1, BUSY_BYTES - 1, false, &request));
+    TEST_ASSERT_TRUE(ConnParamPoll(0, 1000 + IDLE_MS, 0, false, &request));
+    TEST_ASSERT_EQUAL(CONN_PROFILE_LOW_POWER, request);
+}
+
+void test_BulkTransferKeepsLinkBusy(void)
+{
+    ConnProfile_t request;
+
+    ConnParamOpen(0, 0, FAST_INTERVAL, 0);
+
+    TEST_ASSERT_FALSE(ConnParamPoll(0, IDLE_MS, 0, true, &request));
+    TEST_ASSERT_FALSE(ConnParamPoll(0, 2 * IDLE_MS - 1, 0, false, &request));
+}
+
+void test_StatsFollowAppliedParameters(void)
+{
+    ConnProfileStats_t stats;
+    ConnProfile_t request;
+
+    ConnParamOpen(0, 0, FAST_INTERVAL, 0);
+    ConnParamPoll(0, 1500, 3000, false, &request);
+    ConnParamApplied(0, 3000, SLOW_INTERVAL, 4);
+    ConnParamClose(0, 8000);
+
+    ConnParamGetStats(CONN_PROFILE_THROUGHPUT, &stats);
+    TEST_ASSERT_EQUAL_UINT32(3000, stats.time_ms);
+    TEST_ASSERT_EQUAL_UINT32(3000, stats.bytes);
+    TEST_ASSERT_EQUAL_UINT32(200, stats.events);
+    TEST_ASSERT_EQUAL_UINT32(1000, ConnParamThroughput(&stats));
+
+    ConnParamGetStats(CONN_PROFILE_LOW_POWER, &stats);
+    TEST_ASSERT_EQUAL_UINT32(5000, stats.time_ms);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.events);
+}
+
+void test_PollsShorterThanAnEventStillCountIt(void)
+{
+    ConnProfileStats_t stats;
+    ConnProfile_t request;
+    uint32_t now;
+
+    // an event every 2.5 s, polled every second
+    ConnParamOpen(0, 0, SLOW_INTERVAL, 4);
+    for (now = 1000; now <= 10000; now += 1000) {
+        ConnParamPoll(0, now, 0, false, &request);
+    }
+
+    ConnParamGetStats(CONN_PROFILE_LOW_POWER, &stats);
+    TEST_ASSERT_EQUAL_UINT32(10000, stats.time_ms);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.events);
+}
+
+void test_AverageCurrentAddsEventCharge(void)
+{
+    ConnProfileStats_t stats = { .time_ms = 1000, .bytes = 0, .events = 100 };
+
+    // 100 events of 2 uC in one second on top of 10 uA sleep current
+    TEST_ASSERT_EQUAL_UINT32(210, ConnParamAverageCurrent(&stats, 2000, 10));
+}
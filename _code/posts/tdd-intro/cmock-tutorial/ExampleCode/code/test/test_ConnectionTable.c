@@ -0,0 +1,122 @@
+#include "unity.h"
+#include "cmock.h"
+#include "ConnectionTable.h"
+
+#define CH_TEMP     (0)
+#define CH_ACC      (1)
+
+void setUp(void)
+{
+    ConnTableInit();
+}
+
+void tearDown()
+{
+}
+
+void test_RecordsAreFoundByConnectionIndex(void)
+{
+    ConnRecord_t *a = ConnTableAdd(3, 247, 251);
+    ConnRecord_t *b = ConnTableAdd(7, 23, 27);
+
+    TEST_ASSERT_EQUAL_PTR(a, ConnTableFind(3));
+    TEST_ASSERT_EQUAL_PTR(b, ConnTableFind(7));
+    TEST_ASSERT_EQUAL_UINT16(23, ConnTableFind(7)->mtu);
+    TEST_ASSERT_EQUAL_UINT8(2, ConnTableCount());
+
+    ConnTableRemove(3);
+    TEST_ASSERT_NULL(ConnTableFind(3));
+    TEST_ASSERT_EQUAL_UINT8(1, ConnTableCount());
+}
+
+void test_TableRejectsConnectionsWhenFull(void)
+{
+    int i;
+
+    for (i = 0; i < CONN_MAX; i++) {
+        TEST_ASSERT_NOT_NULL(ConnTableAdd(i, 23, 27));
+    }
+
+    TEST_ASSERT_NULL(ConnTableAdd(CONN_MAX, 23, 27));
+}
+
+void test_OnlySubscribedCharacteristicsAreSent(void)
+{
+    ConnRecord_t *rec = ConnTableAdd(0, 23, 27);
+
+    ConnSetCcc(rec, CH_ACC, CONN_CCC_NOTIFY);
+
+    TEST_ASSERT_FALSE(ConnTakeUpdate(rec, CH_TEMP));
+    TEST_ASSERT_TRUE(ConnTakeUpdate(rec, CH_ACC));
+    TEST_ASSERT_EQUAL_HEX16(CONN_CCC_NOTIFY, ConnGetCcc(rec, CH_ACC));
+
+    ConnSetCcc(rec, CH_ACC, 0);
+    TEST_ASSERT_FALSE(ConnIsSubscribed(rec, CH_ACC));
+}
+
+void test_DecimationSendsEveryNthUpdate(void)
+{
+    ConnRecord_t *rec = ConnTableAdd(0, 23, 27);
+    int sent = 0;
+    int i;
+
+    ConnSetCcc(rec, CH_ACC, CONN_CCC_NOTIFY);
+    ConnSetDecimation(rec, CH_ACC, 3);
+
+    for (i = 0; i < 9; i++) {
+        if (ConnTakeUpdate(rec, CH_ACC)) {
+            sent++;
+            ConnReturnCredit(rec);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(3, sent);
+    TEST_ASSERT_EQUAL_UINT32(6, rec->decimated);
+}
+
+void test_UpdatesStopWhenCreditsRunOut(void)
+{
+    ConnRecord_t *rec = ConnTableAdd(0, 23, 27);
+    int i;
+
+    ConnSetCcc(rec, CH_TEMP, CONN_CCC_INDICATE);
+
+    for (i = 0; i < CONN_TX_CREDITS; i++) {
+        TEST_ASSERT_TRUE(ConnTakeUpdate(rec, CH_TEMP));
+    }
+    TEST_ASSERT_FALSE(ConnTakeUpdate(rec, CH_TEMP));
+    TEST_ASSERT_EQUAL_UINT32(1, rec->no_credit);
+
+    ConnReturnCredit(rec);
+    TEST_ASSERT_TRUE(ConnTakeUpdate(rec, CH_TEMP));
+}
+
+void test_SentBytesAreTakenOnce(void)
+{
+    ConnRecord_t *rec = ConnTableAdd(0, 23, 27);
+
+    rec->bytes += 20;
+    rec->bytes += 5;
+
+    TEST_ASSERT_EQUAL_UINT32(25, ConnTakeBytes(rec));
+    TEST_ASSERT_EQUAL_UINT32(0, ConnTakeBytes(rec));
+}
+
+void test_DueFollowsTheDecimationCountdown(void)
+{
+    ConnRecord_t *rec = ConnTableAdd(0, 23, 27);
+
+    TEST_ASSERT_FALSE(ConnIsDue(rec, CH_ACC));
+
+    ConnSetCcc(rec, CH_ACC, CONN_CCC_NOTIFY);
+    ConnSetDecimation(rec, CH_ACC, 2);
+    TEST_ASSERT_TRUE(ConnIsDue(rec, CH_ACC));
+
+    TEST_ASSERT_TRUE(ConnTakeUpdate(rec, CH_ACC));
+    TEST_ASSERT_FALSE(ConnIsDue(rec, CH_ACC));
+
+    // credits do not matter, the update is for the central once the countdown ran out
+    rec->tx_credits = 0;
+    TEST_ASSERT_FALSE(ConnTakeUpdate(rec, CH_ACC));
+    TEST_ASSERT_TRUE(ConnIsDue(rec, CH_ACC));
+}
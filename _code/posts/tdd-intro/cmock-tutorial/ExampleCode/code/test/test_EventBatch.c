@@ -0,0 +1,81 @@
+#include "unity.h"
+#include "cmock.h"
+#include "EventBatch.h"
+
+#define MAX_EVENTS  (4)
+#define BUDGET      (10)
+
+static EventBatch_t batch;
+
+/* Handle count events at the given time, as long as the batch lets us */
+static uint16_t Drain(uint16_t count, uint32_t now)
+{
+    uint16_t handled = 0;
+
+    EventBatchBegin(&batch, now);
+    while (handled < count && EventBatchNext(&batch, now)) {
+        EventBatchHandled(&batch);
+        handled++;
+    }
+    EventBatchEnd(&batch, handled < count);
+
+    return handled;
+}
+
+void setUp(void)
+{
+    EventBatchInit(&batch, MAX_EVENTS, BUDGET);
+}
+
+void tearDown()
+{
+}
+
+void test_BatchStopsAtMaxEvents(void)
+{
+    TEST_ASSERT_EQUAL_UINT16(MAX_EVENTS, Drain(10, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, batch.stats.cut_short);
+}
+
+void test_BatchStopsWhenBudgetIsSpent(void)
+{
+    EventBatchBegin(&batch, 0xFFFFFFF0);
+    EventBatchHandled(&batch);
+
+    TEST_ASSERT_TRUE(EventBatchNext(&batch, 0xFFFFFFF0 + BUDGET));
+    TEST_ASSERT_FALSE(EventBatchNext(&batch, 0xFFFFFFF0 + BUDGET + 1));
+}
+
+void test_FirstEventIsTakenEvenWithoutBudget(void)
+{
+    EventBatchInit(&batch, MAX_EVENTS, 0);
+
+    EventBatchBegin(&batch, 0);
+    TEST_ASSERT_TRUE(EventBatchNext(&batch, 100));
+}
+
+void test_BatchSizesGoIntoLog2Buckets(void)
+{
+    Drain(0, 0);
+    Drain(1, 0);
+    Drain(3, 0);
+    Drain(4, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(1, batch.stats.histogram[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, batch.stats.histogram[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, batch.stats.histogram[2]);
+    TEST_ASSERT_EQUAL_UINT32(1, batch.stats.histogram[3]);
+    TEST_ASSERT_EQUAL_UINT32(4, batch.stats.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(8, batch.stats.events);
+    TEST_ASSERT_EQUAL_UINT16(4, batch.stats.largest);
+}
+
+void test_HugeBatchesShareTheLastBucket(void)
+{
+    EventBatchInit(&batch, 1000, BUDGET);
+
+    Drain(100, 0);
+    Drain(999, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(2, batch.stats.histogram[EVENT_BATCH_BUCKETS - 1]);
+}
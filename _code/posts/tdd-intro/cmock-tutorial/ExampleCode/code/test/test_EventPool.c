@@ -0,0 +1,86 @@
+#include "unity.h"
+#include "cmock.h"
+#include "EventPool.h"
+
+static const EventPoolClassConfig_t classes[] = { { 16, 2 }, { 30, 1 } };
+
+static uint32_t memory[(16 * 2 + 32) / sizeof(uint32_t)];
+static EventPool_t pool;
+
+void setUp(void)
+{
+    TEST_ASSERT_TRUE(EventPoolInit(&pool, memory, sizeof(memory), classes, 2));
+}
+
+void tearDown()
+{
+}
+
+void test_InitRejectsShortMemoryAndUnorderedClasses(void)
+{
+    const EventPoolClassConfig_t unordered[] = { { 32, 1 }, { 16, 2 } };
+
+    TEST_ASSERT_FALSE(EventPoolInit(&pool, memory, sizeof(memory) - 1, classes, 2));
+    TEST_ASSERT_FALSE(EventPoolInit(&pool, memory, sizeof(memory), unordered, 2));
+}
+
+void test_RequestGoesToSmallestClassThatFits(void)
+{
+    uint8_t *small = EventPoolAlloc(&pool, 10);
+    uint8_t *big = EventPoolAlloc(&pool, 17);
+
+    TEST_ASSERT_EQUAL_PTR(memory, small);
+    TEST_ASSERT_EQUAL_PTR((uint8_t *)memory + 32, big);
+    TEST_ASSERT_EQUAL_UINT16(1, pool.cls[0].stats.in_use);
+    TEST_ASSERT_EQUAL_UINT16(1, pool.cls[1].stats.in_use);
+}
+
+void test_EmptyClassSpillsIntoBiggerOne(void)
+{
+    EventPoolAlloc(&pool, 16);
+    EventPoolAlloc(&pool, 16);
+
+    TEST_ASSERT_EQUAL_PTR((uint8_t *)memory + 32, EventPoolAlloc(&pool, 16));
+    TEST_ASSERT_EQUAL_UINT32(1, pool.cls[1].stats.spills);
+
+    TEST_ASSERT_NULL(EventPoolAlloc(&pool, 16));
+    TEST_ASSERT_EQUAL_UINT32(1, pool.cls[0].stats.exhausted);
+    TEST_ASSERT_NULL(EventPoolAlloc(&pool, 33));
+    TEST_ASSERT_EQUAL_UINT32(1, pool.too_big);
+}
+
+void test_FreedBlockIsReusedFirst(void)
+{
+    void *first = EventPoolAlloc(&pool, 8);
+    void *second = EventPoolAlloc(&pool, 8);
+
+    TEST_ASSERT_TRUE(EventPoolFree(&pool, first));
+    TEST_ASSERT_EQUAL_PTR(first, EventPoolAlloc(&pool, 8));
+    TEST_ASSERT_TRUE(EventPoolFree(&pool, second));
+    TEST_ASSERT_EQUAL_UINT16(1, pool.cls[0].stats.in_use);
+    TEST_ASSERT_EQUAL_UINT16(2, pool.cls[0].stats.peak);
+}
+
+void test_ForeignBuffersAreNotTaken(void)
+{
+    uint32_t other;
+
+    TEST_ASSERT_FALSE(EventPoolFree(&pool, &other));
+    TEST_ASSERT_FALSE(EventPoolFree(&pool, (uint8_t *)memory + 4));
+}
+
+void test_SecondFreeOfABlockIsRefused(void)
+{
+    void *first = EventPoolAlloc(&pool, 8);
+    void *second = EventPoolAlloc(&pool, 8);
+
+    TEST_ASSERT_TRUE(EventPoolFree(&pool, first));
+    TEST_ASSERT_FALSE(EventPoolFree(&pool, first));
+    TEST_ASSERT_FALSE(EventPoolFree(&pool, (uint8_t *)memory + 16 * 2));
+    TEST_ASSERT_EQUAL_UINT16(1, pool.cls[0].stats.in_use);
+
+    // on the free list once only, so the next request spills
+    TEST_ASSERT_EQUAL_PTR(first, EventPoolAlloc(&pool, 8));
+    TEST_ASSERT_EQUAL_PTR((uint8_t *)memory + 32, EventPoolAlloc(&pool, 8));
+    TEST_ASSERT_TRUE(EventPoolFree(&pool, second));
+}
@@ -0,0 +1,79 @@
+#include "unity.h"
+#include "cmock.h"
+#include "Int8Engine.h"
+
+void setUp(void)
+{
+}
+
+void tearDown()
+{
+}
+
+void test_ArenaAllocationsAreAlignedAndBounded(void)
+{
+    uint8_t buffer[16];
+    Int8Arena_t arena;
+    uint8_t *a, *b, *c;
+
+    Int8ArenaInit(&arena, buffer, sizeof(buffer));
+
+    a = Int8ArenaAlloc(&arena, 3);
+    b = Int8ArenaAlloc(&arena, 8);
+    c = Int8ArenaAlloc(&arena, 8);
+
+    TEST_ASSERT_TRUE(a == &buffer[0]);
+    TEST_ASSERT_TRUE(b == &buffer[4]);
+    TEST_ASSERT_NULL(c);
+    TEST_ASSERT_EQUAL(12, arena.high_water);
+
+    Int8ArenaReset(&arena);
+    TEST_ASSERT_TRUE(Int8ArenaAlloc(&arena, 16) == &buffer[0]);
+}
+
+void test_RequantizeRoundsAndSaturates(void)
+{
+    TEST_ASSERT_EQUAL_INT8(3, Int8Requantize(10, 2));
+    TEST_ASSERT_EQUAL_INT8(-3, Int8Requantize(-10, 2));
+    TEST_ASSERT_EQUAL_INT8(127, Int8Requantize(100000, 4));
+    TEST_ASSERT_EQUAL_INT8(-128, Int8Requantize(-100000, 4));
+}
+
+void test_DenseComputesBiasedDotProduct(void)
+{
+    const int8_t input[3] = { 1, 2, 3 };
+    const int8_t weights[2][3] = { { 1, 1, 1 }, { -4, 0, 0 } };
+    const int32_t bias[2] = { 4, 0 };
+    int8_t output[2];
+
+    Int8Dense(3, input, 2, weights, bias, 0, false, output);
+    TEST_ASSERT_EQUAL_INT8(10, output[0]);
+    TEST_ASSERT_EQUAL_INT8(-4, output[1]);
+
+    Int8Dense(3, input, 2, weights, bias, 0, true, output);
+    TEST_ASSERT_EQUAL_INT8(0, output[1]);
+}
+
+void test_Conv1dSlidesKernelWithStride(void)
+{
+    const int8_t input[5][2] = { { 1, 0 }, { 2, 0 }, { 3, 0 }, { 4, 0 }, { 5, 10 } };
+    const int8_t weights[1][3][2] = { { { 1, 0 }, { 1, 0 }, { 1, 1 } } };
+    int8_t output[INT8_CONV1D_OUT_LEN(5, 3, 2)][1];
+
+    Int8Conv1d(5, 2, input, 1, 3, 2, weights, NULL, 0, false, output);
+
+    TEST_ASSERT_EQUAL_INT8(6, output[0][0]);
+    TEST_ASSERT_EQUAL_INT8(22, output[1][0]);
+}
+
+void test_GlobalAvgPoolAndArgMax(void)
+{
+    const int8_t input[4][2] = { { 4, -8 }, { 4, 0 }, { 8, 0 }, { 0, 0 } };
+    int8_t pooled[2];
+
+    Int8GlobalAvgPool1d(4, 2, input, pooled);
+
+    TEST_ASSERT_EQUAL_INT8(4, pooled[0]);
+    TEST_ASSERT_EQUAL_INT8(-2, pooled[1]);
+    TEST_ASSERT_EQUAL(0, Int8ArgMax(2, pooled));
+}
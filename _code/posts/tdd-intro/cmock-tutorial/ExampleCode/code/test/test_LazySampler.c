@@ -0,0 +1,99 @@
+#include "unity.h"
+#include "cmock.h"
+#include "LazySampler.h"
+
+#define STALE_AFTER     (5000)
+
+static LazySampler_t sampler;
+static uint16_t waiting[LAZY_MAX_WAITERS];
+
+void setUp(void)
+{
+    LazySamplerInit(&sampler, STALE_AFTER);
+}
+
+void tearDown()
+{
+}
+
+void test_FirstReadStartsMeasurement(void)
+{
+    bool start;
+
+    TEST_ASSERT_EQUAL(LAZY_READ_DEFERRED, LazySamplerRead(&sampler, 0, 100, &start));
+    TEST_ASSERT_TRUE(start);
+}
+
+void test_ReadsWhileMeasuringShareOneSample(void)
+{
+    bool start;
+
+    LazySamplerRead(&sampler, 0, 100, &start);
+    TEST_ASSERT_EQUAL(LAZY_READ_DEFERRED, LazySamplerRead(&sampler, 1, 110, &start));
+    TEST_ASSERT_FALSE(start);
+
+    TEST_ASSERT_EQUAL_UINT8(2, LazySamplerSampled(&sampler, 120, waiting));
+    TEST_ASSERT_EQUAL_UINT16(0, waiting[0]);
+    TEST_ASSERT_EQUAL_UINT16(1, waiting[1]);
+}
+
+void test_FreshValueIsServedFromCache(void)
+{
+    bool start;
+
+    LazySamplerSampled(&sampler, 1000, waiting);
+
+    TEST_ASSERT_EQUAL(LAZY_READ_FRESH, LazySamplerRead(&sampler, 0, 1000 + STALE_AFTER - 1, &start));
+    TEST_ASSERT_FALSE(start);
+    TEST_ASSERT_EQUAL(LAZY_READ_DEFERRED, LazySamplerRead(&sampler, 0, 1000 + STALE_AFTER, &start));
+    TEST_ASSERT_TRUE(start);
+}
+
+void test_StalenessSurvivesTickWrap(void)
+{
+    bool start;
+
+    LazySamplerSampled(&sampler, 0xFFFFFF00, waiting);
+
+    TEST_ASSERT_EQUAL(LAZY_READ_FRESH, LazySamplerRead(&sampler, 0, 0x00000100, &start));
+}
+
+void test_ReadIsRejectedWhenNoRoomToPark(void)
+{
+    bool start;
+    int i;
+
+    for (i = 0; i < LAZY_MAX_WAITERS; i++) {
+        LazySamplerRead(&sampler, i, 0, &start);
+    }
+
+    TEST_ASSERT_EQUAL(LAZY_READ_REJECTED, LazySamplerRead(&sampler, 9, 0, &start));
+}
+
+void test_DropForgetsDisconnectedReader(void)
+{
+    bool start;
+
+    LazySamplerRead(&sampler, 3, 0, &start);
+    LazySamplerRead(&sampler, 5, 0, &start);
+    LazySamplerDrop(&sampler, 3);
+
+    TEST_ASSERT_EQUAL_UINT8(1, LazySamplerSampled(&sampler, 10, waiting));
+    TEST_ASSERT_EQUAL_UINT16(5, waiting[0]);
+}
+
+void test_FailedMeasurementHandsBackParkedReads(void)
+{
+    bool start;
+
+    LazySamplerRead(&sampler, 3, 0, &start);
+    LazySamplerRead(&sampler, 5, 0, &start);
+
+    TEST_ASSERT_EQUAL_UINT8(2, LazySamplerFailed(&sampler, waiting));
+    TEST_ASSERT_EQUAL_UINT16(3, waiting[0]);
+    TEST_ASSERT_EQUAL_UINT16(5, waiting[1]);
+
+    // nothing was cached, the next read measures again
+    TEST_ASSERT_EQUAL(LAZY_READ_DEFERRED, LazySamplerRead(&sampler, 3, 10, &start));
+    TEST_ASSERT_TRUE(start);
+}
@@ -0,0 +1,76 @@
+#include "unity.h"
+#include "cmock.h"
+#include "PoisonCheck.h"
+
+#define PATTERN         (0xDEADBEEF)
+
+static PoisonCheck_t chk;
+static uint32_t first[5];
+static uint32_t second[3];
+static const uint32_t *bad;
+
+void setUp(void)
+{
+    bad = NULL;
+    PoisonCheckInit(&chk, PATTERN, 3, 100);
+    PoisonCheckAddArea(&chk, first, 5);
+    PoisonCheckAddArea(&chk, second, 3);
+}
+
+void tearDown()
+{
+}
+
+void test_AddAreaFillsThePattern(void)
+{
+    const uint32_t expected[5] = { PATTERN, PATTERN, PATTERN, PATTERN, PATTERN };
+
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, first, 5);
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected, second, 3);
+}
+
+void test_SweepIsSplitIntoSlices(void)
+{
+    TEST_ASSERT_TRUE(PoisonCheckStep(&chk, 0, &bad));
+    TEST_ASSERT_EQUAL_UINT8(0, chk.area);
+    TEST_ASSERT_EQUAL_UINT32(3, chk.offset);
+
+    TEST_ASSERT_TRUE(PoisonCheckStep(&chk, 1, &bad));
+    TEST_ASSERT_EQUAL_UINT8(1, chk.area);
+    TEST_ASSERT_EQUAL_UINT32(1, chk.offset);
+    TEST_ASSERT_EQUAL_UINT32(0, chk.sweeps);
+
+    TEST_ASSERT_TRUE(PoisonCheckStep(&chk, 2, &bad));
+    TEST_ASSERT_EQUAL_UINT32(1, chk.sweeps);
+    TEST_ASSERT_EQUAL_UINT32(2, chk.last_sweep);
+}
+
+void test_CorruptedWordIsReported(void)
+{
+    second[0] = 0;
+
+    PoisonCheckStep(&chk, 0, &bad);
+    TEST_ASSERT_FALSE(PoisonCheckStep(&chk, 1, &bad));
+    TEST_ASSERT_EQUAL_PTR(&second[0], bad);
+}
+
+void test_NextSweepWaitsForThePeriod(void)
+{
+    PoisonCheckStep(&chk, 0, &bad);
+    PoisonCheckStep(&chk, 0, &bad);
+    PoisonCheckStep(&chk, 0, &bad);
+    first[0] = 0;
+
+    TEST_ASSERT_TRUE(PoisonCheckStep(&chk, 99, &bad));
+    TEST_ASSERT_FALSE(PoisonCheckStep(&chk, 100, &bad));
+    TEST_ASSERT_EQUAL_PTR(&first[0], bad);
+}
+
+void test_SlowSweepIsCountedOverdue(void)
+{
+    PoisonCheckStep(&chk, 0, &bad);
+    PoisonCheckStep(&chk, 50, &bad);
+    PoisonCheckStep(&chk, 150, &bad);
+
+    TEST_ASSERT_EQUAL_UINT32(1, chk.overdue);
+}
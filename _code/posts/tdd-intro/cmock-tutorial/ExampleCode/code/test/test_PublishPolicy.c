@@ -0,0 +1,79 @@
+#include "unity.h"
+#include "cmock.h"
+#include "PublishPolicy.h"
+
+static PublishPolicy_t policy;
+
+static bool Check(SensorTime_t timestamp, int16_t value)
+{
+    SensorSample_t sample = { timestamp, { value, 0, 0 } };
+
+    return PublishPolicyCheck(&policy, &sample);
+}
+
+static void Init(uint16_t deadband, uint16_t relative, SensorTime_t min, SensorTime_t max)
+{
+    PublishPolicyConfig_t config = { deadband, relative, min, max };
+
+    PublishPolicyInit(&policy, &config, 1);
+}
+
+void setUp(void)
+{
+    Init(0, 0, 0, 0);
+}
+
+void tearDown()
+{
+}
+
+void test_FirstSampleIsAlwaysPublished(void)
+{
+    TEST_ASSERT_TRUE(Check(0, 0));
+}
+
+void test_WithoutThresholdsOnlyChangesArePublished(void)
+{
+    Check(0, 21);
+
+    TEST_ASSERT_FALSE(Check(10, 21));
+    TEST_ASSERT_TRUE(Check(20, 22));
+    TEST_ASSERT_EQUAL_UINT32(1, policy.suppressed);
+}
+
+void test_DeadbandIsMeasuredFromLastPublishedValue(void)
+{
+    Init(2, 0, 0, 0);
+    Check(0, 20);
+
+    TEST_ASSERT_FALSE(Check(10, 22));
+    TEST_ASSERT_FALSE(Check(20, 18));
+    TEST_ASSERT_TRUE(Check(30, 23));
+}
+
+void test_RelativeThresholdScalesWithValue(void)
+{
+    Init(0, 100, 0, 0);
+    Check(0, 1000);
+
+    TEST_ASSERT_FALSE(Check(10, 1100));
+    TEST_ASSERT_TRUE(Check(20, 899));
+}
+
+void test_MinIntervalHoldsBackChanges(void)
+{
+    Init(0, 0, 100, 0);
+    Check(0, 1);
+
+    TEST_ASSERT_FALSE(Check(99, 5));
+    TEST_ASSERT_TRUE(Check(100, 5));
+}
+
+void test_MaxIntervalForcesHeartbeat(void)
+{
+    Init(10, 0, 0, 1000);
+    Check(0xFFFFFF00, 1);
+
+    TEST_ASSERT_FALSE(Check(0x000002E7, 1));
+    TEST_ASSERT_TRUE(Check(0x000002E8, 1));
+}
@@ -0,0 +1,112 @@
+#include "unity.h"
+#include "cmock.h"
+#include "SampleBatch.h"
+
+static SampleBatch_t batch;
+static uint8_t pdu[244];
+
+static void PushTemperature(SensorTime_t t, int16_t value)
+{
+    SensorSample_t sample = { .timestamp = t, .value = { value } };
+
+    SampleBatchPush(&batch, &sample);
+}
+
+void setUp(void)
+{
+    SampleBatchInit(&batch, 1);
+}
+
+void tearDown()
+{
+}
+
+void test_CapacityGrowsWithMtu(void)
+{
+    // default ATT MTU of 23 leaves 20 bytes of value: header plus 3 temperature samples
+    TEST_ASSERT_EQUAL_UINT8(3, SampleBatchCapacity(&batch, 20));
+    TEST_ASSERT_EQUAL_UINT8(SAMPLE_BATCH_LEN, SampleBatchCapacity(&batch, 244));
+    TEST_ASSERT_EQUAL_UINT8(0, SampleBatchCapacity(&batch, SAMPLE_BATCH_HEADER_LEN));
+
+    SampleBatchInit(&batch, 3);
+    TEST_ASSERT_EQUAL_UINT8(29, SampleBatchCapacity(&batch, 244));
+}
+
+void test_PackWritesHeaderAndDeltas(void)
+{
+    uint8_t packed;
+    size_t len;
+
+    PushTemperature(0x01020304, 21);
+    PushTemperature(0x01020304 + 1000, -2);
+
+    len = SampleBatchPack(&batch, 0, pdu, sizeof(pdu), &packed);
+
+    TEST_ASSERT_EQUAL(SAMPLE_BATCH_HEADER_LEN + 2 * 4, len);
+    TEST_ASSERT_EQUAL_UINT8(2, packed);
+
+    uint8_t expected[] = { 2, 1, 0x04, 0x03, 0x02, 0x01,
+                           0x00, 0x00, 21, 0x00,
+                           0xE8, 0x03, 0xFE, 0xFF };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, pdu, sizeof(expected));
+}
+
+void test_PackStopsAtPayloadLimit(void)
+{
+    uint8_t packed;
+    int i;
+
+    for (i = 0; i < 5; i++) {
+        PushTemperature(i * 100, i);
+    }
+
+    TEST_ASSERT_EQUAL(SAMPLE_BATCH_HEADER_LEN + 3 * 4, SampleBatchPack(&batch, 0, pdu, 20, &packed));
+    TEST_ASSERT_EQUAL_UINT8(3, packed);
+
+    SampleBatchConsume(&batch, packed);
+    SampleBatchPack(&batch, 0, pdu, 20, &packed);
+    TEST_ASSERT_EQUAL_UINT8(2, packed);
+    TEST_ASSERT_EQUAL_HEX8(3, pdu[8]);
+}
+
+void test_PackStartsNewBaseWhenDeltaOverflows(void)
+{
+    uint8_t packed;
+
+    PushTemperature(0, 1);
+    PushTemperature(70000, 2);
+
+    SampleBatchPack(&batch, 0, pdu, sizeof(pdu), &packed);
+    TEST_ASSERT_EQUAL_UINT8(1, packed);
+}
+
+void test_FullBufferDropsOldest(void)
+{
+    uint8_t packed;
+    int i;
+
+    for (i = 0; i < SAMPLE_BATCH_LEN + 2; i++) {
+        PushTemperature(i, i);
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(SAMPLE_BATCH_LEN, batch.count);
+    TEST_ASSERT_EQUAL_UINT32(2, batch.dropped);
+
+    SampleBatchPack(&batch, 0, pdu, sizeof(pdu), &packed);
+    TEST_ASSERT_EQUAL_HEX8(2, pdu[2]);
+}
+
+void test_EfficiencyImprovesWithBatching(void)
+{
+    SampleBatchStats_t single = { 0 };
+    SampleBatchStats_t batched = { 0 };
+
+    // one sample per notification with the default 27-byte LL payload
+    SampleBatchAccount(&single, &batch, SAMPLE_BATCH_HEADER_LEN + 4, 1, 27);
+    // 32 samples in one notification, data length extension to 251 bytes
+    SampleBatchAccount(&batched, &batch, SAMPLE_BATCH_HEADER_LEN + 32 * 4, 32, 251);
+
+    TEST_ASSERT_EQUAL_UINT32(SAMPLE_BATCH_HEADER_LEN + 4 + 3 + 4 + 10, single.air_bytes);
+    TEST_ASSERT_EQUAL_UINT16(148, SampleBatchEfficiency(&single));
+    TEST_ASSERT_TRUE(SampleBatchEfficiency(&batched) > 800);
+}
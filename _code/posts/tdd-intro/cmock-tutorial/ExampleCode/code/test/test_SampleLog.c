@@ -0,0 +1,96 @@
+#include "unity.h"
+#include "cmock.h"
+#include "SampleLog.h"
+
+#define LOG_RECORDS     (4)
+
+static SampleLog_t history;
+static uint8_t storage[LOG_RECORDS * SAMPLE_LOG_RECORD_LEN];
+
+static void Append(SensorTime_t timestamp, int16_t value)
+{
+    SensorSample_t sample = { timestamp, { value, 0, 0 } };
+
+    SampleLogAppend(&history, 1, 1, &sample);
+}
+
+void setUp(void)
+{
+    SampleLogInit(&history, storage, sizeof(storage));
+}
+
+void tearDown()
+{
+}
+
+void test_RecordIsStoredLittleEndian(void)
+{
+    const uint8_t expected[SAMPLE_LOG_RECORD_LEN] = { 0x04, 0x03, 0x02, 0x01, 1, 1, 0xFE, 0xFF, 0, 0, 0, 0 };
+    const uint8_t *data;
+    uint32_t offset = 0;
+
+    Append(0x01020304, -2);
+
+    TEST_ASSERT_EQUAL_UINT32(SAMPLE_LOG_RECORD_LEN, SampleLogPeek(&history, &offset, &data));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, data, SAMPLE_LOG_RECORD_LEN);
+}
+
+void test_PeekEndsAtNewestRecord(void)
+{
+    const uint8_t *data;
+    uint32_t offset = SAMPLE_LOG_RECORD_LEN;
+
+    Append(1, 1);
+    Append(2, 2);
+
+    TEST_ASSERT_EQUAL_UINT32(SAMPLE_LOG_RECORD_LEN, SampleLogPeek(&history, &offset, &data));
+    TEST_ASSERT_EQUAL_UINT8(2, data[0]);
+
+    offset += SAMPLE_LOG_RECORD_LEN;
+    TEST_ASSERT_EQUAL_UINT32(0, SampleLogPeek(&history, &offset, &data));
+}
+
+void test_OverwrittenOffsetMovesToOldestRecord(void)
+{
+    const uint8_t *data;
+    uint32_t offset = 0;
+    int i;
+
+    for (i = 0; i < LOG_RECORDS + 2; i++) {
+        Append(i, i);
+    }
+
+    SampleLogPeek(&history, &offset, &data);
+    TEST_ASSERT_EQUAL_UINT32(2 * SAMPLE_LOG_RECORD_LEN, offset);
+    TEST_ASSERT_EQUAL_UINT8(2, data[0]);
+}
+
+void test_PeekStopsAtEndOfRing(void)
+{
+    const uint8_t *data;
+    uint32_t offset = 0;
+    int i;
+
+    for (i = 0; i < LOG_RECORDS + 1; i++) {
+        Append(i, i);
+    }
+
+    // records 1..3 sit at the end of the storage, record 4 at its beginning
+    TEST_ASSERT_EQUAL_UINT32(3 * SAMPLE_LOG_RECORD_LEN, SampleLogPeek(&history, &offset, &data));
+
+    offset += 3 * SAMPLE_LOG_RECORD_LEN;
+    TEST_ASSERT_EQUAL_UINT32(SAMPLE_LOG_RECORD_LEN, SampleLogPeek(&history, &offset, &data));
+    TEST_ASSERT_EQUAL_PTR(storage, data);
+}
+
+void test_ResumeOffsetIsAlignedToRecord(void)
+{
+    const uint8_t *data;
+    uint32_t offset = SAMPLE_LOG_RECORD_LEN + 5;
+
+    Append(1, 1);
+    Append(2, 2);
+
+    SampleLogPeek(&history, &offset, &data);
+    TEST_ASSERT_EQUAL_UINT32(SAMPLE_LOG_RECORD_LEN, offset);
+}
@@ -0,0 +1,162 @@
+#include "unity.h"
+#include "cmock.h"
+#include "mock_ad_i2c.h"
+#include "mock_osal.h"
+#include "SensorExecutor.h"
+
+#define EVENT_READ      (1 << 0)
+#define EVENT_DELAY     (1 << 1)
+
+static const uint8_t reg = 0x28;
+static uint8_t rx[2];
+static SensorThread_t thread;
+static SensorThread_t other;
+static int steps;
+static int other_steps;
+static uint32_t seen;
+
+/* Waits for an event, optionally sleeps, then reads the bus once and finishes */
+static CoState_t TestThread(SensorThread_t *t)
+{
+    uint32_t events;
+
+    CO_BEGIN(&t->co);
+
+    steps++;
+    SENSOR_WAIT_EVENT(t, EVENT_READ | EVENT_DELAY, events);
+    seen = events;
+    steps++;
+
+    if (seen & EVENT_DELAY) {
+        SENSOR_DELAY(t, 10);
+        steps++;
+    }
+
+    SENSOR_I2C_TAKE(t);
+    SENSOR_I2C_READ(t, 1, &reg, sizeof(reg), rx, sizeof(rx));
+    SENSOR_I2C_GIVE(t);
+    steps++;
+
+    CO_END(&t->co);
+}
+
+/* Reads the bus right away */
+static CoState_t OtherThread(SensorThread_t *t)
+{
+    CO_BEGIN(&t->co);
+
+    SENSOR_I2C_TAKE(t);
+    SENSOR_I2C_READ(t, 2, &reg, sizeof(reg), rx, sizeof(rx));
+    SENSOR_I2C_GIVE(t);
+    other_steps++;
+
+    CO_END(&t->co);
+}
+
+void setUp(void)
+{
+    vPortEnterCritical_Ignore();
+    vPortExitCritical_Ignore();
+    xTaskCreate_Ignore();
+    xTaskNotify_Ignore();
+    xTaskNotifyFromISR_IgnoreAndReturn(0);
+
+    steps = 0;
+    other_steps = 0;
+    seen = 0;
+    SensorExecutorInit();
+    SensorExecutorAdd(&thread, TestThread);
+}
+
+void tearDown()
+{
+}
+
+void test_ThreadRunsUpToItsFirstWait(void)
+{
+    TEST_ASSERT_EQUAL_UINT16(OS_TASK_NOTIFY_FOREVER, SensorExecutorRun());
+    TEST_ASSERT_EQUAL_INT(1, steps);
+
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(1, steps);
+}
+
+void test_SignalResumesOnlyOnWaitedEvents(void)
+{
+    SensorExecutorRun();
+
+    SensorExecutorSignal(&thread, 1 << 4);
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(1, steps);
+
+    ad_i2c_async_transact_Expect(1, &reg, sizeof(reg), rx, sizeof(rx), SensorExecutorI2cDone,
+                                                                                &thread);
+    SensorExecutorSignal(&thread, EVENT_READ);
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(2, steps);
+    TEST_ASSERT_EQUAL_HEX32(EVENT_READ, seen);
+}
+
+void test_I2cReadSuspendsUntilTransferCompletes(void)
+{
+    ad_i2c_async_transact_Expect(1, &reg, sizeof(reg), rx, sizeof(rx), SensorExecutorI2cDone,
+                                                                                &thread);
+    SensorExecutorRun();
+    SensorExecutorSignal(&thread, EVENT_READ);
+    SensorExecutorRun();
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(2, steps);
+
+    SensorExecutorI2cDone(&thread, 0);
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(3, steps);
+    TEST_ASSERT_NULL(thread.run);
+}
+
+void test_DelayBecomesExecutorTimeout(void)
+{
+    SensorExecutorRun();
+    SensorExecutorSignal(&thread, EVENT_DELAY);
+
+    /* Start of the delay, first check, then the executor's own look at it */
+    xTaskGetTickCount_ExpectAndReturn(0xFFFC);
+    xTaskGetTickCount_ExpectAndReturn(0xFFFC);
+    xTaskGetTickCount_ExpectAndReturn(0xFFFD);
+    TEST_ASSERT_EQUAL_UINT16(9, SensorExecutorRun());
+
+    xTaskGetTickCount_ExpectAndReturn(0x0005);
+    xTaskGetTickCount_ExpectAndReturn(0x0005);
+    TEST_ASSERT_EQUAL_UINT16(1, SensorExecutorRun());
+    TEST_ASSERT_EQUAL_INT(2, steps);
+
+    xTaskGetTickCount_ExpectAndReturn(0x0006);
+    ad_i2c_async_transact_Expect(1, &reg, sizeof(reg), rx, sizeof(rx), SensorExecutorI2cDone,
+                                                                                &thread);
+    TEST_ASSERT_EQUAL_UINT16(OS_TASK_NOTIFY_FOREVER, SensorExecutorRun());
+    TEST_ASSERT_EQUAL_INT(3, steps);
+}
+
+void test_SecondTransferWaitsForTheFirstToComplete(void)
+{
+    /* Added last, so it runs first */
+    SensorExecutorAdd(&other, OtherThread);
+    ad_i2c_async_transact_Expect(2, &reg, sizeof(reg), rx, sizeof(rx), SensorExecutorI2cDone,
+                                                                                &other);
+    SensorExecutorRun();
+
+    SensorExecutorSignal(&thread, EVENT_READ);
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(2, steps);
+    TEST_ASSERT_EQUAL_INT(0, other_steps);
+
+    SensorExecutorI2cDone(&other, 0);
+    ad_i2c_async_transact_Expect(1, &reg, sizeof(reg), rx, sizeof(rx), SensorExecutorI2cDone,
+                                                                                &thread);
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(1, other_steps);
+    TEST_ASSERT_NULL(other.run);
+
+    SensorExecutorI2cDone(&thread, 0);
+    SensorExecutorRun();
+    TEST_ASSERT_EQUAL_INT(3, steps);
+}
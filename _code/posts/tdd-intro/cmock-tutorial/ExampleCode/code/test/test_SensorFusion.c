@@ -0,0 +1,118 @@
+#include "unity.h"
+#include "cmock.h"
+#include "SensorFusion.h"
+
+#define PERIOD      (1000)
+#define MAX_LAG     (3000)
+
+static SensorFrame_t frames[8];
+static int frame_count;
+
+static void CaptureFrame(const SensorFrame_t *frame)
+{
+    if (frame_count < 8) {
+        frames[frame_count] = *frame;
+    }
+    frame_count++;
+}
+
+static void PushTemperature(SensorTime_t t, int16_t value)
+{
+    SensorSample_t sample = { .timestamp = t, .value = { value } };
+
+    SensorFusionPush(SENSOR_STREAM_TEMPERATURE, &sample);
+}
+
+static void PushAcceleration(SensorTime_t t, int16_t x)
+{
+    SensorSample_t sample = { .timestamp = t, .value = { x, 0, 16384 } };
+
+    SensorFusionPush(SENSOR_STREAM_ACCELERATION, &sample);
+}
+
+void setUp(void)
+{
+    frame_count = 0;
+    SensorFusionInit(PERIOD, MAX_LAG, CaptureFrame);
+}
+
+void tearDown()
+{
+}
+
+void test_InterpolateIsLinearBetweenSamples(void)
+{
+    SensorSample_t a = { .timestamp = 1000, .value = { 20 } };
+    SensorSample_t b = { .timestamp = 3000, .value = { 30 } };
+
+    TEST_ASSERT_EQUAL_INT16(20, Interpolate(&a, &b, 500, 0));
+    TEST_ASSERT_EQUAL_INT16(25, Interpolate(&a, &b, 2000, 0));
+    TEST_ASSERT_EQUAL_INT16(30, Interpolate(&a, &b, 4000, 0));
+}
+
+void test_FrameWaitsForEveryStream(void)
+{
+    PushAcceleration(1010, 100);
+    PushAcceleration(2010, 200);
+    TEST_ASSERT_EQUAL(0, frame_count);
+
+    PushTemperature(1990, 21);
+    PushTemperature(3990, 23);
+
+    // grid point 2000 is bracketed by both streams, 3000 still waits for acceleration
+    TEST_ASSERT_EQUAL(1, frame_count);
+    TEST_ASSERT_EQUAL_UINT32(2000, frames[0].timestamp);
+    TEST_ASSERT_EQUAL_INT16(21, frames[0].temperature);
+    TEST_ASSERT_EQUAL_INT16(199, frames[0].acceleration[0]);
+    TEST_ASSERT_EQUAL_HEX8(0, frames[0].stale_mask);
+}
+
+void test_SlowStreamIsInterpolatedOntoFastGrid(void)
+{
+    PushTemperature(0, 20);
+    PushTemperature(2000, 22);
+    PushAcceleration(0, 0);
+    PushAcceleration(1000, 0);
+    PushAcceleration(2000, 0);
+
+    TEST_ASSERT_EQUAL(3, frame_count);
+    TEST_ASSERT_EQUAL_INT16(20, frames[0].temperature);
+    TEST_ASSERT_EQUAL_INT16(21, frames[1].temperature);
+    TEST_ASSERT_EQUAL_INT16(22, frames[2].temperature);
+}
+
+void test_LaggingStreamIsHeldAndFlaggedStale(void)
+{
+    PushTemperature(0, 20);
+    PushAcceleration(0, 5);
+    TEST_ASSERT_EQUAL(1, frame_count);
+
+    // temperature sensor stops, acceleration keeps going past the lag bound
+    PushAcceleration(1000, 5);
+    PushAcceleration(2000, 5);
+    PushAcceleration(3000, 5);
+    TEST_ASSERT_EQUAL(1, frame_count);
+
+    PushAcceleration(4500, 5);
+    TEST_ASSERT_EQUAL(2, frame_count);
+    TEST_ASSERT_EQUAL_UINT32(1000, frames[1].timestamp);
+    TEST_ASSERT_EQUAL_INT16(20, frames[1].temperature);
+    TEST_ASSERT_EQUAL_HEX8(1 << SENSOR_STREAM_TEMPERATURE, frames[1].stale_mask);
+}
+
+void test_GridPointOlderThanTheHistoryIsFlaggedStale(void)
+{
+    int i;
+
+    // the first frame waits for temperature while more than a history of acceleration arrives
+    PushAcceleration(0, 7);
+    for (i = 1; i <= FUSION_HISTORY_LEN; i++) {
+        PushAcceleration(i, 9);
+    }
+    PushTemperature(0, 20);
+
+    TEST_ASSERT_EQUAL(1, frame_count);
+    TEST_ASSERT_EQUAL_UINT32(0, frames[0].timestamp);
+    TEST_ASSERT_EQUAL_INT16(9, frames[0].acceleration[0]);
+    TEST_ASSERT_EQUAL_HEX8(1 << SENSOR_STREAM_ACCELERATION, frames[0].stale_mask);
+}
@@ -0,0 +1,62 @@
+#include <string.h>
+#include "unity.h"
+#include "cmock.h"
+#include "SensorSnapshot.h"
+
+static uint8_t pdu[SENSOR_SNAPSHOT_LEN];
+
+void setUp(void)
+{
+    memset(pdu, 0xAA, sizeof(pdu));
+    SensorSnapshotInit(pdu);
+}
+
+void tearDown()
+{
+}
+
+void test_InitClearsEverythingButVersion(void)
+{
+    uint8_t expected[SENSOR_SNAPSHOT_LEN] = { SENSOR_SNAPSHOT_VERSION };
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, pdu, sizeof(pdu));
+}
+
+void test_TemperatureAndAccelerationAreStampedLittleEndian(void)
+{
+    const SensorSample_t temperature = { 0x12345678, { -2 } };
+    const SensorSample_t acceleration = { 0x00000100, { 1, -1, 0x1234 } };
+    const uint8_t expected[16] = { 0x78, 0x56, 0x34, 0x12, 0xFE, 0xFF,
+                                   0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0xFF, 0xFF, 0x34, 0x12 };
+
+    SensorSnapshotSetTemperature(pdu, &temperature);
+    SensorSnapshotSetAcceleration(pdu, &acceleration);
+
+    TEST_ASSERT_EQUAL_HEX8(SNAPSHOT_TEMPERATURE | SNAPSHOT_ACCELERATION, pdu[1]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &pdu[2], sizeof(expected));
+}
+
+void test_TiltAndActivityFillTheTail(void)
+{
+    const Tilt_t tilt = { -9000, 100, 200, 16384 };
+    const uint8_t expected[17] = { 5, 0, 0, 0, 0xD8, 0xDC, 0x64, 0x00, 0xC8, 0x00, 0x00, 0x40,
+                                   6, 0, 0, 0, 3 };
+
+    SensorSnapshotSetTilt(pdu, 5, &tilt);
+    SensorSnapshotSetActivity(pdu, 6, 3);
+
+    TEST_ASSERT_EQUAL_HEX8(SNAPSHOT_TILT | SNAPSHOT_ACTIVITY, pdu[1]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &pdu[18], sizeof(expected));
+}
+
+void test_FusedFrameIsAppendedAfterTheActivity(void)
+{
+    const SensorFrame_t frame = { 7, -2, { 1, -1, 0x1234 }, 1 << SENSOR_STREAM_TEMPERATURE };
+    const uint8_t expected[13] = { 7, 0, 0, 0, 0xFE, 0xFF,
+                                   0x01, 0x00, 0xFF, 0xFF, 0x34, 0x12, 0x01 };
+
+    SensorSnapshotSetFrame(pdu, &frame);
+
+    TEST_ASSERT_EQUAL_HEX8(SNAPSHOT_FRAME, pdu[1]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &pdu[35], sizeof(expected));
+}
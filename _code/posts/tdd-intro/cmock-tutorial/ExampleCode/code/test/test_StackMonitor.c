@@ -0,0 +1,76 @@
+#include "unity.h"
+#include "cmock.h"
+#include "StackMonitor.h"
+
+static StackMonitor_t mon;
+static int task_a, task_b;
+static uint32_t free_a, free_b;
+static int measured;
+
+static uint32_t Measure(void *task)
+{
+    measured++;
+    return (task == &task_a) ? free_a : free_b;
+}
+
+void setUp(void)
+{
+    measured = 0;
+    free_a = 600;
+    free_b = 100;
+    StackMonitorInit(&mon, Measure);
+    StackMonitorAdd(&mon, "a", &task_a, 1024);
+    StackMonitorAdd(&mon, "b", &task_b, 400);
+}
+
+void tearDown()
+{
+}
+
+void test_EachStepMeasuresOneTaskRoundRobin(void)
+{
+    TEST_ASSERT_EQUAL_PTR(&mon.tasks[0], StackMonitorStep(&mon));
+    TEST_ASSERT_EQUAL_PTR(&mon.tasks[1], StackMonitorStep(&mon));
+    TEST_ASSERT_EQUAL_PTR(&mon.tasks[0], StackMonitorStep(&mon));
+    TEST_ASSERT_EQUAL_INT(3, measured);
+}
+
+void test_PeakUseIsKept(void)
+{
+    TEST_ASSERT_EQUAL_UINT16(0, StackMonitorUsed(&mon.tasks[0]));
+
+    StackMonitorStep(&mon);
+    StackMonitorStep(&mon);
+    free_a = 800;
+    StackMonitorStep(&mon);
+
+    TEST_ASSERT_EQUAL_UINT16(424, StackMonitorUsed(&mon.tasks[0]));
+}
+
+void test_SuggestionAddsMarginAndRoundsUp(void)
+{
+    StackMonitorStep(&mon);
+
+    TEST_ASSERT_EQUAL_UINT16(424, StackMonitorSuggest(&mon.tasks[0], 0));
+    TEST_ASSERT_EQUAL_UINT16(512, StackMonitorSuggest(&mon.tasks[0], 20));
+}
+
+void test_PackListsSizeAndUse(void)
+{
+    const uint8_t expected[9] = { 2, 0x00, 0x04, 0xA8, 0x01, 0x90, 0x01, 0x2C, 0x01 };
+    uint8_t pdu[STACK_MONITOR_PDU_LEN];
+
+    StackMonitorStep(&mon);
+    StackMonitorStep(&mon);
+    StackMonitorPack(&mon, pdu);
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, pdu, sizeof(expected));
+    TEST_ASSERT_EQUAL_HEX8(0, pdu[STACK_MONITOR_PDU_LEN - 1]);
+}
+
+void test_AddFailsWhenFull(void)
+{
+    TEST_ASSERT_TRUE(StackMonitorAdd(&mon, "c", NULL, 100));
+    TEST_ASSERT_TRUE(StackMonitorAdd(&mon, "d", NULL, 100));
+    TEST_ASSERT_FALSE(StackMonitorAdd(&mon, "e", NULL, 100));
+}
@@ -2,6 +2,7 @@
 #include "cmock.h"
 #include "mock_ad_i2c.h"
 #include "mock_osal.h"
+#include "mock_SensorExecutor.h"
 #include "mock_platform_devices.h"
 #include "TemperatureDriver.h"
 #include "FakeTemperature_i2c.h"
@@ -85,3 +86,94 @@ void test_ConvertTemperatureFromRegistersWithExtremeValues(void)
 }
 
 
+
+static int samples;
+
+static void CountSample(void)
+{
+    samples++;
+}
+
+void test_FailedTransferIsMeasuredAgain(void)
+{
+    SensorThread_t t = { 0 };
+    SensorSample_t sample;
+    i2c_device dev = 1;
+
+    TemperatureDriverRegisterSampleCb(CountSample);
+    vPortEnterCritical_Ignore();
+    vPortExitCritical_Ignore();
+    ad_i2c_open_IgnoreAndReturn(dev);
+    ad_i2c_close_Ignore();
+    SensorThreadStartDelay_Ignore();
+    SensorThreadTakeBus_IgnoreAndReturn(true);
+    SensorThreadGiveBus_Ignore();
+
+    // the MSB read fails, the LSB is not read and nothing is stored
+    t.i2c_error = 1;
+    SensorThreadTakeEvents_IgnoreAndReturn(1 << 1);
+    SensorThreadStartI2cRead_Expect(&t, dev, NULL, 1, NULL, 1);
+    SensorThreadStartI2cRead_IgnoreArg_wbuf();
+    SensorThreadStartI2cRead_IgnoreArg_rbuf();
+    SensorThreadDelayOver_ExpectAndReturn(&t, false);
+    TEST_ASSERT_EQUAL(CO_WAITING, TemperatureDriverThread(&t));
+    TEST_ASSERT_EQUAL(0, samples);
+
+    // the retry goes through
+    t.i2c_error = 0;
+    SensorThreadDelayOver_ExpectAndReturn(&t, true);
+    SensorThreadStartI2cRead_Expect(&t, dev, NULL, 1, NULL, 1);
+    SensorThreadStartI2cRead_IgnoreArg_wbuf();
+    SensorThreadStartI2cRead_IgnoreArg_rbuf();
+    SensorThreadStartI2cRead_Expect(&t, dev, NULL, 1, NULL, 1);
+    SensorThreadStartI2cRead_IgnoreArg_wbuf();
+    SensorThreadStartI2cRead_IgnoreArg_rbuf();
+    xTaskGetTickCount_ExpectAndReturn(42);
+    SensorThreadTakeEvents_IgnoreAndReturn(0);
+    TEST_ASSERT_EQUAL(CO_WAITING, TemperatureDriverThread(&t));
+    TEST_ASSERT_EQUAL(1, samples);
+
+    TemperatureDriverGetSample(&sample);
+    TEST_ASSERT_EQUAL_UINT32(42, sample.timestamp);
+}
+
+static int failures;
+
+static void CountFailure(void)
+{
+    failures++;
+}
+
+void test_MeasurementIsReportedFailedAfterTheLastAttempt(void)
+{
+    SensorThread_t t = { 0 };
+    i2c_device dev = 1;
+
+    samples = 0;
+    TemperatureDriverRegisterSampleCb(CountSample);
+    TemperatureDriverRegisterFailCb(CountFailure);
+    ad_i2c_open_IgnoreAndReturn(dev);
+    ad_i2c_close_Ignore();
+    SensorThreadStartDelay_Ignore();
+    SensorThreadStartI2cRead_Ignore();
+    SensorThreadTakeBus_IgnoreAndReturn(true);
+    SensorThreadGiveBus_Ignore();
+
+    // every attempt fails on the MSB read
+    t.i2c_error = 1;
+    SensorThreadTakeEvents_IgnoreAndReturn(1 << 1);
+    SensorThreadDelayOver_ExpectAndReturn(&t, false);
+    TEST_ASSERT_EQUAL(CO_WAITING, TemperatureDriverThread(&t));
+
+    SensorThreadDelayOver_ExpectAndReturn(&t, true);
+    SensorThreadDelayOver_ExpectAndReturn(&t, false);
+    TEST_ASSERT_EQUAL(CO_WAITING, TemperatureDriverThread(&t));
+    TEST_ASSERT_EQUAL(0, failures);
+
+    // no delay after the last one, the failure is reported and the thread waits again
+    SensorThreadDelayOver_ExpectAndReturn(&t, true);
+    SensorThreadTakeEvents_IgnoreAndReturn(0);
+    TEST_ASSERT_EQUAL(CO_WAITING, TemperatureDriverThread(&t));
+    TEST_ASSERT_EQUAL(1, failures);
+    TEST_ASSERT_EQUAL(0, samples);
+}
@@ -0,0 +1,93 @@
+#include "unity.h"
+#include "cmock.h"
+#include "TiltEstimator.h"
+
+void setUp(void)
+{
+    TiltEstimatorInit(0);
+}
+
+void tearDown()
+{
+}
+
+void test_Atan2CoversAllQuadrants(void)
+{
+    TEST_ASSERT_INT_WITHIN(2, 0, CordicAtan2(0, 1000));
+    TEST_ASSERT_INT_WITHIN(2, 4500, CordicAtan2(1000, 1000));
+    TEST_ASSERT_INT_WITHIN(2, 9000, CordicAtan2(1000, 0));
+    TEST_ASSERT_INT_WITHIN(2, 13500, CordicAtan2(1000, -1000));
+    TEST_ASSERT_INT_WITHIN(2, -13500, CordicAtan2(-1000, -1000));
+    TEST_ASSERT_INT_WITHIN(2, -9000, CordicAtan2(-1000, 0));
+    TEST_ASSERT_INT_WITHIN(2, 3000, CordicAtan2(16384, 28378));
+}
+
+void test_HypotMatchesPythagoras(void)
+{
+    TEST_ASSERT_INT_WITHIN(1, 5000, CordicHypot(3000, 4000));
+    TEST_ASSERT_INT_WITHIN(1, 46341, CordicHypot(32767, 32767));
+    TEST_ASSERT_INT_WITHIN(1, 16384, CordicHypot(0, -16384));
+}
+
+void test_FlatDeviceHasNoTilt(void)
+{
+    const int16_t flat[3] = { 0, 0, 16384 };
+    Tilt_t tilt;
+
+    TiltEstimatorUpdate(flat, &tilt);
+
+    TEST_ASSERT_INT_WITHIN(2, 0, tilt.pitch);
+    TEST_ASSERT_INT_WITHIN(2, 0, tilt.roll);
+    TEST_ASSERT_INT_WITHIN(2, 0, tilt.tilt);
+    TEST_ASSERT_INT_WITHIN(2, 16384, tilt.magnitude);
+}
+
+void test_PitchedDeviceReportsPitchAndTilt(void)
+{
+    // 30 degrees nose up: gravity moves from Z towards -X
+    const int16_t pitched[3] = { -8192, 0, 14189 };
+    Tilt_t tilt;
+
+    TiltEstimatorUpdate(pitched, &tilt);
+
+    TEST_ASSERT_INT_WITHIN(3, 3000, tilt.pitch);
+    TEST_ASSERT_INT_WITHIN(3, 0, tilt.roll);
+    TEST_ASSERT_INT_WITHIN(3, 3000, tilt.tilt);
+}
+
+void test_OffsetsAreRemovedBeforeTheAngles(void)
+{
+    const int16_t offsets[3] = { 100, -200, 0 };
+    const int16_t flat[3] = { 100, -200, 16384 };
+    Tilt_t tilt;
+
+    TiltEstimatorSetOffsets(offsets);
+    TiltEstimatorUpdate(flat, &tilt);
+
+    TEST_ASSERT_INT_WITHIN(2, 0, tilt.tilt);
+}
+
+void test_FilterConvergesTheShortWayRound(void)
+{
+    const int16_t upside_down_left[3]  = { 0, 286, -16382 };     // roll ~ +179
+    const int16_t upside_down_right[3] = { 0, -286, -16382 };    // roll ~ -179
+    Tilt_t tilt;
+    int i;
+
+    TiltEstimatorInit(2);
+    TiltEstimatorUpdate(upside_down_left, &tilt);
+    TEST_ASSERT_INT_WITHIN(5, 17900, tilt.roll);
+
+    for (i = 0; i < 20; i++) {
+        TiltEstimatorUpdate(upside_down_right, &tilt);
+        TEST_ASSERT_TRUE(tilt.roll > 17800 || tilt.roll < -17800);
+    }
+    TEST_ASSERT_INT_WITHIN(5, -17900, tilt.roll);
+}
+
+void test_WrapAngleKeepsHalfOpenRange(void)
+{
+    TEST_ASSERT_EQUAL_INT32(18000, WrapAngle(18000, 18000));
+    TEST_ASSERT_EQUAL_INT32(-17000, WrapAngle(19000, 18000));
+    TEST_ASSERT_EQUAL_INT32(18000, WrapAngle(-18000, 18000));
+}
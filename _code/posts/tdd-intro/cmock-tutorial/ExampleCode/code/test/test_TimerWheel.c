@@ -0,0 +1,129 @@
+#include "unity.h"
+#include "cmock.h"
+#include "TimerWheel.h"
+
+#define RESOLUTION  (10)
+
+static TimerWheel_t wheel;
+static TimerJob_t a, b;
+static int runs_a, runs_b;
+
+static void RunA(TimerJob_t *job)
+{
+    runs_a++;
+}
+
+static void RunB(TimerJob_t *job)
+{
+    runs_b++;
+}
+
+void setUp(void)
+{
+    TimerWheelInit(&wheel, RESOLUTION, 0);
+    runs_a = runs_b = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_JobRunsOncePerPeriod(void)
+{
+    TimerJobInit(&a, 100, 0, 0, RunA);
+    TimerWheelStart(&wheel, &a, 0);
+
+    TimerWheelAdvance(&wheel, 99);
+    TEST_ASSERT_EQUAL_INT(0, runs_a);
+    TimerWheelAdvance(&wheel, 100);
+    TEST_ASSERT_EQUAL_INT(1, runs_a);
+    TimerWheelAdvance(&wheel, 299);
+    TEST_ASSERT_EQUAL_INT(2, runs_a);
+}
+
+void test_AlignedJobsShareAWakeup(void)
+{
+    uint32_t when;
+
+    TimerJobInit(&a, 1000, 1000, 0, RunA);
+    TimerJobInit(&b, 2000, 1000, 0, RunB);
+    TimerWheelStart(&wheel, &a, 1130);
+    TimerWheelStart(&wheel, &b, 470);
+
+    TEST_ASSERT_TRUE(TimerWheelNextWakeup(&wheel, &when));
+    TEST_ASSERT_EQUAL_UINT32(3000, when);
+    TEST_ASSERT_EQUAL_UINT16(2, TimerWheelAdvance(&wheel, when));
+}
+
+void test_SlackDefersTheWakeupToCatchTheNextJob(void)
+{
+    uint32_t when;
+
+    TimerJobInit(&a, 1000, 0, 100, RunA);
+    TimerJobInit(&b, 1080, 0, 100, RunB);
+    TimerWheelStart(&wheel, &a, 0);
+    TimerWheelStart(&wheel, &b, 0);
+
+    TimerWheelNextWakeup(&wheel, &when);
+    TEST_ASSERT_EQUAL_UINT32(1100, when);
+    TEST_ASSERT_EQUAL_UINT16(2, TimerWheelAdvance(&wheel, when));
+    TEST_ASSERT_EQUAL_UINT32(1, wheel.wakeups);
+}
+
+void test_LongPeriodsCascadeDownInTime(void)
+{
+    TimerJobInit(&a, 100000, 0, 0, RunA);
+    TimerWheelStart(&wheel, &a, 5);
+
+    TimerWheelAdvance(&wheel, 50000);
+    TimerWheelAdvance(&wheel, 100004);
+    TEST_ASSERT_EQUAL_INT(0, runs_a);
+    TimerWheelAdvance(&wheel, 100010);
+    TEST_ASSERT_EQUAL_INT(1, runs_a);
+}
+
+void test_StoppedJobNeverRuns(void)
+{
+    uint32_t when;
+
+    TimerJobInit(&a, 100, 0, 0, RunA);
+    TimerWheelStart(&wheel, &a, 0);
+    TimerWheelStop(&wheel, &a);
+
+    TEST_ASSERT_FALSE(TimerWheelRunning(&a));
+    TEST_ASSERT_FALSE(TimerWheelNextWakeup(&wheel, &when));
+    TimerWheelAdvance(&wheel, 1000);
+    TEST_ASSERT_EQUAL_INT(0, runs_a);
+}
+
+void test_NewPeriodRestartsFromNow(void)
+{
+    TimerJobInit(&a, 1000, 0, 0, RunA);
+    TimerWheelStart(&wheel, &a, 0);
+    TimerWheelSetPeriod(&wheel, &a, 100, 50);
+
+    TimerWheelAdvance(&wheel, 150);
+    TEST_ASSERT_EQUAL_INT(1, runs_a);
+}
+
+void test_MissedPeriodsAreSkipped(void)
+{
+    TimerJobInit(&a, 100, 0, 0, RunA);
+    TimerWheelStart(&wheel, &a, 0);
+
+    TEST_ASSERT_EQUAL_UINT16(1, TimerWheelAdvance(&wheel, 1000));
+    TimerWheelAdvance(&wheel, 1099);
+    TEST_ASSERT_EQUAL_INT(1, runs_a);
+}
+
+void test_TicksMayWrapAround(void)
+{
+    TimerWheelInit(&wheel, RESOLUTION, 0xFFFFFF00);
+    TimerJobInit(&a, 500, 0, 0, RunA);
+    TimerWheelStart(&wheel, &a, 0xFFFFFF00);
+
+    TimerWheelAdvance(&wheel, 0xF3);
+    TEST_ASSERT_EQUAL_INT(0, runs_a);
+    TimerWheelAdvance(&wheel, 0xF4);
+    TEST_ASSERT_EQUAL_INT(1, runs_a);
+}